@@ -0,0 +1,532 @@
+/*
+* -----------------------------------------------------------------
+* COMPANY : Ruhr University Bochum
+* AUTHOR  : Amir Moradi amir.moradi@rub.de Aein Rezaei Shahmirzadi aein.rezaeishahmirzadi@rub.de
+* DOCUMENT: "Second-Order SCA Security with almost no Fresh Randomness" TCHES 2021, Issue 3
+* -----------------------------------------------------------------
+*
+* Copyright c 2021, Amir Moradi, Aein Rezaei Shahmirzadi
+*
+* All rights reserved.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTERS BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* INCLUDING NEGLIGENCE OR OTHERWISE ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+* Please see LICENSE and README for license and further instructions.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+// the function is given by its truth table, bit i of the input being the variable 'a' + i as in the coordinate searches
+const unsigned char	NumberOfBits = 4; // 4 or 5
+const unsigned char	Function[1 << 5] = { 0x0, 0x8, 0xc, 0x4, 0x3, 0xb, 0xf, 0x7, 0x1, 0x9, 0x2, 0xa, 0xe, 0x6, 0xd, 0x5 }; // PRESENT F
+const char			FunctionName[100] = "PRESENT_F";
+const char			CachePath[500] = "AffineClasses.csv";
+const char			CombinationPath[500] = "../PRESENT Sbox/finding F/Res_0123.csv"; // sharings found for the function, cached if its class is new
+const char			TransformedPath[500] = "Transformed_Res_"; // the sharings derived from the cache are written to <TransformedPath>x.csv, the path of FindCombination
+const unsigned int	NumberOfEquivalenceChecks = 100; // random A(F(B(x))) whose canonical form has to be the one of the function
+
+#define	MaxSize (1 << 5)
+#define	MaxNumberOfMonomials (1 << 15) // 3 shares of 5 variables
+
+unsigned char	Size;
+unsigned char	NumberOfVars;
+
+//-----------------------------------------------------
+
+#include "../AffineEquivalence.h"
+
+// number of ones in the matrix of the affine map
+unsigned int AffineWeight(unsigned char* Table)
+{
+	unsigned int	Weight = 0;
+	unsigned char	j;
+
+	for (j = 0; j < NumberOfBits; j++)
+		Weight += BitCount(Table[1 << j] ^ Table[0]);
+
+	return(Weight);
+}
+
+void PrintAffine(const char* Name, unsigned char* Table)
+{
+	unsigned char	i, j;
+
+	printf("%s: constant %x, matrix rows", Name, Table[0]);
+	for (i = 0; i < NumberOfBits; i++)
+	{
+		printf(" ");
+		for (j = 0; j < NumberOfBits; j++)
+			printf("%d", ((Table[1 << j] ^ Table[0]) >> i) & 1);
+	}
+	printf("\n");
+}
+
+//-----------------------------------------------------
+
+// a component function is a set of monomials over the shared variables, variable Letter * 3 + Share - 1 standing for
+// the share Share of the input bit Letter, kept as one bit per possible monomial
+typedef uint64_t Polynomialstruct[MaxNumberOfMonomials / 64];
+
+void ToggleMonomial(uint64_t* P, unsigned short Monomial)
+{
+	P[Monomial >> 6] ^= ((uint64_t)1) << (Monomial & 0x3F);
+}
+
+unsigned int ListMonomials(uint64_t* P, unsigned short* List)
+{
+	unsigned int	Monomial;
+	unsigned int	NumberOfMonomials = 0;
+
+	for (Monomial = 0; Monomial < (1u << NumberOfVars); Monomial++)
+		if ((P[Monomial >> 6] >> (Monomial & 0x3F)) & 1)
+			List[NumberOfMonomials++] = Monomial;
+
+	return(NumberOfMonomials);
+}
+
+void ParsePolynomial(char* Str, uint64_t* P)
+{
+	unsigned short	Monomial;
+	unsigned char	NonZero;
+	char*			c;
+
+	memset(P, 0, sizeof(Polynomialstruct));
+	Monomial = 0;
+	NonZero = 0;
+	for (c = Str;; c++)
+	{
+		if ((*c == '+') || (*c == 0))
+		{
+			if (NonZero)
+				ToggleMonomial(P, Monomial);
+			Monomial = 0;
+			NonZero = 0;
+
+			if (*c == 0)
+				break;
+		}
+		else if ((*c >= 'a') && (*c <= 'z'))
+		{
+			Monomial |= 1 << ((*c - 'a') * 3 + (*(c + 1) - '1'));
+			NonZero = 1;
+			c++;
+		}
+		else if (*c == '1') // the constant
+			NonZero = 1;
+	}
+}
+
+// the monomials by degree, returns their number
+unsigned int PrintPolynomial(uint64_t* P, char* Str)
+{
+	unsigned short	List[MaxNumberOfMonomials];
+	unsigned int	NumberOfMonomials;
+	unsigned int	Degree;
+	unsigned int	i;
+	unsigned char	Var;
+	unsigned char	First;
+
+	NumberOfMonomials = ListMonomials(P, List);
+
+	Str[0] = 0;
+	First = 1;
+	for (Degree = 0; Degree <= NumberOfVars; Degree++)
+		for (i = 0; i < NumberOfMonomials; i++)
+			if (BitCount(List[i]) == Degree)
+			{
+				if (!First)
+					strcat(Str, " + ");
+				First = 0;
+
+				if (List[i] == 0)
+					strcat(Str, "1");
+
+				for (Var = 0; Var < NumberOfVars; Var++)
+					if ((List[i] >> Var) & 1)
+						sprintf(Str + strlen(Str), "%c%d", 'a' + Var / 3, Var % 3 + 1);
+			}
+
+	if (First)
+		strcpy(Str, "0");
+
+	return(NumberOfMonomials);
+}
+
+// R ^= P with the input x of every share replaced by L x (+ c for the first share), L and c given by the affine table A
+void SubstitutePolynomial(uint64_t* P, unsigned char* A, uint64_t* R)
+{
+	unsigned short*	List;
+	unsigned short*	Product;
+	unsigned short	Factor[MaxSize + 1];
+	unsigned int	NumberOfMonomials;
+	unsigned int	NumberOfProduct;
+	unsigned int	NumberOfFactor;
+	unsigned int	i, j, k;
+	unsigned char	Var;
+	unsigned char	Letter;
+	unsigned char	Share;
+	unsigned char	w;
+	Polynomialstruct*	Temp;
+
+	List = (unsigned short*)malloc(MaxNumberOfMonomials * sizeof(unsigned short));
+	Product = (unsigned short*)malloc(MaxNumberOfMonomials * sizeof(unsigned short));
+	Temp = (Polynomialstruct*)malloc(sizeof(Polynomialstruct));
+
+	NumberOfMonomials = ListMonomials(P, List);
+	for (i = 0; i < NumberOfMonomials; i++)
+	{
+		memset(*Temp, 0, sizeof(Polynomialstruct));
+		ToggleMonomial(*Temp, 0);
+
+		for (Var = 0; Var < NumberOfVars; Var++)
+			if ((List[i] >> Var) & 1)
+			{
+				Letter = Var / 3;
+				Share = Var % 3;
+
+				NumberOfFactor = 0;
+				for (w = 0; w < NumberOfBits; w++)
+					if (((A[1 << w] ^ A[0]) >> Letter) & 1)
+						Factor[NumberOfFactor++] = 1 << (w * 3 + Share);
+				if ((Share == 0) && ((A[0] >> Letter) & 1))
+					Factor[NumberOfFactor++] = 0;
+
+				NumberOfProduct = ListMonomials(*Temp, Product);
+				memset(*Temp, 0, sizeof(Polynomialstruct));
+				for (j = 0; j < NumberOfProduct; j++)
+					for (k = 0; k < NumberOfFactor; k++)
+						ToggleMonomial(*Temp, Product[j] | Factor[k]);
+			}
+
+		for (j = 0; j < MaxNumberOfMonomials / 64; j++)
+			R[j] ^= (*Temp)[j];
+	}
+
+	free(List);
+	free(Product);
+	free(Temp);
+}
+
+unsigned char EvalMonomials(unsigned short* List, unsigned int NumberOfMonomials, unsigned short Vars)
+{
+	unsigned int	i;
+	unsigned char	Value = 0;
+
+	for (i = 0; i < NumberOfMonomials; i++)
+		Value ^= ((Vars & List[i]) == List[i]);
+
+	return(Value);
+}
+
+//-----------------------------------------------------
+
+// a row of a Res_x.csv file for the three share functions given by their 9 component functions, the table being in the
+// order of the coordinate searches (unmasked input, first share, second share)
+void WriteRow(FILE* F, Polynomialstruct* Components)
+{
+	char*			TempStr;
+	unsigned short*	List[9];
+	unsigned int	NumberOfMonomials[9];
+	unsigned short	Vars;
+	unsigned int	j;
+	unsigned char	Share;
+	unsigned char	Value;
+	unsigned char	Letter;
+	unsigned char	Input[3];
+	unsigned char	p;
+
+	TempStr = (char*)malloc(1000000 * sizeof(char));
+	for (p = 0; p < 9; p++)
+	{
+		List[p] = (unsigned short*)malloc(MaxNumberOfMonomials * sizeof(unsigned short));
+		NumberOfMonomials[p] = ListMonomials(Components[p], List[p]);
+	}
+
+	fprintf(F, "012345678");
+	for (Share = 0; Share < 3; Share++)
+	{
+		fprintf(F, ", 0, ");
+		for (p = 0; p < 3; p++)
+		{
+			j = PrintPolynomial(Components[Share * 3 + p], TempStr);
+			fprintf(F, "%d, %s, ", j, TempStr);
+		}
+
+		for (j = 0; j < (1u << (3 * NumberOfBits)); j++)
+		{
+			Input[0] = (j >> NumberOfBits) & (Size - 1);
+			Input[1] = j & (Size - 1);
+			Input[2] = (j >> (2 * NumberOfBits)) ^ Input[0] ^ Input[1];
+
+			Vars = 0;
+			for (Letter = 0; Letter < NumberOfBits; Letter++)
+				for (p = 0; p < 3; p++)
+					Vars |= ((Input[p] >> Letter) & 1) << (Letter * 3 + p);
+
+			Value = 0;
+			for (p = 0; p < 3; p++)
+				Value |= EvalMonomials(List[Share * 3 + p], NumberOfMonomials[Share * 3 + p], Vars) << p;
+
+			fprintf(F, "%x", Value);
+		}
+	}
+
+	fprintf(F, ",\n");
+
+	for (p = 0; p < 9; p++)
+		free(List[p]);
+	free(TempStr);
+}
+
+// the sharings of the cached function G give the sharings of F = Bo(G(Ai(x))): the input affine map is applied to every
+// share (its constant only to the first one), the components of the output bits are added position by position
+void TransformCombinations(const char* Path, unsigned char* Ai, unsigned char* Bo)
+{
+	FILE*				F;
+	FILE*				FOut;
+	char				FileName[1000];
+	char*				TempStr;
+	char*				Field[MaxSize * 18];
+	unsigned char		Bits[MaxSize];
+	const char*			c;
+	Polynomialstruct*	Components[MaxSize];
+	Polynomialstruct*	NewComponents;
+	unsigned int		NumberOfFields;
+	unsigned int		NumberOfRows;
+	unsigned char		NumberOfFileBits;
+	unsigned char		Bit;
+	unsigned char		k;
+	unsigned char		p;
+	char*				s;
+
+	// the output bits of the combination file are the digits after its last '_'
+	c = strrchr(Path, '_');
+	NumberOfFileBits = 0;
+	for (c++; (*c >= '0') && (*c <= '9'); c++)
+		Bits[NumberOfFileBits++] = *c - '0';
+
+	if (NumberOfFileBits != NumberOfBits)
+	{
+		printf("%s does not cover the %d output bits\n", Path, NumberOfBits);
+		return;
+	}
+
+	F = fopen(Path, "rt");
+	if (F == NULL)
+	{
+		printf("%s not found\n", Path);
+		return;
+	}
+
+	for (Bit = 0; Bit < NumberOfBits; Bit++)
+	{
+		Components[Bit] = (Polynomialstruct*)malloc(9 * sizeof(Polynomialstruct));
+		sprintf(FileName, "%s%d.csv", TransformedPath, Bit);
+		FOut = fopen(FileName, "wt");
+		fclose(FOut);
+	}
+
+	NewComponents = (Polynomialstruct*)malloc(9 * sizeof(Polynomialstruct));
+	TempStr = (char*)malloc(1000000 * sizeof(char));
+
+	NumberOfRows = 0;
+	while (fgets(TempStr, 1000000, F) != NULL)
+	{
+		// the non-empty fields are the pairs (number of terms, component) of 9 components per output bit
+		NumberOfFields = 0;
+		for (s = strtok(TempStr, ",\r\n"); (s != NULL) && (NumberOfFields < MaxSize * 18); s = strtok(NULL, ",\r\n"))
+		{
+			while (*s == ' ')
+				s++;
+			if (*s)
+				Field[NumberOfFields++] = s;
+		}
+
+		if (NumberOfFields != (unsigned int)NumberOfBits * 18)
+			continue;
+
+		for (k = 0; k < NumberOfBits; k++)
+			for (p = 0; p < 9; p++)
+				ParsePolynomial(Field[k * 18 + p * 2 + 1], Components[Bits[k]][p]);
+
+		for (Bit = 0; Bit < NumberOfBits; Bit++)
+		{
+			for (p = 0; p < 9; p++)
+			{
+				memset(NewComponents[p], 0, sizeof(Polynomialstruct));
+				for (k = 0; k < NumberOfBits; k++)
+					if (((Bo[1 << k] ^ Bo[0]) >> Bit) & 1)
+						SubstitutePolynomial(Components[k][p], Ai, NewComponents[p]);
+			}
+
+			if ((Bo[0] >> Bit) & 1)
+				ToggleMonomial(NewComponents[0], 0);
+
+			sprintf(FileName, "%s%d.csv", TransformedPath, Bit);
+			FOut = fopen(FileName, "at");
+			WriteRow(FOut, NewComponents);
+			fclose(FOut);
+		}
+
+		NumberOfRows++;
+	}
+
+	fclose(F);
+	printf("%d sharings written to %sx.csv, to be checked by FindCombination\n", NumberOfRows, TransformedPath);
+
+	for (Bit = 0; Bit < NumberOfBits; Bit++)
+		free(Components[Bit]);
+	free(NewComponents);
+	free(TempStr);
+}
+
+//-----------------------------------------------------
+
+int main()
+{
+	FILE*			F;
+	char			Line[1000];
+	char			CachedName[100];
+	char			CachedPath[500];
+	char			CanonicalStr[2 * MaxSize + 1];
+	char			CachedCanonicalStr[2 * MaxSize + 1];
+	char			FunctionStr[2 * MaxSize + 1];
+	char			CachedFunctionStr[2 * MaxSize + 1];
+	unsigned char	Canonical[MaxSize];
+	unsigned char	CachedFunction[MaxSize];
+	unsigned char	CachedCanonical[MaxSize];
+	unsigned char	CachedA[MaxSize];
+	unsigned char	CachedB[MaxSize];
+	unsigned char	InvA[MaxSize];
+	unsigned char	InvB[MaxSize];
+	unsigned char	Ai[MaxSize];
+	unsigned char	Bo[MaxSize];
+	unsigned char	TempAi[MaxSize];
+	unsigned char	TempBo[MaxSize];
+	unsigned int	Weight;
+	unsigned int	BestWeight;
+	unsigned int	k;
+	unsigned char	Found;
+	unsigned char	x;
+
+	Size = 1 << NumberOfBits;
+	NumberOfVars = 3 * NumberOfBits;
+	BestA = (unsigned char(*)[MaxSize])malloc(MaxNumberOfBest * MaxSize * sizeof(unsigned char));
+	BestB = (unsigned char(*)[MaxSize])malloc(MaxNumberOfBest * MaxSize * sizeof(unsigned char));
+
+	CanonicalForm(Function, Canonical);
+
+	// two hex digits per entry, so that 4- and 5-bit functions are kept the same way
+	for (x = 0; x < Size; x++)
+	{
+		sprintf(CanonicalStr + 2 * x, "%02x", Canonical[x]);
+		sprintf(FunctionStr + 2 * x, "%02x", Function[x]);
+	}
+
+	printf("%s: canonical form %s\n", FunctionName, CanonicalStr);
+
+	if (!CheckCanonicalForm(Function, Canonical, NumberOfEquivalenceChecks))
+		return 1;
+
+	//---------------------------------------
+
+	Found = 0;
+	F = fopen(CachePath, "rt");
+	if (F != NULL)
+	{
+		while (fgets(Line, sizeof(Line), F) != NULL)
+			if ((sscanf(Line, "%[^,], %[^,], %[^,], %[^\r\n]", CachedCanonicalStr, CachedName, CachedFunctionStr, CachedPath) == 4) &&
+				(!strcmp(CachedCanonicalStr, CanonicalStr)))
+			{
+				Found = 1;
+				break;
+			}
+
+		fclose(F);
+	}
+
+	if (Found)
+	{
+		printf("class of %s, sharings in %s\n", CachedName, CachedPath);
+
+		for (x = 0; x < Size; x++)
+			sscanf(CachedFunctionStr + 2 * x, "%2hhx", &CachedFunction[x]);
+
+		CanonicalForm(CachedFunction, CachedCanonical);
+		memcpy(CachedA, BestA[0], Size);
+		memcpy(CachedB, BestB[0], Size);
+
+		CanonicalForm(Function, Canonical);
+
+		// Canonical = B(F(A(x))) = CachedB(G(CachedA(x))), so F(x) = Bo(G(Ai(x))) with Ai = CachedA(A^-1) and Bo = B^-1(CachedB),
+		// the maps mixing the fewest bits are taken, the probes of FindCombination see single input bits so only bit permutations
+		// and constants keep the sharings valid for sure
+		BestWeight = -1;
+		for (k = 0; k < NumberOfBest; k++)
+		{
+			Invert(BestA[k], InvA);
+			Invert(BestB[k], InvB);
+			for (x = 0; x < Size; x++)
+			{
+				TempAi[x] = CachedA[InvA[x]];
+				TempBo[x] = InvB[CachedB[x]];
+			}
+
+			Weight = AffineWeight(TempBo) * MaxSize + AffineWeight(TempAi);
+			if (Weight < BestWeight)
+			{
+				BestWeight = Weight;
+				memcpy(Ai, TempAi, Size);
+				memcpy(Bo, TempBo, Size);
+			}
+		}
+
+		for (x = 0; x < Size; x++)
+			if (Function[x] != Bo[CachedFunction[Ai[x]]])
+				break;
+
+		if (x < Size)
+		{
+			printf("error: the affine maps do not match\n");
+			return 1;
+		}
+
+		PrintAffine("input map", Ai);
+		PrintAffine("output map", Bo);
+		TransformCombinations(CachedPath, Ai, Bo);
+	}
+	else
+	{
+		printf("new class, the searches have to run\n");
+
+		if (CombinationPath[0] && ((F = fopen(CombinationPath, "rt")) != NULL))
+		{
+			fclose(F);
+
+			F = fopen(CachePath, "at");
+			fprintf(F, "%s, %s, %s, %s\n", CanonicalStr, FunctionName, FunctionStr, CombinationPath);
+			fclose(F);
+
+			printf("cached with the sharings in %s\n", CombinationPath);
+		}
+	}
+
+	free(BestA);
+	free(BestB);
+
+	printf("done");
+
+	return 0;
+}
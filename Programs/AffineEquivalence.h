@@ -0,0 +1,272 @@
+/*
+* -----------------------------------------------------------------
+* COMPANY : Ruhr University Bochum
+* AUTHOR  : Amir Moradi amir.moradi@rub.de Aein Rezaei Shahmirzadi aein.rezaeishahmirzadi@rub.de
+* DOCUMENT: "Second-Order SCA Security with almost no Fresh Randomness" TCHES 2021, Issue 3
+* -----------------------------------------------------------------
+*
+* Copyright c 2021, Amir Moradi, Aein Rezaei Shahmirzadi
+*
+* All rights reserved.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTERS BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* INCLUDING NEGLIGENCE OR OTHERWISE ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+* Please see LICENSE and README for license and further instructions.
+*/
+
+// affine equivalence of S-boxes shared by FindAffineClass and FindDecomposition, the file including it defines
+// MaxSize, NumberOfBits and Size (the number of entries of the tables) before
+
+#ifndef AFFINE_EQUIVALENCE_H
+#define AFFINE_EQUIVALENCE_H
+
+// the canonical form is the smallest truth table B(F(A(x))) over all affine A and B, A is built column by column, B is the
+// smallest one for the outputs seen so far, a prefix larger than the best one found is not extended
+// all the couples (A, B) giving the canonical form are kept, they differ by the affine self-equivalences of F
+#define	MaxNumberOfBest (1 << 16)
+
+unsigned char	BestTable[MaxSize];
+unsigned char	(*BestA)[MaxSize];
+unsigned char	(*BestB)[MaxSize];
+unsigned int	NumberOfBest;
+unsigned char	BestFound;
+unsigned int	BestChanges; // incremented whenever BestTable is replaced
+
+// the image of Output under the smallest affine B extending Image, where Origin is mapped to 0 and the images of
+// Rank independent outputs are 1, 2, 4, ...
+unsigned char AssignImage(unsigned char Output, unsigned char* Image, unsigned char* Origin, unsigned char* Rank)
+{
+	unsigned char	y;
+	unsigned char	Difference;
+	unsigned char	Defined[MaxSize];
+
+	if (Image[Output] != 0xFF)
+		return(Image[Output]);
+
+	if (*Rank == 0xFF)
+	{
+		*Origin = Output;
+		*Rank = 0;
+		Image[Output] = 0;
+		return(0);
+	}
+
+	Difference = Output ^ *Origin;
+	for (y = 0; y < Size; y++)
+		Defined[y] = (Image[y] != 0xFF);
+
+	for (y = 0; y < Size; y++)
+		if (Defined[y])
+			Image[y ^ Difference] = Image[y] ^ (1 << *Rank);
+
+	(*Rank)++;
+	return(Image[Output]);
+}
+
+// -1, 0 or 1 as the first Length entries of Table are smaller than, equal to or larger than those of BestTable
+char ComparePrefix(const unsigned char* Table, unsigned char Length)
+{
+	unsigned char	x;
+
+	for (x = 0; x < Length; x++)
+		if (Table[x] != BestTable[x])
+			return((Table[x] < BestTable[x]) ? -1 : 1);
+
+	return(0);
+}
+
+// Better tells that Table[0 .. 2^Level - 1] is smaller than the same entries of BestTable, it is taken again from BestTable
+// whenever a leaf below has replaced BestTable
+void CanonicalStep(const unsigned char* F, unsigned char Level, unsigned char* A, unsigned char* Image, unsigned char Origin,
+	unsigned char Rank, unsigned char* Table, unsigned char Better)
+{
+	unsigned char	NewImage[MaxSize];
+	unsigned char	NewOrigin;
+	unsigned char	NewRank;
+	unsigned char	NewBetter;
+	unsigned char	Column;
+	unsigned char	x;
+	unsigned char	y;
+	unsigned int	Changes;
+	char			Order;
+
+	if (Level == NumberOfBits)
+	{
+		Order = BestFound ? ComparePrefix(Table, Size) : -1;
+		if (Order > 0)
+			return;
+
+		if (Order < 0)
+		{
+			NumberOfBest = 0;
+			memcpy(BestTable, Table, Size);
+			BestFound = 1;
+			BestChanges++;
+		}
+
+		if (NumberOfBest < MaxNumberOfBest)
+		{
+			// B is completed for the outputs F does not reach
+			for (y = 0; y < Size; y++)
+				AssignImage(y, Image, &Origin, &Rank);
+
+			memcpy(BestA[NumberOfBest], A, Size);
+			memcpy(BestB[NumberOfBest], Image, Size);
+			NumberOfBest++;
+		}
+
+		return;
+	}
+
+	Changes = BestChanges;
+	for (Column = 1; Column < Size; Column++)
+	{
+		if (Changes != BestChanges)
+		{
+			Order = ComparePrefix(Table, 1 << Level);
+			if (Order > 0)
+				return;
+
+			Better = (Order < 0);
+			Changes = BestChanges;
+		}
+
+		for (x = 0; x < (1 << Level); x++)
+			if ((A[x] ^ A[0]) == Column)
+				break;
+
+		if (x < (1 << Level)) // not independent of the columns chosen so far
+			continue;
+
+		memcpy(NewImage, Image, Size);
+		NewOrigin = Origin;
+		NewRank = Rank;
+		NewBetter = Better;
+
+		for (x = (1 << Level); x < (1 << (Level + 1)); x++)
+		{
+			A[x] = A[x - (1 << Level)] ^ Column;
+			Table[x] = AssignImage(F[A[x]], NewImage, &NewOrigin, &NewRank);
+
+			if (BestFound && (!NewBetter))
+			{
+				if (Table[x] > BestTable[x])
+					break;
+				if (Table[x] < BestTable[x])
+					NewBetter = 1;
+			}
+		}
+
+		if (x == (1 << (Level + 1)))
+			CanonicalStep(F, Level + 1, A, NewImage, NewOrigin, NewRank, Table, NewBetter);
+	}
+}
+
+// Canonical = B(F(A(x))) for every (A, B) in BestA, BestB
+void CanonicalForm(const unsigned char* F, unsigned char* Canonical)
+{
+	unsigned char	TempA[MaxSize];
+	unsigned char	Image[MaxSize];
+	unsigned char	Table[MaxSize];
+	unsigned char	Origin;
+	unsigned char	Rank;
+
+	BestFound = 0;
+	for (TempA[0] = 0; TempA[0] < Size; TempA[0]++)
+	{
+		memset(Image, 0xFF, Size);
+		Rank = 0xFF;
+		Origin = 0;
+		Table[0] = AssignImage(F[TempA[0]], Image, &Origin, &Rank);
+
+		CanonicalStep(F, 0, TempA, Image, Origin, Rank, Table, 0);
+	}
+
+	memcpy(Canonical, BestTable, Size);
+}
+
+void Invert(unsigned char* Table, unsigned char* Inverse)
+{
+	unsigned char	x;
+
+	for (x = 0; x < Size; x++)
+		Inverse[Table[x]] = x;
+}
+
+unsigned char BitCount(unsigned int x)
+{
+	unsigned char	Count = 0;
+
+	while (x)
+	{
+		x &= x - 1;
+		Count++;
+	}
+
+	return(Count);
+}
+
+// a random affine permutation, built column by column as in CanonicalStep
+void RandomAffine(unsigned char* Table)
+{
+	unsigned char	Level;
+	unsigned char	Column;
+	unsigned char	x;
+
+	Table[0] = rand() % Size;
+	for (Level = 0; Level < NumberOfBits; Level++)
+	{
+		do
+		{
+			Column = 1 + rand() % (Size - 1);
+			for (x = 0; x < (1 << Level); x++)
+				if ((Table[x] ^ Table[0]) == Column)
+					break;
+		} while (x < (1 << Level));
+
+		for (x = 0; x < (1 << Level); x++)
+			Table[x + (1 << Level)] = Table[x] ^ Column;
+	}
+}
+
+// the canonical form has to be the same for every function in the class of F, checked on NumberOfChecks random A(F(B(x)))
+unsigned char CheckCanonicalForm(const unsigned char* F, unsigned char* Canonical, unsigned int NumberOfChecks)
+{
+	unsigned char	A[MaxSize];
+	unsigned char	B[MaxSize];
+	unsigned char	G[MaxSize];
+	unsigned char	GCanonical[MaxSize];
+	unsigned int	k;
+	unsigned char	x;
+
+	for (k = 0; k < NumberOfChecks; k++)
+	{
+		RandomAffine(A);
+		RandomAffine(B);
+		for (x = 0; x < Size; x++)
+			G[x] = A[F[B[x]]];
+
+		CanonicalForm(G, GCanonical);
+		if (memcmp(GCanonical, Canonical, Size))
+		{
+			printf("error: the canonical form of");
+			for (x = 0; x < Size; x++)
+				printf(" %x", G[x]);
+			printf(" differs\n");
+			return(0);
+		}
+	}
+
+	return(1);
+}
+
+#endif
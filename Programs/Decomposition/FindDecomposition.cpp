@@ -0,0 +1,1135 @@
+/*
+* -----------------------------------------------------------------
+* COMPANY : Ruhr University Bochum
+* AUTHOR  : Amir Moradi amir.moradi@rub.de Aein Rezaei Shahmirzadi aein.rezaeishahmirzadi@rub.de
+* DOCUMENT: "Second-Order SCA Security with almost no Fresh Randomness" TCHES 2021, Issue 3
+* -----------------------------------------------------------------
+*
+* Copyright c 2021, Amir Moradi, Aein Rezaei Shahmirzadi
+*
+* All rights reserved.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTERS BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* INCLUDING NEGLIGENCE OR OTHERWISE ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+* Please see LICENSE and README for license and further instructions.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <omp.h>
+
+// the S-box is given by its truth table, bit i of the input being the variable 'a' + i as in the coordinate searches
+const unsigned char	NumberOfBits = 4; // 4 or 5, three stages are searched for 4 bits only
+const unsigned char	Sbox[1 << 5] = { 0xc, 0x5, 0x6, 0xb, 0x9, 0x0, 0xa, 0xd, 0x3, 0xe, 0xf, 0x8, 0x4, 0x7, 0x1, 0x2 }; // PRESENT
+const char			SboxName[100] = "PRESENT";
+const unsigned char	MaxNumberOfStages = 3; // 2 or 3
+const unsigned char	ThreeStagesOnlyIfNeeded = 1; // three stages are searched only if there is no decomposition with two
+const unsigned int	MaxNumberOfPrinted = 10; // the cheapest decompositions written to Decomposition_<SboxName>.txt
+const unsigned int	NumberOfEquivalenceChecks = 100; // random A(Sbox(B(x))) whose canonical form has to be the one of Sbox
+
+// the stages of a decomposition of Sbox whose sharings are known are reused for the inverse S-box, the stages of the
+// inverse in their classes need no search and cost nothing in the ranking of Decomposition_<SboxName>_inverse.txt
+const unsigned char	DeriveInverse = 0;
+const unsigned int	ForwardDecomposition = 0; // the one of the printed decompositions of Sbox the sharings belong to
+const char			StageSharingPaths[3][500] = { "", "", "" }; // Res_0123.csv of the stages F, G, H, empty if not shared yet
+
+// the front of fresh bits against the number of stages: a stage takes the fresh bits of the sharings of its class in
+// the cache of FindAffineClass (the fewest of a FindCombination search with MaxRefreshedBits, 0 for rows found without
+// refreshing), a decomposition their sum; for 1, 2 and 3 stages, the cheapest decomposition with the fewest fresh bits
+// is written to Decomposition_<SboxName>_front.txt if it takes fewer than the ones with fewer stages; empty: not made,
+// otherwise three stages are searched even with decompositions of two
+const char			CachePath[500] = ""; // "../Affine Classes/AffineClasses.csv"
+
+// the kinds of coordinate functions the coordinate searches are written for, with a program to start from
+// 0: x, 1: x ^ y, 2: x & y ^ z (^ x) (^ y), 3: x & y ^ x & z ^ z, 4: x & y ^ x & z ^ z ^ t
+const unsigned int	KindCost[5] = { 0, 1, 8, 10, 12 }; // estimated search cost, the quadratic ones run over all the Type orderings
+const char			KindProgram[5][100] = {
+	"Skinny Sbox/finding F/FindCoordinateFunction0.cpp",
+	"PRINCE Sbox Inverse/finding G/FindCoordinateFunction1.cpp",
+	"PRESENT Sbox/finding F/FindCoordinateFunction0.cpp",
+	"PRESENT Sbox/finding F/FindCoordinateFunction2.cpp",
+	"PRESENT Sbox/finding F/FindCoordinateFunction3.cpp" };
+
+#define	MaxSize (1 << 5)
+#define	MaxNumberOfBits 5
+#define	MaxNumberOfCoordinates 512
+#define	MaxNumberOfClasses 4096
+#define	MaxNumberOfInvariants 4096
+#define	MaxNumberOfDecompositions (1 << 16)
+
+typedef struct {
+	unsigned char	Kind;
+	unsigned char	Vars[4]; // x, y, z, t
+	unsigned char	Linear; // for kind 2, bit 0: ^ x, bit 1: ^ y
+	uint32_t		Truth; // bit x is the value at the input x
+} Coordinatestruct;
+
+// the stage functions are kept by affine class, with the cheapest member made of coordinates of the kinds above
+typedef struct {
+	unsigned short	Coordinates[MaxNumberOfBits];
+	unsigned char	Table[MaxSize];
+	unsigned char	Inverse[MaxSize];
+	unsigned int	Cost;
+	uint64_t		Invariant;
+} Classstruct;
+
+// S = Affine[NumberOfStages] o Stage[NumberOfStages - 1] o ... o Affine[1] o Stage[0] o Affine[0]
+typedef struct {
+	unsigned char	NumberOfStages;
+	unsigned short	Stages[3];
+	unsigned char	Affine[4][MaxSize];
+	unsigned int	Cost;
+} Decompositionstruct;
+
+unsigned char		Size;
+unsigned char		InverseSbox[MaxSize];
+const char*			SharedPath[MaxNumberOfClasses];
+int					FreshBits[MaxNumberOfClasses]; // -2 not looked up yet, -1 no sharing in CachePath
+char*				FreshBitsPath[MaxNumberOfClasses];
+Coordinatestruct	Coordinates[MaxNumberOfCoordinates];
+unsigned int		NumberOfCoordinates;
+Classstruct*		Classes;
+unsigned int		NumberOfClasses;
+unsigned char		(*LinearColumns)[MaxNumberOfBits];
+unsigned int		NumberOfLinear;
+Decompositionstruct*	Decompositions;
+unsigned int		NumberOfDecompositions;
+
+//-----------------------------------------------------
+
+#include "../AffineEquivalence.h"
+
+void PrintAffine(FILE* F, const char* Name, unsigned char* Table)
+{
+	unsigned char	i, j;
+
+	fprintf(F, "%s: constant %x, matrix rows", Name, Table[0]);
+	for (i = 0; i < NumberOfBits; i++)
+	{
+		fprintf(F, " ");
+		for (j = 0; j < NumberOfBits; j++)
+			fprintf(F, "%d", ((Table[1 << j] ^ Table[0]) >> i) & 1);
+	}
+	fprintf(F, "\n");
+}
+
+//-----------------------------------------------------
+
+void AddCoordinate(unsigned char Kind, unsigned char x, unsigned char y, unsigned char z, unsigned char t, unsigned char Linear)
+{
+	Coordinatestruct*	C = &Coordinates[NumberOfCoordinates++];
+	unsigned char		In;
+	unsigned char		v[4];
+	unsigned char		Value;
+
+	C->Kind = Kind;
+	C->Vars[0] = x;
+	C->Vars[1] = y;
+	C->Vars[2] = z;
+	C->Vars[3] = t;
+	C->Linear = Linear;
+	C->Truth = 0;
+
+	for (In = 0; In < Size; In++)
+	{
+		v[0] = (In >> x) & 1;
+		v[1] = (In >> y) & 1;
+		v[2] = (In >> z) & 1;
+		v[3] = (In >> t) & 1;
+
+		if (Kind == 0)
+			Value = v[0];
+		else if (Kind == 1)
+			Value = v[0] ^ v[1];
+		else if (Kind == 2)
+			Value = (v[0] & v[1]) ^ v[2] ^ (v[0] & Linear) ^ (v[1] & (Linear >> 1));
+		else if (Kind == 3)
+			Value = (v[0] & v[1]) ^ (v[0] & v[2]) ^ v[2];
+		else
+			Value = (v[0] & v[1]) ^ (v[0] & v[2]) ^ v[2] ^ v[3];
+
+		C->Truth |= (uint32_t)Value << In;
+	}
+}
+
+// all the coordinate functions the searches can be run for, without constant (it is taken by the next affine map)
+void FillCoordinates()
+{
+	unsigned char	x, y, z, t;
+	unsigned char	Linear;
+
+	NumberOfCoordinates = 0;
+	for (x = 0; x < NumberOfBits; x++)
+	{
+		AddCoordinate(0, x, x, x, x, 0);
+
+		for (y = x + 1; y < NumberOfBits; y++)
+		{
+			AddCoordinate(1, x, y, y, y, 0);
+
+			for (z = 0; z < NumberOfBits; z++)
+				if ((z != x) && (z != y))
+					for (Linear = 0; Linear < 4; Linear++)
+						AddCoordinate(2, x, y, z, z, Linear);
+		}
+
+		for (y = 0; y < NumberOfBits; y++)
+			for (z = 0; z < NumberOfBits; z++)
+				if ((y != x) && (z != x) && (z != y))
+				{
+					AddCoordinate(3, x, y, z, z, 0);
+
+					for (t = 0; t < NumberOfBits; t++)
+						if ((t != x) && (t != y) && (t != z))
+							AddCoordinate(4, x, y, z, t, 0);
+				}
+	}
+}
+
+//-----------------------------------------------------
+
+// the histograms of the difference distribution and of the absolute linear approximation tables, invariant under
+// affine equivalence, hashed (FNV-1a) to tell the classes apart
+uint64_t Invariant(const unsigned char* F)
+{
+	unsigned short	Histogram[2 * MaxSize + 1];
+	unsigned char	Count[MaxSize];
+	short			Walsh[MaxSize];
+	uint32_t		Support[MaxSize];
+	short			u, v;
+	unsigned char	a, b, x;
+	unsigned char	j;
+	unsigned short	i;
+	uint64_t		Hash = 14695981039346656037ULL;
+
+	memset(Histogram, 0, sizeof(Histogram));
+	for (a = 1; a < Size; a++)
+	{
+		memset(Count, 0, Size);
+		for (x = 0; x < Size; x++)
+			Count[F[x] ^ F[x ^ a]]++;
+
+		for (b = 0; b < Size; b++)
+			Histogram[Count[b]]++;
+	}
+
+	for (i = 0; i <= Size; i++)
+		Hash = (Hash ^ Histogram[i]) * 1099511628211ULL;
+
+	memset(Histogram, 0, sizeof(Histogram));
+	for (b = 1; b < Size; b++)
+	{
+		for (x = 0; x < Size; x++)
+			Walsh[x] = (BitCount(F[x] & b) & 1) ? -1 : 1;
+
+		for (j = 1; j < Size; j <<= 1)
+			for (x = 0; x < Size; x++)
+				if (!(x & j))
+				{
+					u = Walsh[x];
+					v = Walsh[x | j];
+					Walsh[x] = u + v;
+					Walsh[x | j] = u - v;
+				}
+
+		for (x = 0; x < Size; x++)
+			Histogram[(Walsh[x] < 0) ? -Walsh[x] : Walsh[x]]++;
+	}
+
+	for (i = 0; i <= 2 * Size; i++)
+		Hash = (Hash ^ Histogram[i]) * 1099511628211ULL;
+
+	// the overlaps of the supports of the rows of the difference distribution table, which tell apart classes with
+	// the same spectra
+	for (a = 1; a < Size; a++)
+	{
+		Support[a] = 0;
+		for (x = 0; x < Size; x++)
+			Support[a] |= (uint32_t)1 << (F[x] ^ F[x ^ a]);
+	}
+
+	memset(Histogram, 0, sizeof(Histogram));
+	for (a = 1; a < Size; a++)
+		for (b = a + 1; b < Size; b++)
+			Histogram[BitCount(Support[a] & Support[b])]++;
+
+	for (i = 0; i <= Size; i++)
+		Hash = (Hash ^ Histogram[i]) * 1099511628211ULL;
+
+	return(Hash);
+}
+
+// the algebraic normal form is made for all the output bits at once, monomials of degree above 2 have to be zero
+unsigned char IsQuadratic(const unsigned char* F)
+{
+	unsigned char	ANF[MaxSize];
+	unsigned char	j;
+	unsigned char	x;
+
+	memcpy(ANF, F, Size);
+	for (j = 1; j < Size; j <<= 1)
+		for (x = 0; x < Size; x++)
+			if (x & j)
+				ANF[x] ^= ANF[x ^ j];
+
+	for (x = 0; x < Size; x++)
+		if (ANF[x] && (BitCount(x) > 2))
+			return(0);
+
+	return(1);
+}
+
+unsigned char IsAffine(const unsigned char* F)
+{
+	unsigned char	x;
+	unsigned char	j;
+
+	for (x = 0; x < Size; x++)
+	{
+		unsigned char	Value = F[0];
+
+		for (j = 0; j < NumberOfBits; j++)
+			if ((x >> j) & 1)
+				Value ^= F[1 << j] ^ F[0];
+
+		if (F[x] != Value)
+			return(0);
+	}
+
+	return(1);
+}
+
+//-----------------------------------------------------
+
+// coordinates are taken in increasing order (their order is taken by the next affine map), the outputs of the chosen
+// ones have to stay balanced to end in a permutation
+void EnumerateStages(unsigned char Level, unsigned short Start, unsigned short* Chosen, unsigned char* Partial, unsigned int Cost)
+{
+	unsigned char	NewPartial[MaxSize];
+	unsigned char	Count[MaxSize];
+	unsigned char	Table[MaxSize];
+	unsigned short	c;
+	unsigned int	i;
+	unsigned char	x;
+	uint64_t		Inv;
+
+	if (Level == NumberOfBits)
+	{
+		memcpy(Table, Partial, Size);
+		if (IsAffine(Table))
+			return;
+
+		Inv = Invariant(Table);
+
+		#pragma omp critical (classes)
+		{
+			for (i = 0; i < NumberOfClasses; i++)
+				if (Classes[i].Invariant == Inv)
+					break;
+
+			if ((i == NumberOfClasses) && (NumberOfClasses < MaxNumberOfClasses))
+			{
+				Classes[i].Invariant = Inv;
+				Classes[i].Cost = -1;
+				NumberOfClasses++;
+			}
+
+			if ((i < NumberOfClasses) && (Cost < Classes[i].Cost))
+			{
+				Classes[i].Cost = Cost;
+				memcpy(Classes[i].Coordinates, Chosen, NumberOfBits * sizeof(unsigned short));
+				memcpy(Classes[i].Table, Table, Size);
+				for (x = 0; x < Size; x++)
+					Classes[i].Inverse[Table[x]] = x;
+			}
+		}
+
+		return;
+	}
+
+	for (c = Start; c < NumberOfCoordinates; c++)
+	{
+		memset(Count, 0, Size);
+		for (x = 0; x < Size; x++)
+		{
+			NewPartial[x] = Partial[x] | (((Coordinates[c].Truth >> x) & 1) << Level);
+			Count[NewPartial[x]]++;
+		}
+
+		for (x = 0; x < (2 << Level); x++)
+			if (Count[x] != (Size >> (Level + 1)))
+				break;
+
+		if (x == (2 << Level))
+		{
+			Chosen[Level] = c;
+			EnumerateStages(Level + 1, c + 1, Chosen, NewPartial, Cost + KindCost[Coordinates[c].Kind]);
+		}
+	}
+}
+
+void FillClasses()
+{
+	unsigned int	First;
+
+	NumberOfClasses = 0;
+
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (First = 0; First < NumberOfCoordinates; First++)
+	{
+		unsigned short	Chosen[MaxNumberOfBits];
+		unsigned char	Partial[MaxSize];
+		unsigned char	x;
+
+		for (x = 0; x < Size; x++)
+			Partial[x] = (Coordinates[First].Truth >> x) & 1;
+
+		Chosen[0] = First;
+		EnumerateStages(1, First + 1, Chosen, Partial, KindCost[Coordinates[First].Kind]);
+	}
+}
+
+//-----------------------------------------------------
+
+void FillLinear(unsigned char Level, unsigned char* Columns, uint32_t Span)
+{
+	unsigned char	Column;
+	unsigned char	x;
+	uint32_t		NewSpan;
+
+	if (Level == NumberOfBits)
+	{
+		memcpy(LinearColumns[NumberOfLinear++], Columns, NumberOfBits);
+		return;
+	}
+
+	for (Column = 1; Column < Size; Column++)
+		if (!((Span >> Column) & 1))
+		{
+			NewSpan = Span;
+			for (x = 0; x < Size; x++)
+				if ((Span >> x) & 1)
+					NewSpan |= (uint32_t)1 << (x ^ Column);
+
+			Columns[Level] = Column;
+			FillLinear(Level + 1, Columns, NewSpan);
+		}
+}
+
+// the affine maps are numbered by their linear part and their constant
+void MakeAffine(unsigned int Index, unsigned char* Table)
+{
+	unsigned char*	Columns = LinearColumns[Index / Size];
+	unsigned char	j;
+	unsigned char	x;
+
+	Table[0] = Index % Size;
+	for (j = 0; j < NumberOfBits; j++)
+		for (x = 0; x < (1 << j); x++)
+			Table[x | (1 << j)] = Table[x] ^ Columns[j];
+}
+
+//-----------------------------------------------------
+
+// H = B(Class(A)) found through the canonical forms, 0 if H has the invariant of the class but is not in it
+unsigned char MatchClass(const unsigned char* H, unsigned short Class, unsigned char* A, unsigned char* B)
+{
+	unsigned char	HCanonical[MaxSize];
+	unsigned char	HAInv[MaxSize];
+	unsigned char	HBInv[MaxSize];
+	unsigned char	GCanonical[MaxSize];
+	unsigned char	GA[MaxSize];
+	unsigned char	GB[MaxSize];
+	unsigned char	x;
+
+	// H = HB^-1(Canonical(HA^-1)) and Class = GB^-1(Canonical(GA^-1))
+	CanonicalForm(H, HCanonical);
+	Invert(BestA[0], HAInv);
+	Invert(BestB[0], HBInv);
+
+	CanonicalForm(Classes[Class].Table, GCanonical);
+	memcpy(GA, BestA[0], Size);
+	memcpy(GB, BestB[0], Size);
+
+	if (memcmp(HCanonical, GCanonical, Size))
+		return(0);
+
+	for (x = 0; x < Size; x++)
+	{
+		A[x] = GA[HAInv[x]];
+		B[x] = HBInv[GB[x]];
+	}
+
+	for (x = 0; x < Size; x++)
+		if (H[x] != B[Classes[Class].Table[A[x]]])
+		{
+			printf("error: the affine maps of class %d do not match\n", Class);
+			return(0);
+		}
+
+	return(1);
+}
+
+// T = Affine[2] o Second o Affine[1] o First o Affine[0] for the stage classes First and Second, found as the affine D making
+// H = T o D o First^-1 quadratic and in the class of Second, one decomposition per couple of classes is kept
+unsigned int DecomposeTwo(const unsigned char* T, Decompositionstruct* Found, unsigned int MaxNumberOfFound)
+{
+	unsigned int*	PairIndex;
+	unsigned int	NumberOfAffine;
+	unsigned int	NumberOfFound;
+	unsigned int	Index;
+	unsigned short	First;
+	unsigned short	Second;
+	unsigned char	D[MaxSize];
+	unsigned char	H[MaxSize];
+	unsigned char	x;
+
+	NumberOfAffine = NumberOfLinear * Size;
+	PairIndex = (unsigned int*)malloc(NumberOfClasses * NumberOfClasses * sizeof(unsigned int));
+	memset(PairIndex, 0xFF, NumberOfClasses * NumberOfClasses * sizeof(unsigned int));
+
+	for (First = 0; First < NumberOfClasses; First++)
+	{
+		#pragma omp parallel for schedule(dynamic, 1024) private(D, H, x, Second)
+		for (Index = 0; Index < NumberOfAffine; Index++)
+		{
+			uint64_t	Inv;
+
+			MakeAffine(Index, D);
+			for (x = 0; x < Size; x++)
+				H[x] = T[D[Classes[First].Inverse[x]]];
+
+			if (!IsQuadratic(H))
+				continue;
+
+			Inv = Invariant(H);
+			for (Second = 0; Second < NumberOfClasses; Second++)
+				if (Classes[Second].Invariant == Inv)
+					break;
+
+			if (Second == NumberOfClasses)
+				continue;
+
+			#pragma omp critical (pairs)
+			{
+				if (PairIndex[First * NumberOfClasses + Second] > Index)
+					PairIndex[First * NumberOfClasses + Second] = Index;
+			}
+		}
+	}
+
+	NumberOfFound = 0;
+	for (First = 0; First < NumberOfClasses; First++)
+		for (Second = 0; Second < NumberOfClasses; Second++)
+			if ((PairIndex[First * NumberOfClasses + Second] != 0xFFFFFFFF) && (NumberOfFound < MaxNumberOfFound))
+			{
+				MakeAffine(PairIndex[First * NumberOfClasses + Second], D);
+				for (x = 0; x < Size; x++)
+					H[x] = T[D[Classes[First].Inverse[x]]];
+
+				if (!MatchClass(H, Second, Found[NumberOfFound].Affine[1], Found[NumberOfFound].Affine[2]))
+					continue;
+
+				Found[NumberOfFound].NumberOfStages = 2;
+				Found[NumberOfFound].Stages[0] = First;
+				Found[NumberOfFound].Stages[1] = Second;
+				Invert(D, Found[NumberOfFound].Affine[0]);
+				Found[NumberOfFound].Cost = Classes[First].Cost + Classes[Second].Cost;
+				NumberOfFound++;
+			}
+
+	free(PairIndex);
+
+	return(NumberOfFound);
+}
+
+// the invariants of all Third o B o Second for affine B, a function with another invariant has no two-stage decomposition
+unsigned int FillTwoStageInvariants(uint64_t* TwoStageInvariants)
+{
+	unsigned int	NumberOfInvariants = 0;
+	unsigned int	NumberOfAffine = NumberOfLinear * Size;
+	unsigned int	Pair;
+
+	#pragma omp parallel
+	{
+		uint64_t		Local[MaxNumberOfInvariants];
+		unsigned int	NumberOfLocal = 0;
+		unsigned int	Index;
+		unsigned int	i, j;
+		unsigned char	B[MaxSize];
+		unsigned char	T[MaxSize];
+		unsigned char	x;
+		uint64_t		Inv;
+
+		#pragma omp for schedule(dynamic, 1) private(Pair)
+		for (Pair = 0; Pair < NumberOfClasses * NumberOfClasses; Pair++)
+			for (Index = 0; Index < NumberOfAffine; Index++)
+			{
+				MakeAffine(Index, B);
+				for (x = 0; x < Size; x++)
+					T[x] = Classes[Pair % NumberOfClasses].Table[B[Classes[Pair / NumberOfClasses].Table[x]]];
+
+				Inv = Invariant(T);
+				for (i = 0; i < NumberOfLocal; i++)
+					if (Local[i] == Inv)
+						break;
+
+				if ((i == NumberOfLocal) && (NumberOfLocal < MaxNumberOfInvariants))
+					Local[NumberOfLocal++] = Inv;
+			}
+
+		#pragma omp critical (invariants)
+		{
+			for (i = 0; i < NumberOfLocal; i++)
+			{
+				for (j = 0; j < NumberOfInvariants; j++)
+					if (TwoStageInvariants[j] == Local[i])
+						break;
+
+				if ((j == NumberOfInvariants) && (NumberOfInvariants < MaxNumberOfInvariants))
+					TwoStageInvariants[NumberOfInvariants++] = Local[i];
+			}
+		}
+	}
+
+	return(NumberOfInvariants);
+}
+
+// S = T o First o D^-1 with T decomposed in two stages, for each first stage one T per invariant is tried
+void DecomposeThree(const unsigned char* S)
+{
+	uint64_t*				TwoStageInvariants;
+	uint64_t*				Tried;
+	unsigned int*			TriedIndex;
+	unsigned int			NumberOfTried;
+	unsigned int			NumberOfInvariants;
+	unsigned int			NumberOfAffine;
+	unsigned int			NumberOfFound;
+	unsigned int			Index;
+	unsigned int			i, k;
+	unsigned short			First;
+	unsigned char			D[MaxSize];
+	unsigned char			T[MaxSize];
+	unsigned char			x;
+	Decompositionstruct*	Found;
+
+	TwoStageInvariants = (uint64_t*)malloc(MaxNumberOfInvariants * sizeof(uint64_t));
+	Tried = (uint64_t*)malloc(MaxNumberOfInvariants * sizeof(uint64_t));
+	TriedIndex = (unsigned int*)malloc(MaxNumberOfInvariants * sizeof(unsigned int));
+	Found = (Decompositionstruct*)malloc(MaxNumberOfDecompositions * sizeof(Decompositionstruct));
+
+	NumberOfInvariants = FillTwoStageInvariants(TwoStageInvariants);
+	printf("%d invariants of two-stage functions\n", NumberOfInvariants);
+
+	NumberOfAffine = NumberOfLinear * Size;
+	for (First = 0; First < NumberOfClasses; First++)
+	{
+		NumberOfTried = 0;
+
+		#pragma omp parallel for schedule(dynamic, 1024) private(D, T, x, i)
+		for (Index = 0; Index < NumberOfAffine; Index++)
+		{
+			uint64_t	Inv;
+
+			MakeAffine(Index, D);
+			for (x = 0; x < Size; x++)
+				T[x] = S[D[Classes[First].Inverse[x]]];
+
+			Inv = Invariant(T);
+			for (i = 0; i < NumberOfInvariants; i++)
+				if (TwoStageInvariants[i] == Inv)
+					break;
+
+			if (i == NumberOfInvariants)
+				continue;
+
+			#pragma omp critical (tried)
+			{
+				for (i = 0; i < NumberOfTried; i++)
+					if (Tried[i] == Inv)
+						break;
+
+				if ((i == NumberOfTried) && (NumberOfTried < MaxNumberOfInvariants))
+				{
+					Tried[NumberOfTried] = Inv;
+					TriedIndex[NumberOfTried++] = Index;
+				}
+				else if ((i < NumberOfTried) && (Index < TriedIndex[i])) // the same T whatever the order of the threads
+					TriedIndex[i] = Index;
+			}
+		}
+
+		for (i = 0; i < NumberOfTried; i++)
+		{
+			MakeAffine(TriedIndex[i], D);
+			for (x = 0; x < Size; x++)
+				T[x] = S[D[Classes[First].Inverse[x]]];
+
+			NumberOfFound = DecomposeTwo(T, Found, MaxNumberOfDecompositions);
+			for (k = 0; (k < NumberOfFound) && (NumberOfDecompositions < MaxNumberOfDecompositions); k++)
+			{
+				Decompositionstruct*	New = &Decompositions[NumberOfDecompositions++];
+
+				New->NumberOfStages = 3;
+				New->Stages[0] = First;
+				New->Stages[1] = Found[k].Stages[0];
+				New->Stages[2] = Found[k].Stages[1];
+				Invert(D, New->Affine[0]);
+				memcpy(New->Affine[1], Found[k].Affine[0], Size);
+				memcpy(New->Affine[2], Found[k].Affine[1], Size);
+				memcpy(New->Affine[3], Found[k].Affine[2], Size);
+				New->Cost = Classes[First].Cost + Found[k].Cost;
+			}
+		}
+
+		printf("first stage %d/%d, %d decompositions\n", First + 1, NumberOfClasses, NumberOfDecompositions);
+	}
+
+	free(TwoStageInvariants);
+	free(Tried);
+	free(TriedIndex);
+	free(Found);
+}
+
+//-----------------------------------------------------
+
+// the composition of the stages and maps has to give back the S-box
+unsigned char CheckDecomposition(Decompositionstruct* D, const unsigned char* S)
+{
+	unsigned char	x;
+	unsigned char	y;
+	unsigned char	s;
+
+	for (x = 0; x < Size; x++)
+	{
+		y = D->Affine[0][x];
+		for (s = 0; s < D->NumberOfStages; s++)
+			y = D->Affine[s + 1][Classes[D->Stages[s]].Table[y]];
+
+		if (y != S[x])
+			return(0);
+	}
+
+	return(1);
+}
+
+int CompareDecompositions(const void* a, const void* b)
+{
+	const Decompositionstruct*	A = (const Decompositionstruct*)a;
+	const Decompositionstruct*	B = (const Decompositionstruct*)b;
+
+	if (A->Cost != B->Cost)
+		return((A->Cost < B->Cost) ? -1 : 1);
+
+	if (A->NumberOfStages != B->NumberOfStages)
+		return((int)A->NumberOfStages - (int)B->NumberOfStages);
+
+	return(memcmp(A->Stages, B->Stages, sizeof(A->Stages)));
+}
+
+// the coordinate functions of each stage with the lines to set in the coordinate search of their kind
+void PrintDecomposition(FILE* F, Decompositionstruct* D)
+{
+	Coordinatestruct*	C;
+	char				Name[100];
+	char				Var[4];
+	unsigned char		s;
+	unsigned char		i;
+	unsigned char		j;
+
+	fprintf(F, "estimated cost %d, %d stages\n", D->Cost, D->NumberOfStages);
+	PrintAffine(F, "input map", D->Affine[0]);
+
+	for (s = 0; s < D->NumberOfStages; s++)
+	{
+		if (SharedPath[D->Stages[s]] != NULL)
+			fprintf(F, "stage %c, sharing reused from %s\n", 'F' + s, SharedPath[D->Stages[s]]);
+		else
+			fprintf(F, "stage %c (cost %d):\n", 'F' + s, Classes[D->Stages[s]].Cost);
+
+		for (i = 0; (i < NumberOfBits) && (SharedPath[D->Stages[s]] == NULL); i++)
+		{
+			C = &Coordinates[Classes[D->Stages[s]].Coordinates[i]];
+			for (j = 0; j < 4; j++)
+				Var[j] = 'a' + C->Vars[j];
+
+			fprintf(F, "  output bit %d from %s\n", i, KindProgram[C->Kind]);
+			if (C->Kind == 0)
+				fprintf(F, "    SelectedVarIndexes[0] = %d;  //%c\n", C->Vars[0], Var[0]);
+			else if (C->Kind == 1)
+				fprintf(F, "    SelectedVarIndexes[0] = %d;  //%c\n    SelectedVarIndexes[1] = %d;  //%c -> %c + %c\n",
+					C->Vars[0], Var[0], C->Vars[1], Var[1], Var[0], Var[1]);
+			else
+			{
+				if (C->Kind == 2)
+					fprintf(F, "    TargetFunc[xyz] = x & y ^ z%s%s;\n", (C->Linear & 1) ? " ^ x" : "", (C->Linear & 2) ? " ^ y" : "");
+				else
+					fprintf(F, "    TargetFunc[xyz] = x & y ^ x & z ^ z;\n");
+
+				if (C->Kind == 2)
+				{
+					sprintf(Name, "%c%c + %c", Var[0], Var[1], Var[2]);
+					if (C->Linear & 1)
+						sprintf(Name + strlen(Name), " + %c", Var[0]);
+					if (C->Linear & 2)
+						sprintf(Name + strlen(Name), " + %c", Var[1]);
+				}
+				else
+					sprintf(Name, "%c%c + %c%c + %c", Var[0], Var[1], Var[0], Var[2], Var[2]);
+
+				if (C->Kind == 4)
+					sprintf(Name + strlen(Name), " + %c", Var[3]);
+
+				fprintf(F, "    SelectedVarIndexes[0] = %d;  //%c\n", C->Vars[0], Var[0]);
+				fprintf(F, "    SelectedVarIndexes[1] = %d;  //%c\n", C->Vars[1], Var[1]);
+				fprintf(F, "    SelectedVarIndexes[2] = %d;  //%c%s%s\n", C->Vars[2], Var[2], (C->Kind == 4) ? "" : "  -> ", (C->Kind == 4) ? "" : Name);
+				if (C->Kind == 4)
+					fprintf(F, "    SelectedVarIndexes[3] = %d;  //%c  -> %s\n", C->Vars[3], Var[3], Name);
+			}
+		}
+
+		sprintf(Name, "map after stage %c", 'F' + s);
+		PrintAffine(F, Name, D->Affine[s + 1]);
+	}
+
+	fprintf(F, "\n");
+}
+
+// S^-1 = Affine[0]^-1 o Stage[0]^-1 o ... o Stage[n - 1]^-1 o Affine[n]^-1 where every Stage^-1 = B(Class(A)) has to be
+// quadratic and in one of the classes, so the maps of the inverse are Affine'[k] = A(Affine[n - k]^-1(B))
+unsigned char InvertDecomposition(Decompositionstruct* D, Decompositionstruct* Inv)
+{
+	unsigned char	A[3][MaxSize];
+	unsigned char	B[3][MaxSize];
+	unsigned char	AffineInv[MaxSize];
+	unsigned char	n = D->NumberOfStages;
+	unsigned char	s;
+	unsigned char	k;
+	unsigned char	x;
+	unsigned short	c;
+
+	for (s = 0; s < n; s++)
+	{
+		if (!IsQuadratic(Classes[D->Stages[s]].Inverse))
+			return(0);
+
+		for (c = 0; c < NumberOfClasses; c++)
+			if (Classes[c].Invariant == Invariant(Classes[D->Stages[s]].Inverse))
+				break;
+
+		if ((c == NumberOfClasses) || (!MatchClass(Classes[D->Stages[s]].Inverse, c, A[s], B[s])))
+			return(0);
+
+		Inv->Stages[n - 1 - s] = c;
+	}
+
+	Inv->NumberOfStages = n;
+	Inv->Cost = 0;
+	for (k = 0; k <= n; k++)
+	{
+		Invert(D->Affine[n - k], AffineInv);
+		for (x = 0; x < Size; x++)
+			Inv->Affine[k][x] = AffineInv[(k == 0) ? x : B[n - k][x]];
+
+		if (k < n)
+			for (x = 0; x < Size; x++)
+				Inv->Affine[k][x] = A[n - 1 - k][Inv->Affine[k][x]];
+	}
+
+	for (s = 0; s < n; s++)
+		if (SharedPath[Inv->Stages[s]] == NULL)
+			Inv->Cost += Classes[Inv->Stages[s]].Cost;
+
+	return(1);
+}
+
+void SearchDecompositions(const unsigned char* S, const char* Name)
+{
+	if (IsQuadratic(S))
+		printf("%s is already quadratic\n", Name);
+
+	NumberOfDecompositions = DecomposeTwo(S, Decompositions, MaxNumberOfDecompositions);
+	printf("%s: %d two-stage decompositions\n", Name, NumberOfDecompositions);
+
+	if ((MaxNumberOfStages == 3) && (NumberOfBits == 4) && ((!ThreeStagesOnlyIfNeeded) || (NumberOfDecompositions == 0) || CachePath[0]))
+		DecomposeThree(S);
+
+	qsort(Decompositions, NumberOfDecompositions, sizeof(Decompositionstruct), CompareDecompositions);
+}
+
+// the cheapest decompositions giving S back, returns the index of the printed one Printed in Decompositions
+unsigned int WriteDecompositions(const unsigned char* S, const char* FileName, unsigned int Printed)
+{
+	FILE*			F;
+	unsigned int	NumberOfChecked;
+	unsigned int	Index = -1;
+	unsigned int	i;
+
+	F = fopen(FileName, "wt");
+
+	NumberOfChecked = 0;
+	for (i = 0; (i < NumberOfDecompositions) && (NumberOfChecked < MaxNumberOfPrinted); i++)
+		if (CheckDecomposition(&Decompositions[i], S))
+		{
+			if (NumberOfChecked == Printed)
+				Index = i;
+
+			PrintDecomposition(stdout, &Decompositions[i]);
+			PrintDecomposition(F, &Decompositions[i]);
+			NumberOfChecked++;
+		}
+		else
+			printf("error: decomposition %d does not give the S-box back\n", i);
+
+	fclose(F);
+
+	return(Index);
+}
+
+// the fresh bits of the sharings of the class of T in CachePath, -1 if the class is not there or its search found no
+// combination; Path gets the file of the sharings
+int TableFreshBits(const unsigned char* T, char* Path)
+{
+	FILE*			F;
+	char			Line[1000];
+	char			CanonicalStr[2 * MaxSize + 1];
+	char			CachedCanonicalStr[2 * MaxSize + 1];
+	char			CachedName[100];
+	char			CachedFunctionStr[2 * MaxSize + 1];
+	unsigned char	Canonical[MaxSize];
+	unsigned long long	NumberOfFound;
+	int				Refreshed;
+	int				Bits;
+	int				Fewest;
+	unsigned char	Totals;
+	unsigned char	Rows;
+	unsigned char	x;
+
+	CanonicalForm(T, Canonical);
+	for (x = 0; x < Size; x++)
+		sprintf(CanonicalStr + 2 * x, "%02x", Canonical[x]);
+
+	Path[0] = 0;
+	F = fopen(CachePath, "rt");
+	if (F == NULL)
+		return(-1);
+
+	while (fgets(Line, sizeof(Line), F) != NULL)
+		if ((sscanf(Line, "%[^,], %[^,], %[^,], %[^\r\n]", CachedCanonicalStr, CachedName, CachedFunctionStr, Path) == 4) &&
+			(!strcmp(CachedCanonicalStr, CanonicalStr)))
+			break;
+		else
+			Path[0] = 0;
+
+	fclose(F);
+
+	if ((!Path[0]) || ((F = fopen(Path, "rt")) == NULL))
+		return(-1);
+
+	// a total line is written for every refreshed count tried, the files of the 3-share searches only have rows
+	Fewest = -1;
+	Totals = 0;
+	Rows = 0;
+	while (fgets(Line, sizeof(Line), F) != NULL)
+		if (sscanf(Line, "refreshed %d, fresh bits %d, total, %llu", &Refreshed, &Bits, &NumberOfFound) == 3)
+		{
+			Totals = 1;
+			if (NumberOfFound && ((Fewest < 0) || (Bits < Fewest)))
+				Fewest = Bits;
+		}
+		else if (sscanf(Line, "total, %llu", &NumberOfFound) == 1)
+		{
+			Totals = 1;
+			if (NumberOfFound)
+				Fewest = 0;
+		}
+		else if (Line[0] != '\n')
+			Rows = 1;
+
+	fclose(F);
+
+	return((Totals || (!Rows)) ? Fewest : 0);
+}
+
+int ClassFreshBits(unsigned short Class)
+{
+	char	Path[500];
+
+	if (FreshBits[Class] == -2)
+	{
+		FreshBits[Class] = TableFreshBits(Classes[Class].Table, Path);
+		FreshBitsPath[Class] = (char*)malloc(strlen(Path) + 1);
+		strcpy(FreshBitsPath[Class], Path);
+	}
+
+	return(FreshBits[Class]);
+}
+
+void WriteFront(const unsigned char* S, const char* FileName)
+{
+	FILE*			F;
+	char			Path[500];
+	int				Fewest[4];
+	unsigned int	FewestIndex[4];
+	unsigned int	NumberOfUnknown;
+	unsigned int	i;
+	int				Front;
+	int				Bits;
+	unsigned char	n;
+	unsigned char	s;
+
+	for (i = 0; i < NumberOfClasses; i++)
+		FreshBits[i] = -2;
+
+	for (n = 0; n < 4; n++)
+		Fewest[n] = -1;
+
+	if (IsQuadratic(S))
+		Fewest[1] = TableFreshBits(S, Path);
+
+	NumberOfUnknown = 0;
+	for (i = 0; i < NumberOfDecompositions; i++)
+		if (CheckDecomposition(&Decompositions[i], S))
+		{
+			Bits = 0;
+			for (s = 0; (s < Decompositions[i].NumberOfStages) && (Bits >= 0); s++)
+				Bits = (ClassFreshBits(Decompositions[i].Stages[s]) < 0) ? -1 : Bits + FreshBits[Decompositions[i].Stages[s]];
+
+			n = Decompositions[i].NumberOfStages;
+			if (Bits < 0)
+				NumberOfUnknown++;
+			else if ((Fewest[n] < 0) || (Bits < Fewest[n]))
+			{
+				Fewest[n] = Bits;
+				FewestIndex[n] = i;
+			}
+		}
+
+	printf("%d decompositions have a stage with no sharing in %s\n", NumberOfUnknown, CachePath);
+
+	F = fopen(FileName, "wt");
+
+	Front = -1;
+	for (n = 1; n < 4; n++)
+		if ((Fewest[n] >= 0) && ((Front < 0) || (Fewest[n] < Front)))
+		{
+			Front = Fewest[n];
+			printf("%d stages, %d fresh bits\n", n, Fewest[n]);
+			fprintf(F, "%d stages, %d fresh bits\n", n, Fewest[n]);
+
+			if (n == 1)
+				fprintf(F, "the S-box itself, sharings in %s\n\n", Path);
+			else
+			{
+				for (s = 0; s < n; s++)
+					fprintf(F, "stage %c: %d fresh bits, sharings in %s\n", 'F' + s,
+						FreshBits[Decompositions[FewestIndex[n]].Stages[s]], FreshBitsPath[Decompositions[FewestIndex[n]].Stages[s]]);
+				PrintDecomposition(F, &Decompositions[FewestIndex[n]]);
+			}
+		}
+
+	fclose(F);
+
+	for (i = 0; i < NumberOfClasses; i++)
+		if (FreshBits[i] != -2)
+			free(FreshBitsPath[i]);
+}
+
+//-----------------------------------------------------
+
+int main()
+{
+	char			FileName[100];
+	char			Name[100];
+	unsigned char	Columns[MaxNumberOfBits];
+	unsigned char	Canonical[MaxSize];
+	unsigned int	Index;
+	unsigned char	s;
+	unsigned char	x;
+	Decompositionstruct	Forward;
+
+	Size = 1 << NumberOfBits;
+	BestA = (unsigned char(*)[MaxSize])malloc(MaxNumberOfBest * MaxSize * sizeof(unsigned char));
+	BestB = (unsigned char(*)[MaxSize])malloc(MaxNumberOfBest * MaxSize * sizeof(unsigned char));
+	Classes = (Classstruct*)malloc(MaxNumberOfClasses * sizeof(Classstruct));
+	Decompositions = (Decompositionstruct*)malloc(MaxNumberOfDecompositions * sizeof(Decompositionstruct));
+	LinearColumns = (unsigned char(*)[MaxNumberOfBits])malloc(((NumberOfBits == 4) ? 20160 : 9999360) * MaxNumberOfBits);
+
+	omp_set_num_threads(22);
+
+	CanonicalForm(Sbox, Canonical);
+	if (!CheckCanonicalForm(Sbox, Canonical, NumberOfEquivalenceChecks))
+		return 1;
+
+	NumberOfLinear = 0;
+	FillLinear(0, Columns, 1);
+
+	FillCoordinates();
+	FillClasses();
+	printf("%d coordinate functions, %d classes of stages\n", NumberOfCoordinates, NumberOfClasses);
+
+	memset(SharedPath, 0, sizeof(SharedPath));
+	SearchDecompositions(Sbox, SboxName);
+
+	sprintf(FileName, "Decomposition_%s.txt", SboxName);
+	Index = WriteDecompositions(Sbox, FileName, ForwardDecomposition);
+
+	if (CachePath[0])
+	{
+		sprintf(FileName, "Decomposition_%s_front.txt", SboxName);
+		WriteFront(Sbox, FileName);
+	}
+
+	//---------------------------------------
+
+	if (DeriveInverse && (Index < NumberOfDecompositions))
+	{
+		Forward = Decompositions[Index];
+		for (s = 0; s < Forward.NumberOfStages; s++)
+			if (StageSharingPaths[s][0])
+			{
+				SharedPath[Forward.Stages[s]] = StageSharingPaths[s];
+				Classes[Forward.Stages[s]].Cost = 0;
+			}
+
+		for (x = 0; x < Size; x++)
+			InverseSbox[Sbox[x]] = x;
+
+		sprintf(Name, "%s_inverse", SboxName);
+		SearchDecompositions(InverseSbox, Name);
+
+		// the stages of the forward decomposition inverted, whatever the search of the inverse finds
+		if ((NumberOfDecompositions < MaxNumberOfDecompositions) && InvertDecomposition(&Forward, &Decompositions[NumberOfDecompositions]))
+		{
+			printf("the inverted stages are quadratic\n");
+			NumberOfDecompositions++;
+			qsort(Decompositions, NumberOfDecompositions, sizeof(Decompositionstruct), CompareDecompositions);
+		}
+
+		sprintf(FileName, "Decomposition_%s.txt", Name);
+		WriteDecompositions(InverseSbox, FileName, 0);
+	}
+	else if (DeriveInverse)
+		printf("no decomposition %d of %s\n", ForwardDecomposition, SboxName);
+
+	free(BestA);
+	free(BestB);
+	free(Classes);
+	free(Decompositions);
+	free(LinearColumns);
+
+	printf("done");
+
+	return 0;
+}
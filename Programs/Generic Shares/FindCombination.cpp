@@ -0,0 +1,1300 @@
+/*
+* -----------------------------------------------------------------
+* COMPANY : Ruhr University Bochum
+* AUTHOR  : Amir Moradi amir.moradi@rub.de Aein Rezaei Shahmirzadi aein.rezaeishahmirzadi@rub.de
+* DOCUMENT: "Second-Order SCA Security with almost no Fresh Randomness" TCHES 2021, Issue 3
+* -----------------------------------------------------------------
+*
+* Copyright c 2021, Amir Moradi, Aein Rezaei Shahmirzadi
+*
+* All rights reserved.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTERS BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* INCLUDING NEGLIGENCE OR OTHERWISE ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+* Please see LICENSE and README for license and further instructions.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <omp.h>
+
+// combines the rows of the coordinate searches of this folder (or of the 3-share ones) into a sharing of the
+// whole S-box, the rows of every output bit being made for the same number of shares and with as many output shares
+// (with three output shares of two, 16 masked inputs of an unmasked input cannot cover the 256 sharings of the output)
+const char			path[500] = "Res_";
+
+const unsigned char	NumberOfShares = 4; // 2, 3 or 4
+const unsigned char	NumberOfSboxBits = 4; // 4 to 8, the variables a ... h
+const unsigned char	NumberOfOutputBits = 4;
+const unsigned char	Bits[NumberOfOutputBits] = { 0,1,2,3 };
+const unsigned char	CheckWithinTables = 0; // also the probe sets within one table, for rows whose x, y and z are not single input bits
+const unsigned char	NumberOfThreads = 22;
+const unsigned char	CountOnly = 0; // only count the combinations, no rows are written
+// the probe sets that are checked, ';' between the sets and ' ' between their probes: MO an output share after its
+// register, Full the inputs of a component (a glitch on it), Pair (z_k, x_i) of the former stage (in the coordinate search only) and * any;
+// a set is checked if it has the probes of one of the sets given, with 2 up to NumberOfShares - 1 probes; its joint
+// distribution has to be the same for every unmasked input, by SameInEveryBlock<2> or <3> (the per-S-box programs keep
+// their own probe tables)
+const char			ProbeSpec[200] = "MO *; MO * *";
+// an output bit may be refreshed by NumberOfShares - 1 fresh bits (the last output share taking their sum), its shares
+// then leaving the uniformity check; the search is made for 0, 1, ... refreshed bits up to the first one with combinations
+const unsigned char	MaxRefreshedBits = 0;
+// 0: every combination is written, otherwise only the TopK cheapest ones by the cost of RowCost, cheapest first,
+// the combinations that cannot beat the TopK-th best found so far being cut
+const unsigned int	TopK = 0;
+const unsigned int	ANDCost = 4; // about 3 times the gate equivalents of a 2-input AND
+const unsigned int	XORCost = 7; // and of a 2-input XOR
+const unsigned int	FanInCost = 1; // for every term of the widest component of a row
+
+#define	MaxNumberOfShares 4
+#define	MaxNumberOfPairs (MaxNumberOfShares * MaxNumberOfShares)
+#define	MaxNumberOfSboxBits 8
+#define	MaxNumberOfOutputBits 8
+#define	MaxNumberOfFullValues 4096
+#define	MaxNumberOfCodes 8 // variables of a component
+#define	MaxKeyWidth (MaxNumberOfShares + 2 * MaxNumberOfCodes)
+#define	FullValueHashSize (1 << 16)
+#define	MaxNumberOfWords 16 // with 2 shares, a table of the 1024 masked inputs of 5 bits
+#define	MaxTableBits 16 // larger tables are not held, see StreamTables
+#define	MaxNumberOfTerms 128 // of the expression of a component
+#define	MaxExpressionLength 2000
+
+unsigned int	NumberOfPairs;
+unsigned int	NumberOfMasked; // over the S-box input, the unmasked input followed by the NumberOfShares - 1 masks
+unsigned int	BlockSize;
+unsigned int	NumberOfBlocks;
+unsigned char	Parity[256];
+unsigned char	StreamTables; // from 2^17 masked inputs on, the components are evaluated blockwise from their expressions
+unsigned char	ClassesByOutBits; // with 2 shares and tables of at most 64 * MaxNumberOfWords masked inputs
+unsigned char	NumberOfRefreshed; // the output bits refreshed in every combination of the current search
+
+// the inputs of a component, as seen by a glitch on it, are kept once for all components with the same variables
+unsigned char*	FullValues[MaxNumberOfFullValues];
+unsigned char	FullWidths[MaxNumberOfFullValues];
+uint64_t		FullKeys[MaxNumberOfFullValues];
+unsigned int	NumberOfFullValues;
+unsigned short*	FullValueIndex; // hashed by the codes of the variables
+
+typedef struct {
+	unsigned char*	MO[MaxNumberOfShares]; // the components of every output share
+	unsigned char*	OutShares; // the output shares
+	uint64_t		OutBits[MaxNumberOfWords]; // with ClassesByOutBits, the first output share, bit i for the masked input i
+	unsigned short	Full[MaxNumberOfPairs];
+	uint32_t*		Terms[MaxNumberOfPairs]; // with StreamTables, the terms of every component, bit c - 1 for the variable of code c
+	unsigned char	NumberOfTerms[MaxNumberOfPairs];
+	char*			Strings; // the count and expression of every component
+	unsigned int	Cost; // see RowCost
+} Rowstruct;
+
+Rowstruct*		Rows[MaxNumberOfOutputBits];
+unsigned int	NumberOfRows[MaxNumberOfOutputBits];
+
+// the rows are combined by classes, the rows ClassStart[c] ... ClassStart[c + 1] - 1 of an output bit; with 2 shares
+// no probe set spans two tables and the rows with the same first output share make a class, otherwise every row is one
+unsigned int*	ClassStart[MaxNumberOfOutputBits];
+unsigned int	NumberOfClasses[MaxNumberOfOutputBits];
+unsigned int	MinCost[MaxNumberOfOutputBits]; // of the rows of every output bit
+
+// with TopK, the cheapest combinations found so far in a heap, the most expensive one on top
+typedef struct {
+	unsigned int	Cost;
+	unsigned int	Row[MaxNumberOfOutputBits];
+	unsigned char	Refreshed[MaxNumberOfOutputBits];
+} Beststruct;
+
+Beststruct*		Best;
+unsigned int	NumberOfBest;
+// the cost a combination has to be under, that of the top of a full heap; it is written under critical (best), the
+// other threads reading it atomically without the lock
+unsigned int	BoundCost;
+
+void FillTables()
+{
+	unsigned int	j, k;
+
+	NumberOfPairs = NumberOfShares * NumberOfShares;
+	NumberOfMasked = 1 << (NumberOfSboxBits * NumberOfShares);
+	BlockSize = 1 << (NumberOfSboxBits * (NumberOfShares - 1));
+	NumberOfBlocks = 1 << NumberOfSboxBits;
+	StreamTables = (NumberOfSboxBits * NumberOfShares > MaxTableBits);
+	ClassesByOutBits = (NumberOfShares == 2) && (!StreamTables) && (NumberOfMasked <= 64 * MaxNumberOfWords);
+
+	for (j = 0; j < 256; j++)
+	{
+		Parity[j] = 0;
+		for (k = 0; k < 8; k++)
+			Parity[j] ^= (j >> k) & 1;
+	}
+
+	FullValueIndex = (unsigned short*)calloc(FullValueHashSize, sizeof(unsigned short));
+	NumberOfFullValues = 1; // 0 is no entry
+}
+
+unsigned char ShareBit(unsigned int Masked_InputIndex, unsigned char Var, unsigned char Share)
+{
+	unsigned char	Bit;
+	unsigned char	s;
+
+	if (Share < NumberOfShares - 1)
+		return((Masked_InputIndex >> (NumberOfSboxBits * (NumberOfShares - 2 - Share) + Var)) & 1);
+
+	Bit = 0;
+	for (s = 0; s < NumberOfShares; s++)
+		Bit ^= (Masked_InputIndex >> (NumberOfSboxBits * s + Var)) & 1;
+
+	return(Bit);
+}
+
+// the code of the variable at Expression, like d1 or c3, 0 if there is none
+unsigned char VariableCode(char* Expression)
+{
+	if ((*Expression >= 'a') && (*Expression < 'a' + NumberOfSboxBits) && (Expression[1] >= '1') && (Expression[1] <= '0' + NumberOfShares))
+		return((*Expression - 'a') * NumberOfShares + (Expression[1] - '1') + 1);
+
+	return(0);
+}
+
+// the variables of an expression, like d1 or c3, give the inputs of the component
+unsigned short GetFullValue(char* Expression)
+{
+	unsigned char	Code[MaxNumberOfCodes];
+	unsigned char	NumberOfCodes;
+	unsigned char	c;
+	uint64_t		Key;
+	unsigned int	Hash;
+	unsigned int	Masked_InputIndex;
+	unsigned char	k, l;
+
+	NumberOfCodes = 0;
+	for (; *Expression; Expression++)
+		if ((c = VariableCode(Expression)))
+		{
+			for (k = 0; (k < NumberOfCodes) && (Code[k] < c); k++);
+			if ((k < NumberOfCodes) && (Code[k] == c))
+				continue;
+
+			if (NumberOfCodes == MaxNumberOfCodes)
+			{
+				printf("more than %d variables in %s\n", MaxNumberOfCodes, Expression);
+				exit(1);
+			}
+
+			for (l = NumberOfCodes; l > k; l--)
+				Code[l] = Code[l - 1];
+			Code[k] = c;
+			NumberOfCodes++;
+		}
+
+	Key = 0;
+	for (k = 0; k < NumberOfCodes; k++)
+		Key = (Key << 6) | Code[k];
+
+	for (Hash = (Key * 0x9E3779B97F4A7C15ULL) >> 48; FullValueIndex[Hash] && (FullKeys[FullValueIndex[Hash]] != Key); Hash = (Hash + 1) % FullValueHashSize);
+
+	if (!FullValueIndex[Hash])
+	{
+		if (NumberOfFullValues == MaxNumberOfFullValues)
+		{
+			printf("more than %d sets of variables\n", MaxNumberOfFullValues);
+			exit(1);
+		}
+
+		FullValues[NumberOfFullValues] = StreamTables ? NULL : (unsigned char*)malloc(NumberOfMasked * sizeof(unsigned char));
+		for (Masked_InputIndex = 0; (!StreamTables) && (Masked_InputIndex < NumberOfMasked); Masked_InputIndex++)
+		{
+			FullValues[NumberOfFullValues][Masked_InputIndex] = 0;
+			for (k = 0; k < NumberOfCodes; k++)
+				FullValues[NumberOfFullValues][Masked_InputIndex] |= ShareBit(Masked_InputIndex, (Code[k] - 1) / NumberOfShares, (Code[k] - 1) % NumberOfShares) << k;
+		}
+		FullWidths[NumberOfFullValues] = NumberOfCodes;
+		FullKeys[NumberOfFullValues] = Key;
+		FullValueIndex[Hash] = NumberOfFullValues++;
+	}
+
+	return(FullValueIndex[Hash]);
+}
+
+// the terms of an expression, like d1a2 + d1e2 + 1, for StreamTables
+unsigned char GetTerms(char* Expression, uint32_t* Terms)
+{
+	unsigned char	NumberOfTerms = 0;
+	unsigned char	c;
+
+	Terms[0] = 0;
+	for (; *Expression; Expression++)
+	{
+		if ((c = VariableCode(Expression)))
+			Terms[NumberOfTerms] |= 1 << (c - 1);
+		else if (*Expression == '+')
+		{
+			if (++NumberOfTerms == MaxNumberOfTerms)
+			{
+				printf("more than %d terms in a component\n", MaxNumberOfTerms);
+				exit(1);
+			}
+			Terms[NumberOfTerms] = 0;
+		}
+	}
+
+	return(NumberOfTerms + 1);
+}
+
+// the products of a row are counted once, a component sharing them with the other ones, then the XORs of its
+// terms and of the compression of its output shares, and the number of terms of its widest component
+unsigned int RowCost(char Strings[][MaxExpressionLength + 1])
+{
+	uint32_t		Terms[MaxNumberOfTerms];
+	uint32_t		Products[MaxNumberOfPairs * MaxNumberOfTerms];
+	unsigned int	NumberOfProducts = 0;
+	unsigned int	NumberOfANDs = 0;
+	unsigned int	NumberOfXORs = 0;
+	unsigned int	FanIn = 0;
+	unsigned int	j;
+	unsigned char	NumberOfTerms;
+	unsigned char	k, t;
+
+	for (k = 0; k < NumberOfPairs; k++)
+	{
+		NumberOfTerms = GetTerms(Strings[2 * k + 1], Terms);
+		NumberOfXORs += NumberOfTerms - 1;
+		if (NumberOfTerms > FanIn)
+			FanIn = NumberOfTerms;
+
+		for (t = 0; t < NumberOfTerms; t++)
+		{
+			if (__builtin_popcount(Terms[t]) < 2)
+				continue;
+
+			for (j = 0; (j < NumberOfProducts) && (Products[j] != Terms[t]); j++);
+			if (j == NumberOfProducts)
+			{
+				Products[NumberOfProducts++] = Terms[t];
+				NumberOfANDs += __builtin_popcount(Terms[t]) - 1;
+			}
+		}
+	}
+
+	NumberOfXORs += NumberOfShares * (NumberOfShares - 1);
+
+	return(ANDCost * NumberOfANDs + XORCost * NumberOfXORs + FanInCost * FanIn);
+}
+
+// a field ends at a comma, the spaces and line ends being skipped
+int ReadField(FILE* F, char* Field, unsigned int MaxLength)
+{
+	int				TempChar;
+	unsigned int	l = 0;
+
+	while (((TempChar = fgetc(F)) == ' ') || (TempChar == '\n') || (TempChar == '\r'));
+
+	while ((TempChar != ',') && (TempChar != EOF))
+	{
+		if ((l < MaxLength) && (TempChar != '\n') && (TempChar != '\r'))
+			Field[l++] = TempChar;
+		TempChar = fgetc(F);
+	}
+
+	Field[l] = 0;
+	return((TempChar == EOF) && (l == 0) ? 0 : 1);
+}
+
+void ReadRows(unsigned char index)
+{
+	FILE*			F;
+	char			FilePath[500];
+	char*			Field;
+	char			Strings[2 * MaxNumberOfPairs][MaxExpressionLength + 1];
+	uint32_t		Terms[MaxNumberOfTerms];
+	unsigned int	Size;
+	unsigned int	Length;
+	unsigned int	Masked_InputIndex;
+	Rowstruct*		Row;
+	unsigned char	g, l;
+
+	sprintf(FilePath, "%s%d.csv", path, Bits[index]);
+	F = fopen(FilePath, "rt");
+	if (F == NULL)
+	{
+		printf("%s not found\n", FilePath);
+		exit(1);
+	}
+
+	Field = (char*)malloc((StreamTables ? MaxExpressionLength : NumberOfMasked) + 1);
+	Rows[index] = NULL;
+	NumberOfRows[index] = 0;
+	Size = 0;
+
+	while (ReadField(F, Field, MaxExpressionLength)) // Type
+	{
+		if (NumberOfRows[index] == Size)
+		{
+			Size = Size ? 2 * Size : 1024;
+			Rows[index] = (Rowstruct*)realloc(Rows[index], Size * sizeof(Rowstruct));
+		}
+
+		Row = &Rows[index][NumberOfRows[index]];
+		Length = 0;
+		for (g = 0; g < NumberOfShares; g++)
+		{
+			ReadField(F, Field, MaxExpressionLength); // ANF
+
+			for (l = 0; l < NumberOfShares; l++)
+			{
+				ReadField(F, Strings[2 * (g * NumberOfShares + l)], MaxExpressionLength);
+				ReadField(F, Strings[2 * (g * NumberOfShares + l) + 1], MaxExpressionLength);
+				Length += strlen(Strings[2 * (g * NumberOfShares + l)]) + strlen(Strings[2 * (g * NumberOfShares + l) + 1]) + 6;
+
+				Row->Full[g * NumberOfShares + l] = GetFullValue(Strings[2 * (g * NumberOfShares + l) + 1]);
+				if (StreamTables)
+				{
+					Row->NumberOfTerms[g * NumberOfShares + l] = GetTerms(Strings[2 * (g * NumberOfShares + l) + 1], Terms);
+					Row->Terms[g * NumberOfShares + l] = (uint32_t*)malloc(Row->NumberOfTerms[g * NumberOfShares + l] * sizeof(uint32_t));
+					memcpy(Row->Terms[g * NumberOfShares + l], Terms, Row->NumberOfTerms[g * NumberOfShares + l] * sizeof(uint32_t));
+				}
+			}
+
+			// the table is not read with StreamTables
+			ReadField(F, Field, StreamTables ? MaxExpressionLength : NumberOfMasked);
+			if (StreamTables)
+				continue;
+
+			if (strlen(Field) != NumberOfMasked)
+			{
+				printf("row %d of %s is not made for %d shares\n", NumberOfRows[index], FilePath, NumberOfShares);
+				exit(1);
+			}
+
+			Row->MO[g] = (unsigned char*)malloc(NumberOfMasked * sizeof(unsigned char));
+			for (Masked_InputIndex = 0; Masked_InputIndex < NumberOfMasked; Masked_InputIndex++)
+				Row->MO[g][Masked_InputIndex] = (Field[Masked_InputIndex] <= '9') ? (Field[Masked_InputIndex] - '0') : (Field[Masked_InputIndex] - 'a' + 10);
+		}
+
+		Row->OutShares = StreamTables ? NULL : (unsigned char*)calloc(NumberOfMasked, sizeof(unsigned char));
+		for (g = 0; (!StreamTables) && (g < NumberOfShares); g++)
+			for (Masked_InputIndex = 0; Masked_InputIndex < NumberOfMasked; Masked_InputIndex++)
+				Row->OutShares[Masked_InputIndex] |= Parity[Row->MO[g][Masked_InputIndex]] << g;
+
+		memset(Row->OutBits, 0, sizeof(Row->OutBits));
+		if (ClassesByOutBits)
+			for (Masked_InputIndex = 0; Masked_InputIndex < NumberOfMasked; Masked_InputIndex++)
+				Row->OutBits[Masked_InputIndex >> 6] |= (uint64_t)(Row->OutShares[Masked_InputIndex] & 1) << (Masked_InputIndex & 63);
+
+		Row->Cost = RowCost(Strings);
+		Row->Strings = (char*)malloc(Length + 1);
+		Row->Strings[0] = 0;
+		for (l = 0; l < 2 * NumberOfPairs; l++)
+		{
+			strcat(Row->Strings, " ");
+			strcat(Row->Strings, Strings[l]);
+			strcat(Row->Strings, ", ");
+		}
+
+		NumberOfRows[index]++;
+	}
+
+	fclose(F);
+	free(Field);
+	printf("%d rows for output bit %d\n", NumberOfRows[index], Bits[index]);
+}
+
+int CompareOutBits(const void* a, const void* b)
+{
+	return(memcmp(((Rowstruct*)a)->OutBits, ((Rowstruct*)b)->OutBits, sizeof(((Rowstruct*)a)->OutBits)));
+}
+
+int CompareCost(const void* a, const void* b)
+{
+	if (((Rowstruct*)a)->Cost != ((Rowstruct*)b)->Cost)
+		return((((Rowstruct*)a)->Cost < ((Rowstruct*)b)->Cost) ? -1 : 1);
+	return(0);
+}
+
+void FillClasses(unsigned char index)
+{
+	unsigned int	i;
+
+	if (ClassesByOutBits)
+		qsort(Rows[index], NumberOfRows[index], sizeof(Rowstruct), CompareOutBits);
+
+	ClassStart[index] = (unsigned int*)malloc((NumberOfRows[index] + 1) * sizeof(unsigned int));
+	NumberOfClasses[index] = 0;
+	for (i = 0; i < NumberOfRows[index]; i++)
+		if ((!ClassesByOutBits) || (!i) || CompareOutBits(&Rows[index][i - 1], &Rows[index][i]))
+			ClassStart[index][NumberOfClasses[index]++] = i;
+	ClassStart[index][NumberOfClasses[index]] = NumberOfRows[index];
+
+	if (ClassesByOutBits)
+		printf("%d classes for output bit %d\n", NumberOfClasses[index], Bits[index]);
+
+	// the cheapest row of a class first, giving the bound of the class
+	for (i = 0; TopK && (i < NumberOfClasses[index]); i++)
+		qsort(&Rows[index][ClassStart[index][i]], ClassStart[index][i + 1] - ClassStart[index][i], sizeof(Rowstruct), CompareCost);
+
+	MinCost[index] = 0xffffffff;
+	for (i = 0; i < NumberOfRows[index]; i++)
+		if (Rows[index][i].Cost < MinCost[index])
+			MinCost[index] = Rows[index][i].Cost;
+}
+
+//---------------------------------------------------------------------------
+
+// a probe set of at most NumberOfShares - 1 glitch-extended probes on the tables of several output bits, with at least
+// one probe on an output share (MO) and one on the newest table, the sets within one table being checked by the coordinate search
+// unless CheckWithinTables is set
+typedef struct {
+	unsigned char	NumberOfObjects;
+	unsigned char	Table[3];
+	unsigned char	Kind[3]; // 0: the components of an output share, 1: the inputs of a component
+	unsigned char	Index[3];
+} ProbeSetstruct;
+
+ProbeSetstruct*	ProbeSets;
+unsigned int	StageStart[MaxNumberOfOutputBits + 1];
+
+// the sets of ProbeSpec by the number of their probes of every kind
+#define	MaxNumberOfProbeShapes 32
+
+typedef struct {
+	unsigned char	Size;
+	unsigned char	Count[4]; // MO, Full, Pair and any
+} ProbeShapestruct;
+
+ProbeShapestruct	ProbeShapes[MaxNumberOfProbeShapes];
+unsigned int		NumberOfProbeShapes;
+
+void CompileProbeSpec()
+{
+	const char		Names[4][5] = { "MO", "Full", "Pair", "*" };
+	char			Word[10];
+	const char*		c;
+	unsigned char	l, k;
+
+	memset(ProbeShapes, 0, sizeof(ProbeShapes));
+	NumberOfProbeShapes = 0;
+	l = 0;
+	for (c = ProbeSpec; ; c++)
+	{
+		if ((*c != ' ') && (*c != ';') && (*c != 0))
+		{
+			if (l < 9)
+				Word[l++] = *c;
+			continue;
+		}
+
+		if (l)
+		{
+			Word[l] = 0;
+			for (k = 0; (k < 4) && strcmp(Word, Names[k]); k++);
+			if ((k == 4) || (ProbeShapes[NumberOfProbeShapes].Size == 3))
+			{
+				printf("%s is not a probe, or more than 3 probes in a set of %s\n", Word, ProbeSpec);
+				exit(1);
+			}
+
+			ProbeShapes[NumberOfProbeShapes].Count[k]++;
+			ProbeShapes[NumberOfProbeShapes].Size++;
+			l = 0;
+		}
+
+		if ((*c != ' ') && ProbeShapes[NumberOfProbeShapes].Size)
+		{
+			if (ProbeShapes[NumberOfProbeShapes].Size < 2)
+			{
+				printf("a probe set of %s has a single probe\n", ProbeSpec);
+				exit(1);
+			}
+
+			if (++NumberOfProbeShapes == MaxNumberOfProbeShapes)
+			{
+				printf("more than %d probe sets in %s\n", MaxNumberOfProbeShapes - 1, ProbeSpec);
+				exit(1);
+			}
+		}
+
+		if (*c == 0)
+			break;
+	}
+}
+
+// the objects of a set, by their kinds, have the probes of a set of ProbeSpec
+unsigned char MatchesProbeSpec(unsigned char* Kind, unsigned int* o, unsigned char Size)
+{
+	unsigned char	Count[3] = { 0, 0, 0 };
+	unsigned int	i;
+	unsigned char	l;
+
+	for (l = 0; l < Size; l++)
+		Count[Kind[o[l]]]++;
+
+	for (i = 0; i < NumberOfProbeShapes; i++)
+		if ((ProbeShapes[i].Size == Size) && (Count[0] >= ProbeShapes[i].Count[0]) &&
+			(Count[1] >= ProbeShapes[i].Count[1]) && (Count[2] >= ProbeShapes[i].Count[2]))
+			return(1);
+
+	return(0);
+}
+
+void FillProbeSets()
+{
+	unsigned char	Table[MaxNumberOfOutputBits * (MaxNumberOfShares + MaxNumberOfPairs)];
+	unsigned char	Kind[MaxNumberOfOutputBits * (MaxNumberOfShares + MaxNumberOfPairs)];
+	unsigned char	Index[MaxNumberOfOutputBits * (MaxNumberOfShares + MaxNumberOfPairs)];
+	unsigned int	NumberOfObjects;
+	unsigned int	o[3];
+	unsigned int	Count;
+	unsigned char	Stage, Size, Pass, t, l;
+	unsigned char	NumberOfNew;
+
+	for (Pass = 0; Pass < 2; Pass++)
+	{
+		Count = 0;
+		NumberOfObjects = 0;
+		StageStart[0] = 0;
+		for (Stage = 0; Stage < NumberOfOutputBits; Stage++)
+		{
+			for (l = 0; l < NumberOfShares + NumberOfPairs; l++)
+			{
+				Table[NumberOfObjects] = Stage;
+				Kind[NumberOfObjects] = l >= NumberOfShares;
+				Index[NumberOfObjects++] = (l < NumberOfShares) ? l : (l - NumberOfShares);
+			}
+
+			for (Size = 2; Size < NumberOfShares; Size++)
+				for (o[0] = 0; o[0] < NumberOfObjects; o[0]++)
+					for (o[1] = o[0] + 1; o[1] < NumberOfObjects; o[1]++)
+						for (o[2] = (Size > 2) ? (o[1] + 1) : 0; o[2] < ((Size > 2) ? NumberOfObjects : 1); o[2]++)
+						{
+							NumberOfNew = 0;
+							for (l = 0; l < Size; l++)
+								NumberOfNew += (Table[o[l]] == Stage);
+
+							if ((!MatchesProbeSpec(Kind, o, Size)) || (!NumberOfNew) || ((NumberOfNew == Size) && (!CheckWithinTables)))
+								continue;
+
+							if (Pass)
+							{
+								ProbeSets[Count].NumberOfObjects = Size;
+								for (l = 0; l < Size; l++)
+								{
+									ProbeSets[Count].Table[l] = Table[o[l]];
+									ProbeSets[Count].Kind[l] = Kind[o[l]];
+									ProbeSets[Count].Index[l] = Index[o[l]];
+								}
+							}
+							Count++;
+						}
+
+			StageStart[Stage + 1] = Count;
+		}
+
+		if (!Pass)
+			ProbeSets = (ProbeSetstruct*)malloc((Count + 1) * sizeof(ProbeSetstruct));
+	}
+
+	for (t = CheckWithinTables ? 0 : 1; t < NumberOfOutputBits; t++)
+		printf("%d probe sets when adding output bit %d\n", StageStart[t + 1] - StageStart[t], Bits[t]);
+}
+
+// Counter is zero at the call and left so, Keys holds 2 * BlockSize entries
+// the key of the values of a probe set at a masked input, the kernels being instantiated for sets of 2 and 3 objects
+template <unsigned char NumberOfValues>
+static inline uint32_t ProbeKey(unsigned char* Values[3], unsigned char Widths[3], unsigned int i)
+{
+	uint32_t	Key = (Values[0][i] << Widths[1]) | Values[1][i];
+
+	if (NumberOfValues == 3)
+		Key = (Key << Widths[2]) | Values[2][i];
+
+	return(Key);
+}
+
+template <unsigned char NumberOfValues>
+unsigned char SameInEveryBlock(unsigned char* Values[3], unsigned char Widths[3], int* Counter, uint32_t* Keys)
+{
+	unsigned int	Block;
+	unsigned int	Offset;
+	unsigned int	Masked_InputIndex;
+	uint32_t*		Keys0 = Keys;
+	uint32_t*		Keys1 = Keys + BlockSize;
+	unsigned char	Same = 1;
+
+	for (Offset = 0; Offset < BlockSize; Offset++)
+		Keys0[Offset] = ProbeKey<NumberOfValues>(Values, Widths, Offset);
+
+	for (Block = 1; (Block < NumberOfBlocks) && Same; Block++)
+	{
+		for (Offset = 0; Offset < BlockSize; Offset++)
+			Counter[Keys0[Offset]]++;
+
+		// with as many entries in both blocks, no negative counter means the same distribution
+		Masked_InputIndex = Block * BlockSize;
+		for (Offset = 0; Offset < BlockSize; Offset++, Masked_InputIndex++)
+		{
+			Keys1[Offset] = ProbeKey<NumberOfValues>(Values, Widths, Masked_InputIndex);
+
+			if (--Counter[Keys1[Offset]] < 0)
+			{
+				Same = 0;
+				Offset++;
+				break;
+			}
+		}
+
+		while (Offset)
+			Counter[Keys1[--Offset]] = 0;
+
+		for (Offset = 0; Offset < BlockSize; Offset++)
+			Counter[Keys0[Offset]] = 0;
+	}
+
+	return(Same);
+}
+
+typedef struct {
+	Rowstruct*		Row[MaxNumberOfOutputBits];
+	unsigned int	i[MaxNumberOfOutputBits];
+	int*			Counter;
+	uint32_t*		Keys; // with StreamTables, the keys taken in the first block
+	int*			Reference; // with StreamTables, the counters of the first block
+	uint64_t		Ind[MaxNumberOfOutputBits + 1][1 << MaxNumberOfOutputBits][MaxNumberOfWords]; // with ClassesByOutBits, see CheckUniformityBits
+	unsigned char	Refreshed[MaxNumberOfOutputBits];
+	unsigned char	NumberOfRefreshed;
+	unsigned int	Cost[MaxNumberOfOutputBits + 1]; // with TopK, Cost[t] of the cheapest rows of the classes of the first t tables
+} Searchstruct;
+
+// the tables among the first NumberOfTables that are not refreshed
+unsigned char UniformTables(Searchstruct* S, unsigned char NumberOfTables)
+{
+	unsigned char	Count = 0;
+	unsigned char	t;
+
+	for (t = 0; t < NumberOfTables; t++)
+		Count += !S->Refreshed[t];
+
+	return(Count);
+}
+
+// with StreamTables, the masked inputs are taken 64 at a time in bit-planes, bit b of a plane for the masked input
+// Masked_InputIndex + b; Wire[c - 1] is the plane of the variable of code c
+void MakeWirePlanes(unsigned int Masked_InputIndex, uint64_t* Wire)
+{
+	const uint64_t	Pattern[6] = { 0xaaaaaaaaaaaaaaaaULL, 0xccccccccccccccccULL, 0xf0f0f0f0f0f0f0f0ULL,
+								   0xff00ff00ff00ff00ULL, 0xffff0000ffff0000ULL, 0xffffffff00000000ULL };
+	uint64_t		Plane;
+	unsigned char	Bit;
+	unsigned char	v, f;
+
+	for (v = 0; v < NumberOfSboxBits; v++)
+	{
+		Wire[v * NumberOfShares + NumberOfShares - 1] = 0;
+
+		// the fields of the masked input are the masks and then the unmasked input, the last share being their sum
+		for (f = 0; f < NumberOfShares; f++)
+		{
+			Bit = NumberOfSboxBits * f + v;
+			Plane = (Bit < 6) ? Pattern[Bit] : (uint64_t)0 - ((Masked_InputIndex >> Bit) & 1);
+
+			if (f < NumberOfShares - 1)
+				Wire[v * NumberOfShares + NumberOfShares - 2 - f] = Plane;
+			Wire[v * NumberOfShares + NumberOfShares - 1] ^= Plane;
+		}
+	}
+}
+
+uint64_t ComponentPlane(Rowstruct* Row, unsigned char Component, uint64_t* Wire)
+{
+	uint64_t		Plane = 0;
+	uint64_t		Term;
+	uint32_t		Vars;
+	unsigned char	k;
+
+	for (k = 0; k < Row->NumberOfTerms[Component]; k++)
+	{
+		Term = ~(uint64_t)0;
+		for (Vars = Row->Terms[Component][k]; Vars; Vars &= Vars - 1)
+			Term &= Wire[__builtin_ctz(Vars)];
+		Plane ^= Term;
+	}
+
+	return(Plane);
+}
+
+// the planes of an object of a probe set, returning its width
+unsigned char ObjectPlanes(Rowstruct* Row, unsigned char Kind, unsigned char Index, uint64_t* Wire, uint64_t* Planes)
+{
+	unsigned char	Width;
+	unsigned char	k;
+
+	if (Kind == 0)
+	{
+		for (k = 0; k < NumberOfShares; k++)
+			Planes[k] = ComponentPlane(Row, Index * NumberOfShares + k, Wire);
+		return(NumberOfShares);
+	}
+
+	// bit k of a full value is the variable Code[k] of GetFullValue
+	Width = FullWidths[Row->Full[Index]];
+	for (k = 0; k < Width; k++)
+		Planes[k] = Wire[((FullKeys[Row->Full[Index]] >> (6 * (Width - 1 - k))) & 63) - 1];
+
+	return(Width);
+}
+
+// SameInEveryBlock for a probe set, in one pass over the masked inputs: the counters of every block may not
+// exceed those of the first one; Counter and Reference are zero at the call and left so
+template <unsigned char NumberOfObjects>
+unsigned char SameInEveryBlockStreamed(Searchstruct* S, ProbeSetstruct* Set)
+{
+	uint64_t		Wire[MaxNumberOfShares * MaxNumberOfSboxBits];
+	uint64_t		Planes[3][MaxNumberOfCodes];
+	unsigned char	Widths[3];
+	unsigned int	NumberOfKeys = 0;
+	unsigned int	Block;
+	unsigned int	Masked_InputIndex;
+	uint32_t		Key;
+	unsigned int	k;
+	unsigned char	b, l, w;
+	unsigned char	Same = 1;
+
+	for (Block = 0; (Block < NumberOfBlocks) && Same; Block++)
+	{
+		for (Masked_InputIndex = Block * BlockSize; (Masked_InputIndex < (Block + 1) * BlockSize) && Same; Masked_InputIndex += 64)
+		{
+			MakeWirePlanes(Masked_InputIndex, Wire);
+			for (l = 0; l < NumberOfObjects; l++)
+				Widths[l] = ObjectPlanes(S->Row[Set->Table[l]], Set->Kind[l], Set->Index[l], Wire, Planes[l]);
+
+			for (b = 0; b < 64; b++)
+			{
+				Key = 0;
+				for (l = 0; l < NumberOfObjects; l++)
+					for (w = Widths[l]; w > 0; w--)
+						Key = (Key << 1) | ((Planes[l][w - 1] >> b) & 1);
+
+				if (!Block)
+				{
+					if (!S->Reference[Key]++)
+						S->Keys[NumberOfKeys++] = Key;
+				}
+				else if (++S->Counter[Key] > S->Reference[Key])
+				{
+					S->Counter[Key] = 0;
+					Same = 0;
+					break;
+				}
+			}
+		}
+
+		for (k = 0; k < NumberOfKeys; k++)
+			S->Counter[S->Keys[k]] = 0;
+	}
+
+	for (k = 0; k < NumberOfKeys; k++)
+		S->Reference[S->Keys[k]] = 0;
+
+	return(Same);
+}
+
+// CheckUniformity for StreamTables
+unsigned char CheckUniformityStreamed(Searchstruct* S, unsigned char NumberOfTables)
+{
+	uint64_t		Wire[MaxNumberOfShares * MaxNumberOfSboxBits];
+	uint64_t		Out[MaxNumberOfOutputBits][MaxNumberOfShares];
+	unsigned int	ExpectedCounterValue = BlockSize >> ((NumberOfShares - 1) * UniformTables(S, NumberOfTables));
+	unsigned int	NumberOfKeys;
+	unsigned int	Block;
+	unsigned int	Masked_InputIndex;
+	uint32_t		Key;
+	unsigned int	k;
+	unsigned char	b, g, l, t;
+	unsigned char	Uniform = 1;
+
+	for (Block = 0; (Block < NumberOfBlocks) && Uniform; Block++)
+	{
+		NumberOfKeys = 0;
+		for (Masked_InputIndex = Block * BlockSize; (Masked_InputIndex < (Block + 1) * BlockSize) && Uniform; Masked_InputIndex += 64)
+		{
+			MakeWirePlanes(Masked_InputIndex, Wire);
+			for (t = 0; t < NumberOfTables; t++)
+				for (g = 0; (g < NumberOfShares - 1) && (!S->Refreshed[t]); g++)
+				{
+					Out[t][g] = 0;
+					for (l = 0; l < NumberOfShares; l++)
+						Out[t][g] ^= ComponentPlane(S->Row[t], g * NumberOfShares + l, Wire);
+				}
+
+			for (b = 0; b < 64; b++)
+			{
+				Key = 0;
+				for (t = 0; t < NumberOfTables; t++)
+					for (g = NumberOfShares - 1; (g > 0) && (!S->Refreshed[t]); g--)
+						Key = (Key << 1) | ((Out[t][g - 1] >> b) & 1);
+
+				if (!S->Counter[Key]++)
+					S->Keys[NumberOfKeys++] = Key;
+				if (S->Counter[Key] > (int)ExpectedCounterValue)
+				{
+					Uniform = 0;
+					break;
+				}
+			}
+		}
+
+		for (k = 0; k < NumberOfKeys; k++)
+			S->Counter[S->Keys[k]] = 0;
+	}
+
+	return(Uniform);
+}
+
+unsigned char CheckProbeSets(Searchstruct* S, unsigned char Stage)
+{
+	unsigned char*	Values[3];
+	unsigned char	Widths[3];
+	unsigned int	k;
+	unsigned char	l;
+
+	for (k = StageStart[Stage]; k < StageStart[Stage + 1]; k++)
+	{
+		if (StreamTables)
+		{
+			if (!((ProbeSets[k].NumberOfObjects == 3) ? SameInEveryBlockStreamed<3>(S, &ProbeSets[k]) : SameInEveryBlockStreamed<2>(S, &ProbeSets[k])))
+				return(0);
+			continue;
+		}
+
+		for (l = 0; l < ProbeSets[k].NumberOfObjects; l++)
+		{
+			if (ProbeSets[k].Kind[l] == 0)
+			{
+				Values[l] = S->Row[ProbeSets[k].Table[l]]->MO[ProbeSets[k].Index[l]];
+				Widths[l] = NumberOfShares;
+			}
+			else
+			{
+				Values[l] = FullValues[S->Row[ProbeSets[k].Table[l]]->Full[ProbeSets[k].Index[l]]];
+				Widths[l] = FullWidths[S->Row[ProbeSets[k].Table[l]]->Full[ProbeSets[k].Index[l]]];
+			}
+		}
+
+		if (!((ProbeSets[k].NumberOfObjects == 3) ? SameInEveryBlock<3>(Values, Widths, S->Counter, S->Keys) :
+			SameInEveryBlock<2>(Values, Widths, S->Counter, S->Keys)))
+			return(0);
+	}
+
+	return(1);
+}
+
+// the output shares of the first NumberOfTables tables are uniform: for every unmasked input, all but the
+// last share of every output bit take each value the same number of times; a refreshed table is left out
+unsigned char CheckUniformity(Searchstruct* S, unsigned char NumberOfTables)
+{
+	unsigned int	Masked_InputIndex;
+	unsigned int	Offset;
+	uint32_t		Key;
+	unsigned int	ExpectedCounterValue;
+	unsigned char	t;
+	unsigned char	Uniform = 1;
+
+	if (S->Refreshed[NumberOfTables - 1])
+		return(1);
+
+	if (StreamTables)
+		return(CheckUniformityStreamed(S, NumberOfTables));
+
+	ExpectedCounterValue = BlockSize >> ((NumberOfShares - 1) * UniformTables(S, NumberOfTables));
+
+	Offset = 0;
+	for (Masked_InputIndex = 0; Masked_InputIndex < NumberOfMasked; Masked_InputIndex++)
+	{
+		Key = 0;
+		for (t = 0; t < NumberOfTables; t++)
+			if (!S->Refreshed[t])
+				Key = (Key << (NumberOfShares - 1)) | (S->Row[t]->OutShares[Masked_InputIndex] & ((1 << (NumberOfShares - 1)) - 1));
+
+		S->Keys[Offset++] = Key;
+		if (++S->Counter[Key] > (int)ExpectedCounterValue)
+			Uniform = 0;
+
+		if ((!Uniform) || (Offset == BlockSize))
+		{
+			while (Offset)
+				S->Counter[S->Keys[--Offset]] = 0;
+
+			if (!Uniform)
+				return(0);
+		}
+	}
+
+	return(1);
+}
+
+// the same with 2 shares, the tables being held in registers: Ind[t][v] holds the masked inputs at which the
+// first shares of the first t tables not refreshed take the value v, every block taking v BlockSize >> t times
+unsigned char CheckUniformityBits(Searchstruct* S, unsigned char NumberOfTables)
+{
+	uint64_t*		Old;
+	uint64_t*		New0;
+	uint64_t*		New1;
+	uint64_t*		Out = S->Row[NumberOfTables - 1]->OutBits;
+	unsigned char	Level = UniformTables(S, NumberOfTables);
+	uint64_t		Expected = BlockSize >> Level;
+	uint64_t		BlockMask = ((uint64_t)1 << BlockSize) - 1;
+	unsigned int	v;
+	unsigned char	w, k;
+
+	if (S->Refreshed[NumberOfTables - 1])
+		return(1);
+
+	for (v = 0; v < (1U << (Level - 1)); v++)
+	{
+		Old = S->Ind[Level - 1][v];
+		New0 = S->Ind[Level][v];
+		New1 = S->Ind[Level][v | (1 << (Level - 1))];
+
+		for (w = 0; w < NumberOfMasked / 64; w++)
+		{
+			New0[w] = Old[w] & ~Out[w];
+			New1[w] = Old[w] & Out[w];
+
+			for (k = 0; k < 64; k += BlockSize)
+				if ((__builtin_popcountll((New0[w] >> k) & BlockMask) != Expected) ||
+					(__builtin_popcountll((New1[w] >> k) & BlockMask) != Expected))
+					return(0);
+		}
+	}
+
+	return(1);
+}
+
+void WriteCombination(FILE* F, Rowstruct** Row, unsigned char* Refreshed)
+{
+	unsigned char	index;
+
+	// the refreshed output bits first
+	if (MaxRefreshedBits)
+	{
+		for (index = 0; index < NumberOfOutputBits; index++)
+			if (Refreshed[index])
+				fprintf(F, "%d", Bits[index]);
+		fprintf(F, NumberOfRefreshed ? ", " : "-, ");
+	}
+
+	for (index = 0; index < NumberOfOutputBits; index++)
+		fprintf(F, "%s, ", Row[index]->Strings);
+	fprintf(F, "\n");
+}
+
+// every row of the classes S->i
+void WriteRows(FILE* F, Searchstruct* S, Rowstruct** Row, unsigned char index)
+{
+	unsigned int	i;
+
+	if (index == NumberOfOutputBits)
+	{
+		WriteCombination(F, Row, S->Refreshed);
+		return;
+	}
+
+	for (i = ClassStart[index][S->i[index]]; i < ClassStart[index][S->i[index] + 1]; i++)
+	{
+		Row[index] = &Rows[index][i];
+		WriteRows(F, S, Row, index + 1);
+	}
+}
+
+// the rows of the classes S->i into the heap, as long as they are cheaper than its top
+void KeepCheapest(Searchstruct* S, unsigned int* Row, unsigned char index, unsigned int Cost)
+{
+	Beststruct		Temp;
+	unsigned int	Bound;
+	unsigned int	i, j, c;
+
+	if (index == NumberOfOutputBits)
+	{
+		#pragma omp critical (best)
+		if (Cost < BoundCost)
+		{
+			// the new combination replaces the top of a full heap, and is sifted down, or is added and sifted up
+			if (NumberOfBest == TopK)
+			{
+				j = 0;
+				Best[0].Cost = Cost;
+				memcpy(Best[0].Row, Row, sizeof(Best[0].Row));
+				memcpy(Best[0].Refreshed, S->Refreshed, sizeof(Best[0].Refreshed));
+				while ((c = 2 * j + 1) < NumberOfBest)
+				{
+					if ((c + 1 < NumberOfBest) && (Best[c + 1].Cost > Best[c].Cost))
+						c++;
+					if (Best[c].Cost <= Best[j].Cost)
+						break;
+					Temp = Best[c];
+					Best[c] = Best[j];
+					Best[j] = Temp;
+					j = c;
+				}
+			}
+			else
+			{
+				j = NumberOfBest++;
+				Best[j].Cost = Cost;
+				memcpy(Best[j].Row, Row, sizeof(Best[j].Row));
+				memcpy(Best[j].Refreshed, S->Refreshed, sizeof(Best[j].Refreshed));
+				while (j && (Best[(j - 1) / 2].Cost < Best[j].Cost))
+				{
+					Temp = Best[(j - 1) / 2];
+					Best[(j - 1) / 2] = Best[j];
+					Best[j] = Temp;
+					j = (j - 1) / 2;
+				}
+			}
+
+			if (NumberOfBest == TopK)
+			{
+				#pragma omp atomic write
+				BoundCost = Best[0].Cost;
+			}
+		}
+		return;
+	}
+
+	// the rows of a class are sorted by cost
+	for (i = ClassStart[index][S->i[index]]; i < ClassStart[index][S->i[index] + 1]; i++)
+	{
+		#pragma omp atomic read
+		Bound = BoundCost;
+		if (Cost + Rows[index][i].Cost + S->Cost[NumberOfOutputBits] - S->Cost[index + 1] >= Bound)
+			break;
+
+		Row[index] = i;
+		KeepCheapest(S, Row, index + 1, Cost + Rows[index][i].Cost);
+	}
+}
+
+int CompareBest(const void* a, const void* b)
+{
+	if (((Beststruct*)a)->Cost != ((Beststruct*)b)->Cost)
+		return((((Beststruct*)a)->Cost < ((Beststruct*)b)->Cost) ? -1 : 1);
+	return(memcmp(((Beststruct*)a)->Row, ((Beststruct*)b)->Row, sizeof(((Beststruct*)a)->Row)));
+}
+
+// the classes of the first Stage tables and the cheapest rows of the other output bits cost at least BoundCost
+unsigned char CutByCost(Searchstruct* S, unsigned char Stage)
+{
+	unsigned int	Cost;
+	unsigned int	Bound;
+	unsigned char	index;
+
+	if (!TopK)
+		return(0);
+
+	S->Cost[Stage + 1] = S->Cost[Stage] + Rows[Stage][ClassStart[Stage][S->i[Stage]]].Cost;
+	Cost = S->Cost[Stage + 1];
+	for (index = Stage + 1; index < NumberOfOutputBits; index++)
+		Cost += MinCost[index];
+
+	#pragma omp atomic read
+	Bound = BoundCost;
+
+	return(Cost >= Bound);
+}
+
+// the output bit Stage is refreshed or not, the combination taking NumberOfRefreshed refreshed bits in all
+unsigned char RefreshAllowed(Searchstruct* S, unsigned char Stage, unsigned char Refresh)
+{
+	if (Refresh)
+		return(S->NumberOfRefreshed < NumberOfRefreshed);
+
+	return(NumberOfRefreshed - S->NumberOfRefreshed < NumberOfOutputBits - Stage);
+}
+
+void Combine(Searchstruct* S, unsigned char Stage, char* OutFilePath, uint64_t &NumberOfFound)
+{
+	FILE*			F;
+	Rowstruct*		Row[MaxNumberOfOutputBits];
+	unsigned int	BestRow[MaxNumberOfOutputBits];
+	uint64_t		Product;
+	unsigned int	i;
+	unsigned char	index;
+	unsigned char	Refresh;
+
+	if (Stage == NumberOfOutputBits)
+	{
+		Product = 1;
+		for (index = 0; index < NumberOfOutputBits; index++)
+			Product *= ClassStart[index][S->i[index] + 1] - ClassStart[index][S->i[index]];
+
+		if (TopK)
+		{
+			KeepCheapest(S, BestRow, 0, 0);
+
+			#pragma omp atomic
+			NumberOfFound += Product;
+			return;
+		}
+
+		#pragma omp critical (found)
+		{
+			NumberOfFound += Product;
+
+			if (!CountOnly)
+			{
+				F = fopen(OutFilePath, "at");
+				WriteRows(F, S, Row, 0);
+				fclose(F);
+			}
+		}
+
+		return;
+	}
+
+	for (i = 0; i < NumberOfClasses[Stage]; i++)
+	{
+		S->i[Stage] = i;
+		S->Row[Stage] = &Rows[Stage][ClassStart[Stage][i]];
+		if (CutByCost(S, Stage))
+			continue;
+
+		for (Refresh = 0; Refresh < 2; Refresh++)
+		{
+			if (!RefreshAllowed(S, Stage, Refresh))
+				continue;
+
+			S->Refreshed[Stage] = Refresh;
+			S->NumberOfRefreshed += Refresh;
+			if ((ClassesByOutBits ? CheckUniformityBits(S, Stage + 1) : CheckUniformity(S, Stage + 1)) && CheckProbeSets(S, Stage))
+				Combine(S, Stage + 1, OutFilePath, NumberOfFound);
+			S->NumberOfRefreshed -= Refresh;
+		}
+	}
+}
+
+int main()
+{
+	char			OutFilePath[500];
+	FILE*			F;
+	uint64_t		NumberOfFound;
+	Rowstruct*		Row[MaxNumberOfOutputBits];
+	unsigned int	j;
+	int				i0;
+	unsigned char	index;
+	unsigned char	Refresh;
+
+	// the uniformity keys take NumberOfShares - 1 bits of every table, the masked inputs are counted on 32 bits
+	if (((NumberOfShares - 1) * NumberOfOutputBits > MaxKeyWidth) || (NumberOfSboxBits * NumberOfShares > 30))
+	{
+		printf("too many output bits or S-box bits for %d shares\n", NumberOfShares);
+		return 1;
+	}
+
+	FillTables();
+
+	for (index = 0; index < NumberOfOutputBits; index++)
+	{
+		ReadRows(index);
+		FillClasses(index);
+	}
+
+	CompileProbeSpec();
+	FillProbeSets();
+
+	strcpy(OutFilePath, path);
+	for (index = 0; index < NumberOfOutputBits; index++)
+		sprintf(OutFilePath, "%s%d", OutFilePath, Bits[index]);
+
+	strcat(OutFilePath, CountOnly ? "_count.csv" : ".csv");
+	F = fopen(OutFilePath, "wt");
+	fclose(F);
+
+	omp_set_num_threads(NumberOfThreads);
+
+	Best = TopK ? (Beststruct*)malloc(TopK * sizeof(Beststruct)) : NULL;
+
+	for (NumberOfRefreshed = 0; NumberOfRefreshed <= MaxRefreshedBits; NumberOfRefreshed++)
+	{
+		NumberOfFound = 0;
+		NumberOfBest = 0;
+		BoundCost = 0xffffffff;
+
+		#pragma omp parallel
+		{
+			Searchstruct	S;
+
+			S.Counter = (int*)calloc(1 << MaxKeyWidth, sizeof(int));
+			S.Keys = (uint32_t*)malloc((StreamTables ? (1 << MaxKeyWidth) : (2 * BlockSize)) * sizeof(uint32_t));
+			S.Reference = StreamTables ? (int*)calloc(1 << MaxKeyWidth, sizeof(int)) : NULL;
+			memset(S.Ind[0][0], 0xff, sizeof(S.Ind[0][0]));
+			S.NumberOfRefreshed = 0;
+			S.Cost[0] = 0;
+
+			#pragma omp for schedule(dynamic)
+			for (i0 = 0; i0 < (int)NumberOfClasses[0]; i0++)
+			{
+				S.i[0] = i0;
+				S.Row[0] = &Rows[0][ClassStart[0][i0]];
+				if (CutByCost(&S, 0) || (CheckWithinTables && (!CheckProbeSets(&S, 0))))
+					continue;
+
+				for (Refresh = 0; Refresh < 2; Refresh++)
+				{
+					if (!RefreshAllowed(&S, 0, Refresh))
+						continue;
+
+					S.Refreshed[0] = Refresh;
+					S.NumberOfRefreshed = Refresh;
+					if ((!ClassesByOutBits) || CheckUniformityBits(&S, 1))
+						Combine(&S, 1, OutFilePath, NumberOfFound);
+				}
+
+				#pragma omp critical (print)
+				printf("%d / %d found %" PRIu64 "\n", i0, NumberOfClasses[0], NumberOfFound);
+			}
+
+			free(S.Counter);
+			free(S.Keys);
+			free(S.Reference);
+		}
+
+		F = fopen(OutFilePath, "at");
+
+		// the cheapest combinations, with their cost first
+		qsort(Best, NumberOfBest, sizeof(Beststruct), CompareBest);
+		for (j = 0; j < NumberOfBest; j++)
+		{
+			for (index = 0; index < NumberOfOutputBits; index++)
+				Row[index] = &Rows[index][Best[j].Row[index]];
+			fprintf(F, "%d, ", Best[j].Cost);
+			WriteCombination(F, Row, Best[j].Refreshed);
+		}
+
+		if (MaxRefreshedBits)
+			fprintf(F, "refreshed %d, fresh bits %d, ", NumberOfRefreshed, NumberOfRefreshed * (NumberOfShares - 1));
+		fprintf(F, "total, %" PRIu64 "\n", NumberOfFound);
+		fclose(F);
+
+		if (MaxRefreshedBits)
+			printf("%d output bits refreshed, %d fresh bits: %" PRIu64 " combinations\n",
+				NumberOfRefreshed, NumberOfRefreshed * (NumberOfShares - 1), NumberOfFound);
+
+		if (NumberOfFound)
+			break;
+	}
+
+	free(Best);
+
+	printf("done");
+
+	return 0;
+}
@@ -0,0 +1,2074 @@
+/*
+* -----------------------------------------------------------------
+* COMPANY : Ruhr University Bochum
+* AUTHOR  : Amir Moradi amir.moradi@rub.de Aein Rezaei Shahmirzadi aein.rezaeishahmirzadi@rub.de
+* DOCUMENT: "Second-Order SCA Security with almost no Fresh Randomness" TCHES 2021, Issue 3
+* -----------------------------------------------------------------
+*
+* Copyright c 2021, Amir Moradi, Aein Rezaei Shahmirzadi
+*
+* All rights reserved.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTERS BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* INCLUDING NEGLIGENCE OR OTHERWISE ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+* Please see LICENSE and README for license and further instructions.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <inttypes.h>
+#include <omp.h>
+
+// the coordinate search of FindCoordinateFunction1.cpp for any number of shares: 3 gives the second-order sharings
+// of the other searches (24576 rows for Ascon bit 1), 4 the third-order ones with probes of up to 3 wires and 2 the
+// first-order ones of Chi_2shares
+const unsigned char	NumberOfShares = 3; // 2, 3 or 4
+const unsigned char	NumberOfOutputShares = 3; // NumberOfShares, or 3 with 2 shares (groups of 2, 1 and 1 components)
+// the S-box is given by its truth table, bit i of the input being the variable 'a' + i; its coordinate OutputBit has
+// to be x & y with linear terms, x, y and z being linear forms of the input bits (a quadratic part of rank 2)
+const unsigned char	NumberOfSboxBits = 5; // 4 to 8
+const unsigned char	Sbox[1 << 8] = { 0x04, 0x0b, 0x1f, 0x14, 0x1a, 0x15, 0x09, 0x02, 0x1b, 0x05, 0x08, 0x12, 0x1d, 0x03, 0x06, 0x1c,
+									  0x1e, 0x13, 0x07, 0x0e, 0x00, 0x0d, 0x11, 0x18, 0x10, 0x0c, 0x01, 0x19, 0x16, 0x0a, 0x0f, 0x17 }; // Ascon
+const unsigned char	OutputBit = 1;
+const unsigned char	AllOutputBits = 0; // every coordinate, the ones with the same target being searched once
+// only the Types in which every output share takes every share of x and of y once; with 3 shares they leave out the
+// Type 012345678 of the other searches, the only one whose groups all have tuples, and with 4 shares Ascon bit 1 has
+// no tuples in them
+const unsigned char	LatinTypesOnly = 0;
+const unsigned char	TypesUpToRelabelling = 1; // a Type is skipped if relabelling the shares of x and y gives an earlier one
+const unsigned char	ChoicesUpToRelabelling = 1; // a tuple of the first group is skipped if relabelling the shares of z gives a smaller one
+const unsigned int	MaxNumberOfSolutions = 0; // 0: all
+const unsigned int	MaxNumberOfSolutionsPerANF = 0; // solutions kept for each tuple of the first group, 0: all
+// the components are x_i & y_j ^ Q, 0: Q = a x_i ^ b y_j ^ z_k as in the 3-share searches, 1: every linear Q,
+// 2: every quadratic Q, over x_i, y_j and at most MaxZShares shares of z (fewer than NumberOfShares)
+const unsigned char	ComponentFamily = 0;
+const unsigned char	MaxZShares = 1;
+// the probe sets that are checked, ';' between the sets and ' ' between their probes: MO an output share after its
+// register, Full the inputs of a component (a glitch on it), Pair (z_k, x_i) of the former stage and * any;
+// a set is checked if it has the probes of one of the sets given, with 2 up to NumberOfShares - 1 probes, every
+// unmasked input having to give it the distribution of the first (the Dis checks of the per-S-box programs are not
+// read from it)
+const char			ProbeSpec[200] = "MO *; MO * *";
+// the tuples of every group that pass ExtendGroup are kept in ProbeMasks_*.csv with a bit for the balance of the output
+// share and one for every probe set, a later run with another ProbeSpec only checks the sets that are not in the file
+const unsigned char	KeepProbeMasks = 0;
+const unsigned char	NumberOfThreads = 22;
+
+#define	MaxNumberOfShares 4
+#define	MaxNumberOfPairs (MaxNumberOfShares * MaxNumberOfShares)
+#define	MaxNumberOfChoices 65535
+#define	MaxNumberOfRelabellings (24 * 24)
+#define	MaxNumberOfSboxBits 8
+#define	MaxNumberOfWires (3 * MaxNumberOfSboxBits)
+#define	MaxNumberOfGroupSets 2047 // with KeepProbeMasks
+#define	MaxTableBits 16 // the tables of the output shares are written up to 2^16 masked inputs, FindCombination evaluates larger ones
+
+#define	MaxNumberOfTerms 1000000000L
+
+unsigned char   *HW;
+unsigned int    *NumberOfIndexesInHW;
+unsigned long  **IndexesInHW;
+
+void FillANFTables(unsigned int NumberOfCells)
+{
+	unsigned int	i, Bit;
+	unsigned char	NumberOfBits = log((double)NumberOfCells) / log((double)2);
+
+	HW = (unsigned char *)malloc(NumberOfCells * sizeof(unsigned char));
+
+	NumberOfIndexesInHW = (unsigned int *)malloc((NumberOfBits + 1) * sizeof(unsigned int));
+	IndexesInHW = (unsigned long **)malloc((NumberOfBits + 1) * sizeof(unsigned long *));
+
+	for (Bit = 0; Bit < (NumberOfBits + 1); Bit++)
+	{
+		IndexesInHW[Bit] = (unsigned long *)malloc((NumberOfCells / 2) * sizeof(unsigned long));
+		NumberOfIndexesInHW[Bit] = 0;
+	}
+
+	for (i = 0; i < NumberOfCells; i++)
+	{
+		HW[i] = 0;
+
+		for (Bit = 0; Bit < NumberOfBits; Bit++)
+			HW[i] += ((i & (1L << Bit)) >> Bit);
+
+		IndexesInHW[HW[i]][NumberOfIndexesInHW[HW[i]]] = i;
+		NumberOfIndexesInHW[HW[i]]++;
+	}
+}
+
+struct FunctionStruct
+{
+	unsigned int		NumberOfTerms;
+	unsigned __int64   *Term;
+};
+
+void DefineFunction(FunctionStruct *F, unsigned short NumberOfTerms)
+{
+	F->Term = (unsigned __int64 *)malloc(NumberOfTerms * sizeof(unsigned __int64));
+}
+
+void FreeFunction(FunctionStruct *F)
+{
+	free(F->Term);
+}
+
+unsigned char EvalFunction(FunctionStruct *Function, unsigned __int64 Input)
+{
+	unsigned char	Res = 0;
+	unsigned int	i;
+
+	for (i = 0; i < Function->NumberOfTerms; i++)
+		Res ^= ((Function->Term[i] & Input) == Function->Term[i]);
+
+	return (Res);
+}
+
+void AddTermtoFunction(FunctionStruct *Function, unsigned __int64 Symbol)
+{
+	Function->Term[Function->NumberOfTerms] = Symbol;
+	Function->NumberOfTerms++;
+}
+
+void MakeANF(unsigned char* Table, unsigned int NumberOfElements, FunctionStruct* Functions, unsigned char NumberOfOutputBits, unsigned char Invert)
+{
+	unsigned char   NumberOfBits = log((double)NumberOfElements) / log((double)2);
+	unsigned char	Bit, HWIndex;
+	unsigned int	i;
+
+	for (Bit = 0; Bit < NumberOfOutputBits; Bit++)
+	{
+		Functions[Bit].NumberOfTerms = 0;
+
+		for (HWIndex = 0; HWIndex < (NumberOfBits + 1); HWIndex++)
+			for (i = 0; i < NumberOfIndexesInHW[HWIndex]; i++)
+				if (IndexesInHW[HWIndex][i] < NumberOfElements)
+					if (EvalFunction(&Functions[Bit], IndexesInHW[HWIndex][i]) != (((Table[IndexesInHW[HWIndex][i]] ^ Invert) >> Bit) & 1))
+						AddTermtoFunction(&Functions[Bit], IndexesInHW[HWIndex][i]);
+	}
+}
+
+void SPrintFunction(FunctionStruct Function, char* ResStr, char InputStr[][5])
+{
+	unsigned int		i, j;
+	unsigned __int64	ONE;
+
+	ResStr[0] = 0;
+
+	for (i = 0; i < Function.NumberOfTerms; i++)
+	{
+		if (i)
+			strcat(ResStr, " + ");
+
+		if (Function.Term[i])
+		{
+			ONE = 1;
+
+			for (j = 0; j < 64; j++)
+			{
+				if (Function.Term[i] & ONE)
+					sprintf(ResStr, "%s%s", ResStr, InputStr[j]);
+
+				ONE <<= 1;
+			}
+		}
+		else
+			strcat(ResStr, "1");
+	}
+}
+
+//---------------------------------------------------------------------------
+
+// a component takes share i of x and share j of y (pair i * NumberOfShares + j) and is x_i & y_j ^ Q for its choice n,
+// an output share is the XOR of the components of its group, each group being registered before the XOR
+unsigned int	NumberOfPairs;
+unsigned int	NumberOfChoices;
+uint64_t*		ChoiceQ; // bit m for the term of the local variables m: bit 0 x_i, bit 1 y_j, bit 2 + s z_s
+unsigned char*	ChoiceZ; // the shares of z taken by Q
+unsigned int	NumberOfMasked; // masked inputs, the unmasked input x y z followed by the NumberOfShares - 1 masks
+unsigned int	BlockSize; // masked inputs of one unmasked input
+unsigned int	WordsPerBlock;
+unsigned int	NumberOfWords;
+unsigned char	GroupStart[MaxNumberOfShares + 1]; // the components of group g are GroupStart[g] ... GroupStart[g + 1] - 1
+unsigned char	GroupSize[MaxNumberOfShares];
+
+uint64_t**		CompBits[MaxNumberOfPairs]; // bitsliced, bit i of the table in bit (i & 63) of word i >> 6
+uint64_t*		CompANF[MaxNumberOfPairs]; // the linear terms, then the quadratic ones other than x_i & y_j, see ANFBit
+unsigned char*	FullValue[MaxNumberOfPairs][1 << MaxNumberOfShares]; // (z shares, y_j, x_i) as seen by a glitch on a component
+unsigned char*	PairValue[MaxNumberOfPairs]; // (z_k, x_i) for i * NumberOfShares + k
+uint64_t*		ValidBits;
+unsigned short*	OutputTableIndex; // x_1 ... x_NumberOfShares y_1 ... z_NumberOfShares, x_1 the most significant
+unsigned char*	UnmaskedInputTable;
+unsigned char	Parity[256];
+
+// a coordinate function of the S-box, x & y with linear terms
+typedef struct {
+	unsigned char	OutputBit;
+	unsigned char	Forms[3]; // x, y and z as masks of the input bits
+	unsigned char	TargetFunc[8]; // over x y z, x the least significant, the constant apart
+	unsigned char	Invert;
+	unsigned short*	TableIndex;
+	char			FileName[100];
+} Coordinatestruct;
+
+// the coordinates with the same target, the solutions of the search being written for each of them
+typedef struct {
+	unsigned char		NumberOfCoordinates;
+	Coordinatestruct*	Coordinates[MaxNumberOfSboxBits];
+} Batchstruct;
+
+// the choices of the family, each Q once: its shares of z are the ones it takes, never all of them
+void FillChoices()
+{
+	unsigned char	Terms[64];
+	unsigned char	NumberOfTerms;
+	unsigned int	Z, m, Used;
+	uint64_t		Q;
+	unsigned char	Pass, t;
+
+	for (Pass = 0; Pass < 2; Pass++)
+	{
+		NumberOfChoices = 0;
+
+		if (ComponentFamily == 0)
+		{
+			for (m = 0; m < 4 * (NumberOfShares + 1); m++)
+			{
+				if (Pass)
+				{
+					ChoiceQ[NumberOfChoices] = ((m & 1) ? ((uint64_t)1 << 1) : 0) | ((m & 2) ? ((uint64_t)1 << 2) : 0) |
+						((m >> 2) ? ((uint64_t)1 << (4 << ((m >> 2) - 1))) : 0);
+					ChoiceZ[NumberOfChoices] = (m >> 2) ? (1 << ((m >> 2) - 1)) : 0;
+				}
+				NumberOfChoices++;
+			}
+		}
+		else
+			for (Z = 0; Z < (1U << NumberOfShares) - 1; Z++)
+			{
+				if (__builtin_popcount(Z) > MaxZShares)
+					continue;
+
+				// the terms over x_i, y_j and the shares Z of z, x_i & y_j apart
+				NumberOfTerms = 0;
+				for (m = 1; m < (4U << NumberOfShares); m++)
+					if ((((m >> 2) & ~Z) == 0) && (m != 3) && (__builtin_popcount(m) <= ComponentFamily))
+						Terms[NumberOfTerms++] = m;
+
+				for (Q = 0; Q < ((uint64_t)1 << NumberOfTerms); Q++)
+				{
+					Used = 0;
+					for (t = 0; t < NumberOfTerms; t++)
+						if ((Q >> t) & 1)
+							Used |= Terms[t] >> 2;
+					if (Used != Z)
+						continue;
+
+					if (NumberOfChoices == MaxNumberOfChoices)
+					{
+						printf("more than %d choices\n", MaxNumberOfChoices);
+						exit(1);
+					}
+
+					if (Pass)
+					{
+						ChoiceQ[NumberOfChoices] = 0;
+						for (t = 0; t < NumberOfTerms; t++)
+							if ((Q >> t) & 1)
+								ChoiceQ[NumberOfChoices] |= (uint64_t)1 << Terms[t];
+						ChoiceZ[NumberOfChoices] = Z;
+					}
+					NumberOfChoices++;
+				}
+			}
+
+		if (!Pass)
+		{
+			ChoiceQ = (uint64_t*)malloc(NumberOfChoices * sizeof(uint64_t));
+			ChoiceZ = (unsigned char*)malloc(NumberOfChoices * sizeof(unsigned char));
+		}
+	}
+
+	printf("%d choices for every component\n", NumberOfChoices);
+}
+
+// the bit of the ANF for a linear (Var2 = Var1) or quadratic term of the variables x_s (s), y_s (NumberOfShares + s)
+// and z_s (2 * NumberOfShares + s); the linear ones as in the target, the quadratic ones numbered as they come
+unsigned char	QuadraticBit[3 * MaxNumberOfShares][3 * MaxNumberOfShares];
+unsigned char	NumberOfANFBits;
+
+unsigned char ANFBit(unsigned char Var1, unsigned char Var2)
+{
+	if (Var1 == Var2)
+		return(3 * NumberOfShares - 1 - (Var1 % NumberOfShares) - NumberOfShares * (Var1 / NumberOfShares));
+
+	if (!QuadraticBit[Var1][Var2])
+	{
+		if (NumberOfANFBits == 64)
+		{
+			printf("more than %d quadratic terms\n", 64 - 3 * NumberOfShares);
+			exit(1);
+		}
+
+		QuadraticBit[Var1][Var2] = QuadraticBit[Var2][Var1] = NumberOfANFBits++;
+	}
+
+	return(QuadraticBit[Var1][Var2]);
+}
+
+void FillTableIndexes()
+{
+	unsigned int	Masked_InputIndex;
+	unsigned char	ShareValue[MaxNumberOfShares];
+	unsigned char	Unmasked;
+	unsigned char	a, b, c;
+	unsigned char	Var[2 + MaxNumberOfShares];
+	unsigned char	Local;
+	unsigned char	p, k, s, v, g;
+	unsigned int	n, m, Z;
+	uint64_t		Q;
+	unsigned int	i, j;
+
+	NumberOfPairs = NumberOfShares * NumberOfShares;
+	NumberOfMasked = 1 << (3 * NumberOfShares);
+	BlockSize = 1 << (3 * (NumberOfShares - 1));
+	WordsPerBlock = (BlockSize + 63) / 64;
+	NumberOfWords = (NumberOfMasked + 63) / 64; // a single word with 2 shares, the tables stay in registers
+
+	// the first groups take the remaining components
+	GroupStart[0] = 0;
+	for (g = 0; g < NumberOfOutputShares; g++)
+	{
+		GroupSize[g] = NumberOfPairs / NumberOfOutputShares + (g < (NumberOfPairs % NumberOfOutputShares));
+		GroupStart[g + 1] = GroupStart[g] + GroupSize[g];
+	}
+
+	NumberOfANFBits = 3 * NumberOfShares;
+	for (p = 0; p < NumberOfPairs; p++)
+	{
+		// the local variables x_i, y_j, z_0 ... of the pair
+		Var[0] = p / NumberOfShares;
+		Var[1] = NumberOfShares + p % NumberOfShares;
+		for (s = 0; s < NumberOfShares; s++)
+			Var[2 + s] = 2 * NumberOfShares + s;
+
+		CompBits[p] = (uint64_t**)malloc(NumberOfChoices * sizeof(uint64_t*));
+		CompANF[p] = (uint64_t*)calloc(NumberOfChoices, sizeof(uint64_t));
+		for (n = 0; n < NumberOfChoices; n++)
+		{
+			CompBits[p][n] = (uint64_t*)calloc(NumberOfWords, sizeof(uint64_t));
+			for (m = 1; m < (4U << NumberOfShares); m++)
+				if ((ChoiceQ[n] >> m) & 1)
+					CompANF[p][n] |= (uint64_t)1 << ANFBit(Var[__builtin_ctz(m)], Var[31 - __builtin_clz(m)]);
+		}
+
+		for (Z = 0; Z < (1U << NumberOfShares); Z++)
+			FullValue[p][Z] = (unsigned char*)malloc(NumberOfMasked * sizeof(unsigned char));
+
+		PairValue[p] = (unsigned char*)malloc(NumberOfMasked * sizeof(unsigned char));
+	}
+
+	ValidBits = (uint64_t*)calloc(NumberOfWords, sizeof(uint64_t));
+	OutputTableIndex = (unsigned short*)malloc(NumberOfMasked * sizeof(unsigned short));
+	UnmaskedInputTable = (unsigned char*)malloc(NumberOfMasked * sizeof(unsigned char));
+
+	for (Masked_InputIndex = 0; Masked_InputIndex < NumberOfMasked; Masked_InputIndex++)
+	{
+		Unmasked = Masked_InputIndex >> (3 * (NumberOfShares - 1));
+		ShareValue[NumberOfShares - 1] = Unmasked;
+		for (s = 0; s < NumberOfShares - 1; s++)
+		{
+			ShareValue[s] = (Masked_InputIndex >> (3 * (NumberOfShares - 2 - s))) & 7;
+			ShareValue[NumberOfShares - 1] ^= ShareValue[s];
+		}
+
+		OutputTableIndex[Masked_InputIndex] = 0;
+		for (v = 0; v < 3; v++)
+			for (s = 0; s < NumberOfShares; s++)
+				OutputTableIndex[Masked_InputIndex] = (OutputTableIndex[Masked_InputIndex] << 1) | ((ShareValue[s] >> v) & 1);
+
+		UnmaskedInputTable[Masked_InputIndex] = Unmasked;
+
+		i = Masked_InputIndex >> 6;
+		ValidBits[i] |= (uint64_t)1 << (Masked_InputIndex & 63);
+
+		for (p = 0; p < NumberOfPairs; p++)
+		{
+			a = (ShareValue[p / NumberOfShares] >> 0) & 1;
+			b = (ShareValue[p % NumberOfShares] >> 1) & 1;
+
+			Local = (b << 1) | a;
+			for (s = 0; s < NumberOfShares; s++)
+				Local |= ((ShareValue[s] >> 2) & 1) << (2 + s);
+
+			for (Z = 0; Z < (1U << NumberOfShares); Z++)
+			{
+				FullValue[p][Z][Masked_InputIndex] = (b << 1) | a;
+				for (k = 2, s = 0; s < NumberOfShares; s++)
+					if ((Z >> s) & 1)
+						FullValue[p][Z][Masked_InputIndex] |= ((Local >> (2 + s)) & 1) << k++;
+			}
+
+			for (n = 0; n < NumberOfChoices; n++)
+			{
+				c = a & b;
+				for (Q = ChoiceQ[n]; Q; Q &= Q - 1)
+					if ((Local & __builtin_ctzll(Q)) == __builtin_ctzll(Q))
+						c ^= 1;
+				CompBits[p][n][i] |= (uint64_t)c << (Masked_InputIndex & 63);
+			}
+
+			PairValue[p][Masked_InputIndex] = (((ShareValue[p % NumberOfShares] >> 2) & 1) << 1) | ((ShareValue[p / NumberOfShares] >> 0) & 1);
+		}
+	}
+
+	for (j = 0; j < 256; j++)
+	{
+		Parity[j] = 0;
+		for (k = 0; k < 8; k++)
+			Parity[j] ^= (j >> k) & 1;
+	}
+}
+
+//---------------------------------------------------------------------------
+
+// a probe set is a set of at most NumberOfShares - 1 glitch-extended probes of ProbeSpec, by default containing at
+// least one output share; the joint distribution of their values must be the same for every unmasked input
+#define	ObjectMO	0 // the components of an output share, as seen by a probe after the register of the group
+#define	ObjectFull	1 // the inputs of a component
+#define	ObjectPair	2 // (z_k, x_i) of the former stage
+
+typedef struct {
+	unsigned char	NumberOfObjects;
+	unsigned char	Kind[3];
+	unsigned char	Index[3]; // MO: group, Full: component (group * NumberOfShares + position), Pair: i * NumberOfShares + k
+	unsigned char	Stage; // the last group it depends on
+} ProbeSetstruct;
+
+ProbeSetstruct*	GroupSets; // within one group, the components being its positions, the set of the group alone excluded
+unsigned int	NumberOfGroupSets;
+ProbeSetstruct*	CombinationSets; // the rest, sorted by stage
+unsigned int	StageStart[MaxNumberOfShares + 1];
+
+// the sets of ProbeSpec by the number of their probes of every kind
+#define	MaxNumberOfProbeShapes 32
+
+typedef struct {
+	unsigned char	Size;
+	unsigned char	Count[4]; // MO, Full, Pair and any
+} ProbeShapestruct;
+
+ProbeShapestruct	ProbeShapes[MaxNumberOfProbeShapes];
+unsigned int		NumberOfProbeShapes;
+
+void CompileProbeSpec()
+{
+	const char		Names[4][5] = { "MO", "Full", "Pair", "*" };
+	char			Word[10];
+	const char*		c;
+	unsigned char	l, k;
+
+	memset(ProbeShapes, 0, sizeof(ProbeShapes));
+	NumberOfProbeShapes = 0;
+	l = 0;
+	for (c = ProbeSpec; ; c++)
+	{
+		if ((*c != ' ') && (*c != ';') && (*c != 0))
+		{
+			if (l < 9)
+				Word[l++] = *c;
+			continue;
+		}
+
+		if (l)
+		{
+			Word[l] = 0;
+			for (k = 0; (k < 4) && strcmp(Word, Names[k]); k++);
+			if ((k == 4) || (ProbeShapes[NumberOfProbeShapes].Size == 3))
+			{
+				printf("%s is not a probe, or more than 3 probes in a set of %s\n", Word, ProbeSpec);
+				exit(1);
+			}
+
+			ProbeShapes[NumberOfProbeShapes].Count[k]++;
+			ProbeShapes[NumberOfProbeShapes].Size++;
+			l = 0;
+		}
+
+		if ((*c != ' ') && ProbeShapes[NumberOfProbeShapes].Size)
+		{
+			if (ProbeShapes[NumberOfProbeShapes].Size < 2)
+			{
+				printf("a probe set of %s has a single probe\n", ProbeSpec);
+				exit(1);
+			}
+
+			if (++NumberOfProbeShapes == MaxNumberOfProbeShapes)
+			{
+				printf("more than %d probe sets in %s\n", MaxNumberOfProbeShapes - 1, ProbeSpec);
+				exit(1);
+			}
+		}
+
+		if (*c == 0)
+			break;
+	}
+}
+
+// the objects of a set, by their kinds, have the probes of a set of ProbeSpec
+unsigned char MatchesProbeSpec(unsigned char* Kind, unsigned int* o, unsigned char Size)
+{
+	unsigned char	Count[3] = { 0, 0, 0 };
+	unsigned int	i;
+	unsigned char	l;
+
+	for (l = 0; l < Size; l++)
+		Count[Kind[o[l]]]++;
+
+	for (i = 0; i < NumberOfProbeShapes; i++)
+		if ((ProbeShapes[i].Size == Size) && (Count[0] >= ProbeShapes[i].Count[0]) &&
+			(Count[1] >= ProbeShapes[i].Count[1]) && (Count[2] >= ProbeShapes[i].Count[2]))
+			return(1);
+
+	return(0);
+}
+
+char ObjectGroup(unsigned char Kind, unsigned char Index)
+{
+	if (Kind == ObjectMO)
+		return(Index);
+
+	if (Kind == ObjectFull)
+		return(Index / NumberOfShares);
+
+	return(-1);
+}
+
+void FillProbeSets()
+{
+	unsigned char	Kind[3 * MaxNumberOfPairs];
+	unsigned char	Index[3 * MaxNumberOfPairs];
+	unsigned int	NumberOfObjects;
+	unsigned int	o[3];
+	unsigned char	Size, Stage, l;
+	unsigned char	NumberOfMO, Local;
+	char			Group, g;
+	ProbeSetstruct	Set;
+	unsigned int	Count;
+	unsigned char	Pass;
+
+	// the objects of one group: its output share, its components and the pairs
+	NumberOfObjects = 0;
+	Kind[NumberOfObjects] = ObjectMO;
+	Index[NumberOfObjects++] = 0;
+	for (l = 0; l < NumberOfShares; l++)
+	{
+		Kind[NumberOfObjects] = ObjectFull;
+		Index[NumberOfObjects++] = l;
+	}
+	for (l = 0; l < NumberOfPairs; l++)
+	{
+		Kind[NumberOfObjects] = ObjectPair;
+		Index[NumberOfObjects++] = l;
+	}
+
+	for (Pass = 0; Pass < 2; Pass++)
+	{
+		Count = 0;
+		for (Size = 2; Size < NumberOfShares; Size++)
+			for (o[0] = 0; o[0] < NumberOfObjects; o[0]++)
+				for (o[1] = o[0] + 1; o[1] < NumberOfObjects; o[1]++)
+					for (o[2] = (Size > 2) ? (o[1] + 1) : 0; o[2] < ((Size > 2) ? NumberOfObjects : 1); o[2]++)
+					{
+						if (!MatchesProbeSpec(Kind, o, Size))
+							continue;
+
+						if (Pass)
+						{
+							GroupSets[Count].NumberOfObjects = Size;
+							GroupSets[Count].Stage = 0;
+							for (l = 0; l < Size; l++)
+							{
+								GroupSets[Count].Kind[l] = Kind[o[l]];
+								GroupSets[Count].Index[l] = Index[o[l]];
+							}
+						}
+						Count++;
+					}
+
+		if (!Pass)
+			GroupSets = (ProbeSetstruct*)malloc((Count + 1) * sizeof(ProbeSetstruct));
+	}
+	NumberOfGroupSets = Count;
+
+	//---------------------------------------
+
+	// the objects of a whole Type
+	NumberOfObjects = 0;
+	for (l = 0; l < NumberOfOutputShares; l++)
+	{
+		Kind[NumberOfObjects] = ObjectMO;
+		Index[NumberOfObjects++] = l;
+	}
+	for (l = 0; l < NumberOfPairs; l++)
+	{
+		Kind[NumberOfObjects] = ObjectFull;
+		Index[NumberOfObjects++] = l;
+	}
+	for (l = 0; l < NumberOfPairs; l++)
+	{
+		Kind[NumberOfObjects] = ObjectPair;
+		Index[NumberOfObjects++] = l;
+	}
+
+	for (Pass = 0; Pass < 2; Pass++)
+	{
+		Count = 0;
+		for (Stage = 0; Stage < NumberOfOutputShares; Stage++)
+		{
+			StageStart[Stage] = Count;
+
+			for (Size = 2; Size < NumberOfShares; Size++)
+				for (o[0] = 0; o[0] < NumberOfObjects; o[0]++)
+					for (o[1] = o[0] + 1; o[1] < NumberOfObjects; o[1]++)
+						for (o[2] = (Size > 2) ? (o[1] + 1) : 0; o[2] < ((Size > 2) ? NumberOfObjects : 1); o[2]++)
+						{
+							if (!MatchesProbeSpec(Kind, o, Size))
+								continue;
+
+							Set.NumberOfObjects = Size;
+							NumberOfMO = 0;
+							Local = 1;
+							Group = -1;
+							Set.Stage = 0;
+							for (l = 0; l < Size; l++)
+							{
+								Set.Kind[l] = Kind[o[l]];
+								Set.Index[l] = Index[o[l]];
+								NumberOfMO += (Set.Kind[l] == ObjectMO);
+								g = ObjectGroup(Set.Kind[l], Set.Index[l]);
+								if (g >= 0)
+								{
+									if ((Group >= 0) && (g != Group))
+										Local = 0;
+									Group = g;
+									if (g > Set.Stage)
+										Set.Stage = g;
+								}
+							}
+
+							if (Local || (Set.Stage != Stage))
+								continue;
+
+							if (Pass)
+								CombinationSets[Count] = Set;
+							Count++;
+						}
+		}
+		StageStart[NumberOfOutputShares] = Count;
+
+		if (!Pass)
+			CombinationSets = (ProbeSetstruct*)malloc((Count + 1) * sizeof(ProbeSetstruct));
+	}
+
+	printf("%d probe sets within a group, %d between the groups\n", NumberOfGroupSets + 1, StageStart[NumberOfOutputShares]);
+}
+
+// Counter is zero at the call and left so, Keys holds 2 * BlockSize entries
+// the key of the values of a probe set at a masked input, SameInEveryBlock being instantiated for 2 and 3 objects
+template <unsigned char NumberOfValues>
+static inline unsigned short ProbeKey(unsigned char* Values[3], unsigned char Widths[3], unsigned int i)
+{
+	unsigned short	Key = (Values[0][i] << Widths[1]) | Values[1][i];
+
+	if (NumberOfValues == 3)
+		Key = (Key << Widths[2]) | Values[2][i];
+
+	return(Key);
+}
+
+template <unsigned char NumberOfValues>
+unsigned char SameInEveryBlock(unsigned char* Values[3], unsigned char Widths[3], short* Counter, unsigned short* Keys)
+{
+	unsigned int	Block;
+	unsigned int	Offset;
+	unsigned int	Masked_InputIndex;
+	unsigned short*	Keys0 = Keys;
+	unsigned short*	Keys1 = Keys + BlockSize;
+	unsigned char	Same = 1;
+
+	for (Offset = 0; Offset < BlockSize; Offset++)
+		Keys0[Offset] = ProbeKey<NumberOfValues>(Values, Widths, Offset);
+
+	for (Block = 1; (Block < 8) && Same; Block++)
+	{
+		for (Offset = 0; Offset < BlockSize; Offset++)
+			Counter[Keys0[Offset]]++;
+
+		// with as many entries in both blocks, no negative counter means the same distribution
+		Masked_InputIndex = Block * BlockSize;
+		for (Offset = 0; Offset < BlockSize; Offset++, Masked_InputIndex++)
+		{
+			Keys1[Offset] = ProbeKey<NumberOfValues>(Values, Widths, Masked_InputIndex);
+
+			if (--Counter[Keys1[Offset]] < 0)
+			{
+				Same = 0;
+				Offset++;
+				break;
+			}
+		}
+
+		while (Offset)
+			Counter[Keys1[--Offset]] = 0;
+
+		for (Offset = 0; Offset < BlockSize; Offset++)
+			Counter[Keys0[Offset]] = 0;
+	}
+
+	return(Same);
+}
+
+unsigned char CheckProbeSets(ProbeSetstruct* Sets, unsigned int NumberOfSets, unsigned char** MOValue, unsigned char* Pairs,
+	unsigned short* Choice, short* Counter, unsigned short* Keys)
+{
+	unsigned char*	Values[3];
+	unsigned char	Widths[3];
+	unsigned int	i;
+	unsigned char	l;
+
+	for (i = 0; i < NumberOfSets; i++)
+	{
+		for (l = 0; l < Sets[i].NumberOfObjects; l++)
+		{
+			if (Sets[i].Kind[l] == ObjectMO)
+			{
+				Values[l] = MOValue[Sets[i].Index[l]];
+				Widths[l] = NumberOfShares;
+			}
+			else if (Sets[i].Kind[l] == ObjectFull)
+			{
+				Values[l] = FullValue[Pairs[Sets[i].Index[l]]][ChoiceZ[Choice[Sets[i].Index[l]]]];
+				Widths[l] = 2 + __builtin_popcount(ChoiceZ[Choice[Sets[i].Index[l]]]);
+			}
+			else
+			{
+				Values[l] = PairValue[Sets[i].Index[l]];
+				Widths[l] = 2;
+			}
+		}
+
+		if (!((Sets[i].NumberOfObjects == 3) ? SameInEveryBlock<3>(Values, Widths, Counter, Keys) :
+			SameInEveryBlock<2>(Values, Widths, Counter, Keys)))
+			return(0);
+	}
+
+	return(1);
+}
+
+//---------------------------------------------------------------------------
+
+typedef struct {
+	unsigned short	n[MaxNumberOfShares]; // the choice of every component, in the order of the pairs
+	uint64_t		ANF; // the linear terms and the quadratic ones other than the x_i & y_j, see ANFBit
+} Tuplestruct;
+
+// the tuples of a group only depend on its pairs, they are kept for the next Types
+typedef struct {
+	unsigned char	Done;
+	unsigned int	NumberOfTuples;
+	unsigned int	Size;
+	Tuplestruct*	Tuples;
+} GroupListstruct;
+
+GroupListstruct*	GroupLists; // indexed by the mask of the pairs
+
+// the tuples of a group with the checks they pass, bit 0: balance, bit 1 + k: GroupSets[k]
+typedef struct {
+	unsigned int	NumberOfCandidates;
+	unsigned int	Size;
+	unsigned int	NumberOfMaskWords;
+	unsigned short*	n; // NumberOfShares per candidate
+	uint64_t*		Passed; // NumberOfMaskWords per candidate
+} CandidateListstruct;
+
+unsigned int BlockCount(uint64_t* Bits, unsigned int Block)
+{
+	unsigned int	Count = 0;
+	unsigned int	w;
+
+	if (BlockSize < 64)
+		return(__builtin_popcountll((Bits[(Block * BlockSize) >> 6] >> ((Block * BlockSize) & 63)) & (((uint64_t)1 << BlockSize) - 1)));
+
+	for (w = Block * WordsPerBlock; w < (Block + 1) * WordsPerBlock; w++)
+		Count += __builtin_popcountll(Bits[w]);
+
+	return(Count);
+}
+
+// Ind[Depth][v] holds the masked inputs at which the first Depth components of the group take the value v,
+// the distribution of these components has to be the same for every unmasked input
+unsigned char ExtendGroup(uint64_t* Ind, unsigned char Depth, uint64_t* Comp)
+{
+	uint64_t*		Old;
+	uint64_t*		New0;
+	uint64_t*		New1;
+	unsigned int	Count0[8];
+	unsigned int	Count1[8];
+	unsigned int	v;
+	unsigned int	w;
+	unsigned char	Block;
+
+	for (v = 0; v < (1U << (Depth - 1)); v++)
+	{
+		Old = Ind + ((size_t)(Depth - 1) * (1 << NumberOfShares) + v) * NumberOfWords;
+		New0 = Ind + ((size_t)Depth * (1 << NumberOfShares) + v) * NumberOfWords;
+		New1 = New0 + ((size_t)1 << (Depth - 1)) * NumberOfWords;
+
+		for (w = 0; w < NumberOfWords; w++)
+		{
+			New0[w] = Old[w] & ~Comp[w];
+			New1[w] = Old[w] & Comp[w];
+		}
+
+		for (Block = 0; Block < 8; Block++)
+		{
+			Count0[Block] = BlockCount(New0, Block);
+			Count1[Block] = BlockCount(New1, Block);
+
+			if (Block && ((Count0[Block] != Count0[0]) || (Count1[Block] != Count1[0])))
+				return(0);
+		}
+	}
+
+	return(1);
+}
+
+void AddTuple(GroupListstruct* List, unsigned char* Pairs, unsigned char Size, unsigned short* n)
+{
+	unsigned char	l;
+
+	if (List->NumberOfTuples == List->Size)
+	{
+		List->Size = List->Size ? 2 * List->Size : 1024;
+		List->Tuples = (Tuplestruct*)realloc(List->Tuples, List->Size * sizeof(Tuplestruct));
+	}
+
+	List->Tuples[List->NumberOfTuples].ANF = 0;
+	for (l = 0; l < Size; l++)
+	{
+		List->Tuples[List->NumberOfTuples].n[l] = n[l];
+		List->Tuples[List->NumberOfTuples].ANF ^= CompANF[Pairs[l]][n[l]];
+	}
+	List->NumberOfTuples++;
+}
+
+void MakeGroupMOValue(unsigned char* Pairs, unsigned char Size, unsigned short* n, unsigned char* MOValue)
+{
+	unsigned int	Masked_InputIndex;
+	unsigned char	l;
+
+	for (Masked_InputIndex = 0; Masked_InputIndex < NumberOfMasked; Masked_InputIndex++)
+	{
+		MOValue[Masked_InputIndex] = 0;
+		for (l = 0; l < Size; l++)
+			MOValue[Masked_InputIndex] |= ((CompBits[Pairs[l]][n[l]][Masked_InputIndex >> 6] >> (Masked_InputIndex & 63)) & 1) << l;
+	}
+}
+
+// with Candidates, every check is made and kept, the tuple being added if it passes all of them
+void SearchGroup(unsigned char* Pairs, unsigned char Size, unsigned short* n, unsigned char Depth, unsigned char Fixed, uint64_t* Ind,
+	GroupListstruct* List, CandidateListstruct* Candidates, unsigned char* MOValue, short* Counter, unsigned short* Keys)
+{
+	unsigned int	Start = (Depth < Fixed) ? n[Depth] : 0;
+	unsigned int	End = (Depth < Fixed) ? (n[Depth] + 1) : NumberOfChoices;
+	unsigned int	Balance;
+	unsigned int	v, k, w;
+	uint64_t		Passed[(MaxNumberOfGroupSets + 64) / 64];
+	unsigned char	All;
+
+	if (Depth == Size)
+	{
+		// the output share is balanced
+		Balance = 0;
+		for (v = 0; v < (1U << Size); v++)
+			if (Parity[v])
+				Balance += BlockCount(Ind + ((size_t)Size * (1 << NumberOfShares) + v) * NumberOfWords, 0);
+
+		if (!Candidates)
+		{
+			if (Balance != BlockSize / 2)
+				return;
+
+			MakeGroupMOValue(Pairs, Size, n, MOValue);
+
+			if (!CheckProbeSets(GroupSets, NumberOfGroupSets, &MOValue, Pairs, n, Counter, Keys))
+				return;
+
+			#pragma omp critical (foundgroup)
+			AddTuple(List, Pairs, Size, n);
+
+			return;
+		}
+
+		memset(Passed, 0, Candidates->NumberOfMaskWords * sizeof(uint64_t));
+		Passed[0] = (Balance == BlockSize / 2);
+		MakeGroupMOValue(Pairs, Size, n, MOValue);
+		for (k = 0; k < NumberOfGroupSets; k++)
+			if (CheckProbeSets(&GroupSets[k], 1, &MOValue, Pairs, n, Counter, Keys))
+				Passed[(k + 1) >> 6] |= (uint64_t)1 << ((k + 1) & 63);
+
+		All = 1;
+		for (k = 0; k <= NumberOfGroupSets; k++)
+			All &= (Passed[k >> 6] >> (k & 63)) & 1;
+
+		#pragma omp critical (foundgroup)
+		{
+			if (Candidates->NumberOfCandidates == Candidates->Size)
+			{
+				Candidates->Size = Candidates->Size ? 2 * Candidates->Size : 1024;
+				Candidates->n = (unsigned short*)realloc(Candidates->n, (size_t)Candidates->Size * NumberOfShares * sizeof(unsigned short));
+				Candidates->Passed = (uint64_t*)realloc(Candidates->Passed, (size_t)Candidates->Size * Candidates->NumberOfMaskWords * sizeof(uint64_t));
+			}
+
+			memcpy(Candidates->n + (size_t)Candidates->NumberOfCandidates * NumberOfShares, n, Size * sizeof(unsigned short));
+			for (w = 0; w < Candidates->NumberOfMaskWords; w++)
+				Candidates->Passed[(size_t)Candidates->NumberOfCandidates * Candidates->NumberOfMaskWords + w] = Passed[w];
+			Candidates->NumberOfCandidates++;
+
+			if (All)
+				AddTuple(List, Pairs, Size, n);
+		}
+
+		return;
+	}
+
+	for (n[Depth] = Start; n[Depth] < End; n[Depth]++)
+		if (ExtendGroup(Ind, Depth + 1, CompBits[Pairs[Depth]][n[Depth]]))
+			SearchGroup(Pairs, Size, n, Depth + 1, Fixed, Ind, List, Candidates, MOValue, Counter, Keys);
+
+	n[Depth] = Start;
+}
+
+unsigned char	Permutations[24][MaxNumberOfShares]; // of the shares
+unsigned int	NumberOfPermutations;
+unsigned char	PairImage[MaxNumberOfRelabellings][MaxNumberOfPairs];
+unsigned int	NumberOfRelabellings;
+unsigned short*	ChoiceImage[24]; // the choice of Q with its shares of z relabelled by a permutation
+
+// the choices by their Q, to find the image of a choice
+unsigned int*	ChoiceOrder;
+
+int CompareChoices(const void* a, const void* b)
+{
+	uint64_t	Q1 = ChoiceQ[*(unsigned int*)a];
+	uint64_t	Q2 = ChoiceQ[*(unsigned int*)b];
+
+	return((Q1 < Q2) ? -1 : (Q1 > Q2));
+}
+
+// the shares of z are relabelled in every component at once, the target and the probe sets do not change
+void FillChoiceImages()
+{
+	unsigned int	i, n, Low, High, Mid;
+	uint64_t		Q, Image;
+	unsigned char	m, mImage, s;
+
+	ChoiceOrder = (unsigned int*)malloc(NumberOfChoices * sizeof(unsigned int));
+	for (n = 0; n < NumberOfChoices; n++)
+		ChoiceOrder[n] = n;
+	qsort(ChoiceOrder, NumberOfChoices, sizeof(unsigned int), CompareChoices);
+
+	for (i = 0; i < NumberOfPermutations; i++)
+	{
+		ChoiceImage[i] = (unsigned short*)malloc(NumberOfChoices * sizeof(unsigned short));
+		for (n = 0; n < NumberOfChoices; n++)
+		{
+			Image = 0;
+			for (Q = ChoiceQ[n]; Q; Q &= Q - 1)
+			{
+				m = __builtin_ctzll(Q);
+				mImage = m & 3;
+				for (s = 0; s < NumberOfShares; s++)
+					if ((m >> (2 + s)) & 1)
+						mImage |= 1 << (2 + Permutations[i][s]);
+				Image |= (uint64_t)1 << mImage;
+			}
+
+			Low = 0;
+			High = NumberOfChoices;
+			while (Low < High)
+			{
+				Mid = (Low + High) / 2;
+				if (ChoiceQ[ChoiceOrder[Mid]] < Image)
+					Low = Mid + 1;
+				else
+					High = Mid;
+			}
+
+			if ((Low == NumberOfChoices) || (ChoiceQ[ChoiceOrder[Low]] != Image))
+			{
+				printf("the choices are not closed under relabelling the shares of z\n");
+				exit(1);
+			}
+
+			ChoiceImage[i][n] = ChoiceOrder[Low];
+		}
+	}
+
+	free(ChoiceOrder);
+}
+
+// a tuple of the first group whose choices, relabelled, give a smaller tuple of the same group is skipped: its
+// solutions are the relabelled ones of that tuple
+unsigned char IsSmallestChoiceRelabelling(unsigned short* n, unsigned char Size)
+{
+	unsigned int	i;
+	unsigned char	l;
+
+	for (i = 0; i < NumberOfPermutations; i++)
+	{
+		for (l = 0; (l < Size) && (ChoiceImage[i][n[l]] == n[l]); l++);
+		if ((l < Size) && (ChoiceImage[i][n[l]] < n[l]))
+			return(0);
+	}
+
+	return(1);
+}
+
+// every permutation of the shares of x with every permutation of the shares of y
+void FillRelabellings()
+{
+	unsigned int	Code, Used;
+	unsigned int	i, j;
+	unsigned char	s, p;
+
+	NumberOfPermutations = 0;
+	for (Code = 0; Code < (1U << (2 * NumberOfShares)); Code++)
+	{
+		Used = 0;
+		for (s = 0; s < NumberOfShares; s++)
+		{
+			Permutations[NumberOfPermutations][s] = (Code >> (2 * s)) & 3;
+			Used |= 1 << Permutations[NumberOfPermutations][s];
+		}
+
+		if (Used == ((1U << NumberOfShares) - 1))
+			NumberOfPermutations++;
+	}
+
+	NumberOfRelabellings = 0;
+	for (i = 0; i < NumberOfPermutations; i++)
+		for (j = 0; j < NumberOfPermutations; j++)
+		{
+			for (p = 0; p < NumberOfPairs; p++)
+				PairImage[NumberOfRelabellings][p] = Permutations[i][p / NumberOfShares] * NumberOfShares + Permutations[j][p % NumberOfShares];
+			NumberOfRelabellings++;
+		}
+}
+
+// the checks do not depend on the labels of the shares of x and y, so the tuples of a group are taken
+// from a relabelled group if it is already done
+unsigned char RelabelGroupList(unsigned int Mask)
+{
+	GroupListstruct*	List = &GroupLists[Mask];
+	GroupListstruct*	Source;
+	unsigned char		Pairs[MaxNumberOfShares];
+	unsigned char		Position[MaxNumberOfPairs]; // of a pair in the relabelled group
+	unsigned int		Image;
+	unsigned int		r, i;
+	unsigned char		p, l;
+
+	for (r = 1; r < NumberOfRelabellings; r++)
+	{
+		Image = 0;
+		for (p = 0; p < NumberOfPairs; p++)
+			if ((Mask >> p) & 1)
+				Image |= 1 << PairImage[r][p];
+
+		Source = &GroupLists[Image];
+		if (!Source->Done)
+			continue;
+
+		l = 0;
+		for (p = 0; p < NumberOfPairs; p++)
+			if ((Image >> p) & 1)
+				Position[p] = l++;
+
+		l = 0;
+		for (p = 0; p < NumberOfPairs; p++)
+			if ((Mask >> p) & 1)
+				Pairs[l++] = p;
+
+		List->Size = Source->NumberOfTuples;
+		List->Tuples = (Tuplestruct*)malloc((List->Size + 1) * sizeof(Tuplestruct));
+		for (i = 0; i < Source->NumberOfTuples; i++)
+		{
+			List->Tuples[i].ANF = 0;
+			for (l = 0; l < __builtin_popcount(Mask); l++)
+			{
+				List->Tuples[i].n[l] = Source->Tuples[i].n[Position[PairImage[r][Pairs[l]]]];
+				List->Tuples[i].ANF ^= CompANF[Pairs[l]][List->Tuples[i].n[l]];
+			}
+		}
+
+		List->NumberOfTuples = Source->NumberOfTuples;
+		List->Done = 1;
+		return(1);
+	}
+
+	return(0);
+}
+
+void ProbeMaskFileName(char* FileName, unsigned int Mask)
+{
+	sprintf(FileName, "ProbeMasks_%d_%d_%d_%x.csv", NumberOfShares, ComponentFamily, MaxZShares, Mask);
+}
+
+// the probe sets of the columns, then a candidate per line with its choices and its mask words in hex
+void WriteProbeMasks(unsigned int Mask, unsigned char Size, CandidateListstruct* Candidates)
+{
+	FILE*			F;
+	char			FileName[100];
+	unsigned int	i, k, w;
+	unsigned char	l;
+
+	ProbeMaskFileName(FileName, Mask);
+	F = fopen(FileName, "wt");
+
+	fprintf(F, "%d\n", NumberOfGroupSets);
+	for (k = 0; k < NumberOfGroupSets; k++)
+	{
+		fprintf(F, "%d", GroupSets[k].NumberOfObjects);
+		for (l = 0; l < GroupSets[k].NumberOfObjects; l++)
+			fprintf(F, ", %d %d", GroupSets[k].Kind[l], GroupSets[k].Index[l]);
+		fprintf(F, "\n");
+	}
+
+	fprintf(F, "%d\n", Candidates->NumberOfCandidates);
+	for (i = 0; i < Candidates->NumberOfCandidates; i++)
+	{
+		for (l = 0; l < Size; l++)
+			fprintf(F, "%d ", Candidates->n[(size_t)i * NumberOfShares + l]);
+		for (w = 0; w < Candidates->NumberOfMaskWords; w++)
+			fprintf(F, ", %016" PRIx64, Candidates->Passed[(size_t)i * Candidates->NumberOfMaskWords + w]);
+		fprintf(F, "\n");
+	}
+
+	fclose(F);
+}
+
+// the tuples of a group from the candidates of a former run: the probe sets in the file are taken from the masks,
+// the others are checked
+unsigned char ReadProbeMasks(unsigned int Mask, unsigned char* Pairs, unsigned char Size)
+{
+	GroupListstruct*	List = &GroupLists[Mask];
+	FILE*				F;
+	char				FileName[100];
+	ProbeSetstruct*		NewSets;
+	unsigned int		NumberOfNewSets;
+	int*				Column; // of every set of GroupSets in the file, -1 if it is not there
+	ProbeSetstruct		Set;
+	unsigned int		NumberOfFileSets, NumberOfCandidates, NumberOfMaskWords;
+	unsigned char*		MOValue;
+	short*				Counter;
+	unsigned short*		Keys;
+	unsigned short		n[MaxNumberOfShares];
+	uint64_t			Passed[(MaxNumberOfGroupSets + 64) / 64];
+	unsigned int		i, k, w, v;
+	unsigned char		Pass;
+	unsigned char		l;
+
+	ProbeMaskFileName(FileName, Mask);
+	F = fopen(FileName, "rt");
+	if (!F)
+		return(0);
+
+	if ((fscanf(F, "%u", &NumberOfFileSets) != 1) || (NumberOfFileSets > MaxNumberOfGroupSets))
+	{
+		fclose(F);
+		return(0);
+	}
+
+	Column = (int*)malloc((NumberOfGroupSets + 1) * sizeof(int));
+	for (k = 0; k < NumberOfGroupSets; k++)
+		Column[k] = -1;
+
+	for (i = 0; i < NumberOfFileSets; i++)
+	{
+		fscanf(F, "%u", &v);
+		Set.NumberOfObjects = v;
+		for (l = 0; l < Set.NumberOfObjects; l++)
+		{
+			fscanf(F, " , %u", &v);
+			Set.Kind[l] = v;
+			fscanf(F, "%u", &v);
+			Set.Index[l] = v;
+		}
+
+		for (k = 0; k < NumberOfGroupSets; k++)
+			if ((GroupSets[k].NumberOfObjects == Set.NumberOfObjects) &&
+				(!memcmp(GroupSets[k].Kind, Set.Kind, Set.NumberOfObjects)) && (!memcmp(GroupSets[k].Index, Set.Index, Set.NumberOfObjects)))
+				Column[k] = i + 1;
+	}
+
+	NewSets = (ProbeSetstruct*)malloc((NumberOfGroupSets + 1) * sizeof(ProbeSetstruct));
+	NumberOfNewSets = 0;
+	for (k = 0; k < NumberOfGroupSets; k++)
+		if (Column[k] < 0)
+			NewSets[NumberOfNewSets++] = GroupSets[k];
+
+	MOValue = (unsigned char*)malloc(NumberOfMasked * sizeof(unsigned char));
+	Counter = (short*)calloc(1 << 16, sizeof(short));
+	Keys = (unsigned short*)malloc(2 * BlockSize * sizeof(unsigned short));
+
+	NumberOfMaskWords = (NumberOfFileSets + 64) / 64;
+	fscanf(F, "%u", &NumberOfCandidates);
+	for (i = 0; i < NumberOfCandidates; i++)
+	{
+		for (l = 0; l < Size; l++)
+		{
+			fscanf(F, "%u", &v);
+			n[l] = v;
+		}
+		for (w = 0; w < NumberOfMaskWords; w++)
+			fscanf(F, " , %" SCNx64, &Passed[w]);
+
+		Pass = Passed[0] & 1;
+		for (k = 0; Pass && (k < NumberOfGroupSets); k++)
+			if (Column[k] >= 0)
+				Pass = (Passed[Column[k] >> 6] >> (Column[k] & 63)) & 1;
+
+		if (Pass && NumberOfNewSets)
+		{
+			MakeGroupMOValue(Pairs, Size, n, MOValue);
+			Pass = CheckProbeSets(NewSets, NumberOfNewSets, &MOValue, Pairs, n, Counter, Keys);
+		}
+
+		if (Pass)
+			AddTuple(List, Pairs, Size, n);
+	}
+
+	fclose(F);
+	printf("%s: %d candidates, %d probe sets checked again\n", FileName, NumberOfCandidates, NumberOfNewSets);
+
+	free(Column);
+	free(NewSets);
+	free(MOValue);
+	free(Counter);
+	free(Keys);
+
+	List->Done = 1;
+	return(1);
+}
+
+void FillGroupList(unsigned int Mask)
+{
+	GroupListstruct*	List = &GroupLists[Mask];
+	CandidateListstruct	CandidateList;
+	CandidateListstruct*	Candidates = NULL;
+	unsigned char		Pairs[MaxNumberOfShares];
+	unsigned char		NumberOfPairsInGroup;
+	unsigned char		Fixed;
+	unsigned int		NumberOfItems;
+	int					Item;
+	unsigned char		p;
+
+	NumberOfPairsInGroup = 0;
+	for (p = 0; p < NumberOfPairs; p++)
+		if ((Mask >> p) & 1)
+			Pairs[NumberOfPairsInGroup++] = p;
+
+	if (KeepProbeMasks)
+	{
+		if (ReadProbeMasks(Mask, Pairs, NumberOfPairsInGroup))
+			return;
+
+		memset(&CandidateList, 0, sizeof(CandidateListstruct));
+		CandidateList.NumberOfMaskWords = (NumberOfGroupSets + 64) / 64;
+		Candidates = &CandidateList;
+	}
+
+	// the choices of the first two components are the work items of the threads, of the first one with many choices
+	Fixed = (NumberOfPairsInGroup < 2) ? NumberOfPairsInGroup : ((NumberOfChoices > 4096) ? 1 : 2);
+	NumberOfItems = (Fixed < 2) ? NumberOfChoices : (NumberOfChoices * NumberOfChoices);
+
+	#pragma omp parallel
+	{
+		uint64_t*		Ind = (uint64_t*)malloc((size_t)(NumberOfShares + 1) * (1 << NumberOfShares) * NumberOfWords * sizeof(uint64_t));
+		unsigned char*	MOValue = (unsigned char*)malloc(NumberOfMasked * sizeof(unsigned char));
+		short*			Counter = (short*)calloc(1 << 16, sizeof(short));
+		unsigned short*	Keys = (unsigned short*)malloc(2 * BlockSize * sizeof(unsigned short));
+		unsigned short	n[MaxNumberOfShares];
+
+		memcpy(Ind, ValidBits, NumberOfWords * sizeof(uint64_t));
+
+		#pragma omp for schedule(dynamic)
+		for (Item = 0; Item < (int)NumberOfItems; Item++)
+		{
+			n[0] = Item % NumberOfChoices;
+			n[1] = Item / NumberOfChoices;
+			SearchGroup(Pairs, NumberOfPairsInGroup, n, 0, Fixed, Ind, List, Candidates, MOValue, Counter, Keys);
+		}
+
+		free(Ind);
+		free(MOValue);
+		free(Counter);
+		free(Keys);
+	}
+
+	if (Candidates)
+	{
+		WriteProbeMasks(Mask, NumberOfPairsInGroup, Candidates);
+		free(Candidates->n);
+		free(Candidates->Passed);
+	}
+
+	List->Done = 1;
+}
+
+//---------------------------------------------------------------------------
+
+typedef struct {
+	unsigned char*	MOValue[MaxNumberOfShares];
+	unsigned short	Choice[MaxNumberOfPairs]; // of every component, component c taking pair Type[c]
+	unsigned int	Tuple[MaxNumberOfShares];
+	short*			Counter;
+	unsigned short*	Keys;
+	unsigned char*	UniformityCounter;
+	unsigned int	NumberOfSolutionsPerANF; // found for the current tuple of the first group
+} Searchstruct;
+
+// the output shares are a uniform sharing of the target function, for every unmasked input and every
+// shares of x and y the masks of z are mapped to distinct output shares; with more output shares than
+// the masks of z can reach, every sharing of the output is taken as often over the masked inputs of an unmasked input
+unsigned char CheckUniformity(Searchstruct* S, unsigned char* TargetFunc)
+{
+	unsigned int	Masked_InputIndex;
+	unsigned int	Offset;
+	unsigned short	Key;
+	unsigned char	Masked_Output;
+	unsigned char	ExpectedCounterValue = (NumberOfOutputShares == NumberOfShares) ? 1 : (BlockSize >> (NumberOfOutputShares - 1));
+	unsigned char	g;
+	unsigned char	Uniform = 1;
+
+	Offset = 0;
+	for (Masked_InputIndex = 0; Masked_InputIndex < NumberOfMasked; Masked_InputIndex++)
+	{
+		Masked_Output = 0;
+		for (g = 0; g < NumberOfOutputShares; g++)
+			Masked_Output |= Parity[S->MOValue[g][Masked_InputIndex]] << g;
+
+		if (Parity[Masked_Output] != TargetFunc[UnmaskedInputTable[Masked_InputIndex]])
+			printf("error\n");
+
+		Key = Masked_Output;
+		if (NumberOfOutputShares == NumberOfShares)
+			Key |= (OutputTableIndex[Masked_InputIndex] >> NumberOfShares) << NumberOfShares;
+		S->Keys[Offset++] = Key;
+		if (++S->UniformityCounter[Key] > ExpectedCounterValue)
+			Uniform = 0;
+
+		if ((!Uniform) || (Offset == BlockSize))
+		{
+			while (Offset)
+				S->UniformityCounter[S->Keys[--Offset]] = 0;
+
+			if (!Uniform)
+				return(0);
+		}
+	}
+
+	return(1);
+}
+
+void MakeMOValue(Searchstruct* S, char* Type, unsigned char Group, Tuplestruct* Tuple)
+{
+	unsigned int	Masked_InputIndex;
+	unsigned char	l;
+
+	for (l = 0; l < GroupSize[Group]; l++)
+		S->Choice[GroupStart[Group] + l] = Tuple->n[l];
+
+	for (Masked_InputIndex = 0; Masked_InputIndex < NumberOfMasked; Masked_InputIndex++)
+	{
+		S->MOValue[Group][Masked_InputIndex] = 0;
+		for (l = 0; l < GroupSize[Group]; l++)
+			S->MOValue[Group][Masked_InputIndex] |= ((CompBits[Type[GroupStart[Group] + l]][Tuple->n[l]][Masked_InputIndex >> 6] >> (Masked_InputIndex & 63)) & 1) << l;
+	}
+}
+
+// the inputs of a component are the shares of the variables of its forms, each taken once: share i of the variables
+// of x, share j of those of y and share k - 1 of those of z, wire v * NumberOfShares + share being variable v
+unsigned char ComponentWires(unsigned char p, unsigned short n, unsigned char* Forms, unsigned char* Wire)
+{
+	unsigned char	NumberOfWires = 0;
+	unsigned char	Local, Form, Share, v, w;
+
+	for (Local = 0; Local < 2 + NumberOfShares; Local++)
+	{
+		if ((Local >= 2) && (!((ChoiceZ[n] >> (Local - 2)) & 1)))
+			continue;
+
+		Form = (Local < 2) ? Local : 2;
+		Share = (Local == 0) ? (p / NumberOfShares) : ((Local == 1) ? (p % NumberOfShares) : (Local - 2));
+		for (v = 0; v < NumberOfSboxBits; v++)
+			if ((Forms[Form] >> v) & 1)
+			{
+				for (w = 0; (w < NumberOfWires) && (Wire[w] != v * NumberOfShares + Share); w++);
+				if (w == NumberOfWires)
+					Wire[NumberOfWires++] = v * NumberOfShares + Share;
+			}
+	}
+
+	return(NumberOfWires);
+}
+
+// the ANF of a component over its wires, expanded from its forms (a table over the wires of 8-bit forms would
+// not fit) and with the terms in the order of MakeANF
+int CompareTerms(const void* a, const void* b)
+{
+	unsigned __int64	Ta = *(unsigned __int64*)a;
+	unsigned __int64	Tb = *(unsigned __int64*)b;
+
+	if (__builtin_popcountll(Ta) != __builtin_popcountll(Tb))
+		return(__builtin_popcountll(Ta) - __builtin_popcountll(Tb));
+
+	return((Ta > Tb) - (Ta < Tb));
+}
+
+void ToggleTerm(FunctionStruct* Function, unsigned __int64 Symbol)
+{
+	unsigned int	i;
+
+	for (i = 0; (i < Function->NumberOfTerms) && (Function->Term[i] != Symbol); i++);
+
+	if (i < Function->NumberOfTerms)
+		Function->Term[i] = Function->Term[--Function->NumberOfTerms];
+	else
+		AddTermtoFunction(Function, Symbol);
+}
+
+// the product of two forms, given by their wires, a wire in both giving a linear term
+void ToggleProduct(FunctionStruct* Function, uint32_t Mask1, uint32_t Mask2, unsigned char NumberOfWires)
+{
+	unsigned char	u, w;
+
+	for (u = 0; u < NumberOfWires; u++)
+		if ((Mask1 >> u) & 1)
+			for (w = 0; w < NumberOfWires; w++)
+				if ((Mask2 >> w) & 1)
+					ToggleTerm(Function, ((unsigned __int64)1 << u) | ((unsigned __int64)1 << w));
+}
+
+void MakeComponentANF(unsigned char p, unsigned short n, unsigned char* Forms, unsigned char* Wire, unsigned char NumberOfWires,
+	FunctionStruct* Function, unsigned char Invert)
+{
+	uint32_t		Mask[2 + MaxNumberOfShares];
+	uint64_t		Q;
+	unsigned char	Local, Form, Share, m, w;
+
+	// the wires of every local variable: x_i, y_j and the shares of z
+	for (Local = 0; Local < 2 + NumberOfShares; Local++)
+	{
+		Form = (Local < 2) ? Local : 2;
+		Share = (Local == 0) ? (p / NumberOfShares) : ((Local == 1) ? (p % NumberOfShares) : (Local - 2));
+		Mask[Local] = 0;
+		for (w = 0; w < NumberOfWires; w++)
+			if (((Forms[Form] >> (Wire[w] / NumberOfShares)) & 1) && ((Wire[w] % NumberOfShares) == Share))
+				Mask[Local] |= 1 << w;
+	}
+
+	Function->NumberOfTerms = 0;
+	ToggleProduct(Function, Mask[0], Mask[1], NumberOfWires);
+
+	for (Q = ChoiceQ[n]; Q; Q &= Q - 1)
+	{
+		m = __builtin_ctzll(Q);
+		if ((m & (m - 1)) == 0)
+		{
+			for (w = 0; w < NumberOfWires; w++)
+				if ((Mask[__builtin_ctz(m)] >> w) & 1)
+					ToggleTerm(Function, (unsigned __int64)1 << w);
+		}
+		else
+			ToggleProduct(Function, Mask[__builtin_ctz(m)], Mask[31 - __builtin_clz(m)], NumberOfWires);
+	}
+
+	if (Invert)
+		ToggleTerm(Function, 0);
+
+	qsort(Function->Term, Function->NumberOfTerms, sizeof(unsigned __int64), CompareTerms);
+}
+
+void WriteSolution(Searchstruct* S, char* Type, Coordinatestruct* Coordinate, uint64_t* ANF)
+{
+	FILE*			F;
+	FunctionStruct	ANFFunc;
+	char			TempStr[2000];
+	char			InputStr[MaxNumberOfWires][5];
+	unsigned char	Wire[MaxNumberOfWires];
+	unsigned char	NumberOfWires;
+	unsigned char	g, l, w, p;
+	unsigned short	n;
+	unsigned int	j;
+
+	DefineFunction(&ANFFunc, 500);
+
+	F = fopen(Coordinate->FileName, "at");
+	for (p = 0; p < NumberOfPairs; p++)
+		fprintf(F, "%x", Type[p]);
+	fprintf(F, ", ");
+
+	for (g = 0; g < NumberOfOutputShares; g++)
+	{
+		fprintf(F, "%" PRIu64 ", ", ANF[g]);
+		for (l = 0; l < GroupSize[g]; l++)
+		{
+			p = Type[GroupStart[g] + l];
+			n = S->Choice[GroupStart[g] + l];
+			NumberOfWires = ComponentWires(p, n, Coordinate->Forms, Wire);
+			for (w = 0; w < NumberOfWires; w++)
+				sprintf(InputStr[w], "%c%d", 'a' + Wire[w] / NumberOfShares, Wire[w] % NumberOfShares + 1);
+
+			MakeComponentANF(p, n, Coordinate->Forms, Wire, NumberOfWires, &ANFFunc, (g | l) ? 0 : Coordinate->Invert);
+			SPrintFunction(ANFFunc, TempStr, InputStr);
+			fprintf(F, "%d, %s, ", ANFFunc.NumberOfTerms, TempStr);
+		}
+
+		if (NumberOfSboxBits * NumberOfShares > MaxTableBits)
+			fputc('-', F);
+		else
+			for (j = 0; j < (1U << (NumberOfSboxBits * NumberOfShares)); j++)
+				fputc("0123456789abcdef"[S->MOValue[g][Coordinate->TableIndex[j]]], F);
+		fprintf(F, (g < NumberOfOutputShares - 1) ? ", " : ",\n");
+	}
+
+	fclose(F);
+	FreeFunction(&ANFFunc);
+}
+
+void CombineGroups(Searchstruct* S, unsigned char Stage, uint64_t ANFSoFar, char* Type, unsigned int* GroupMask,
+	unsigned int* ANFOrder, uint64_t ANFTarget, unsigned char* TargetFunc,
+	Batchstruct* Batch, unsigned int &NumberOfFound)
+{
+	GroupListstruct*	List = &GroupLists[GroupMask[Stage]];
+	uint64_t			ANF[MaxNumberOfShares];
+	uint64_t			ANFRest;
+	unsigned int		i, Low, High;
+	unsigned char		g;
+
+	if (MaxNumberOfSolutions && (NumberOfFound >= MaxNumberOfSolutions))
+		return;
+
+	if (MaxNumberOfSolutionsPerANF && (S->NumberOfSolutionsPerANF >= MaxNumberOfSolutionsPerANF))
+		return;
+
+	if (Stage < NumberOfOutputShares - 1)
+	{
+		for (i = 0; i < List->NumberOfTuples; i++)
+		{
+			S->Tuple[Stage] = i;
+			MakeMOValue(S, Type, Stage, &List->Tuples[i]);
+
+			if (CheckProbeSets(CombinationSets + StageStart[Stage], StageStart[Stage + 1] - StageStart[Stage],
+				S->MOValue, (unsigned char*)Type, S->Choice, S->Counter, S->Keys))
+				CombineGroups(S, Stage + 1, ANFSoFar ^ List->Tuples[i].ANF, Type, GroupMask, ANFOrder, ANFTarget, TargetFunc,
+					Batch, NumberOfFound);
+		}
+
+		return;
+	}
+
+	// the last group completes the linear terms of the target
+	ANFRest = ANFTarget ^ ANFSoFar;
+	Low = 0;
+	High = List->NumberOfTuples;
+	while (Low < High)
+	{
+		i = (Low + High) / 2;
+		if (List->Tuples[ANFOrder[i]].ANF < ANFRest)
+			Low = i + 1;
+		else
+			High = i;
+	}
+
+	for (i = Low; (i < List->NumberOfTuples) && (List->Tuples[ANFOrder[i]].ANF == ANFRest); i++)
+	{
+		S->Tuple[Stage] = ANFOrder[i];
+		MakeMOValue(S, Type, Stage, &List->Tuples[ANFOrder[i]]);
+
+		if (CheckUniformity(S, TargetFunc) &&
+			CheckProbeSets(CombinationSets + StageStart[Stage], StageStart[Stage + 1] - StageStart[Stage],
+				S->MOValue, (unsigned char*)Type, S->Choice, S->Counter, S->Keys))
+		{
+			S->NumberOfSolutionsPerANF++;
+			if (MaxNumberOfSolutionsPerANF && (S->NumberOfSolutionsPerANF > MaxNumberOfSolutionsPerANF))
+				return;
+
+			#pragma omp critical (foundmain)
+			{
+				if ((!MaxNumberOfSolutions) || (NumberOfFound < MaxNumberOfSolutions))
+				{
+					NumberOfFound++;
+					for (g = 0; g < NumberOfPairs; g++)
+						printf("%x", Type[g]);
+					printf(" found %d\n", NumberOfFound);
+
+					for (g = 0; g < NumberOfOutputShares; g++)
+						ANF[g] = GroupLists[GroupMask[g]].Tuples[S->Tuple[g]].ANF;
+					for (g = 0; g < Batch->NumberOfCoordinates; g++)
+						WriteSolution(S, Type, Batch->Coordinates[g], ANF);
+				}
+			}
+		}
+	}
+}
+
+// the tuples of the last group by their terms, in their order within the list for equal terms
+GroupListstruct*	SortedList;
+
+int CompareANF(const void* a, const void* b)
+{
+	uint64_t	ANF1 = SortedList->Tuples[*(unsigned int*)a].ANF;
+	uint64_t	ANF2 = SortedList->Tuples[*(unsigned int*)b].ANF;
+
+	if (ANF1 != ANF2)
+		return((ANF1 < ANF2) ? -1 : 1);
+	return((*(unsigned int*)a < *(unsigned int*)b) ? -1 : 1);
+}
+
+void FindCombination(char* Type, uint64_t ANFTarget, unsigned char* TargetFunc, Batchstruct* Batch,
+	unsigned int &NumberOfFound)
+{
+	unsigned int		GroupMask[MaxNumberOfShares];
+	GroupListstruct*	Last;
+	unsigned int*		ANFOrder;
+	unsigned int		i;
+	int					i0;
+	unsigned char		g, l;
+
+	for (g = 0; g < NumberOfOutputShares; g++)
+	{
+		GroupMask[g] = 0;
+		for (l = GroupStart[g]; l < GroupStart[g + 1]; l++)
+			GroupMask[g] |= 1 << Type[l];
+
+		if ((!GroupLists[GroupMask[g]].Done) && (!RelabelGroupList(GroupMask[g])))
+			FillGroupList(GroupMask[g]);
+
+		for (l = 0; l < NumberOfPairs; l++)
+			printf("%x", Type[l]);
+		printf(" group %d: %d tuples\n", g, GroupLists[GroupMask[g]].NumberOfTuples);
+
+		if (!GroupLists[GroupMask[g]].NumberOfTuples)
+			return;
+	}
+
+	// the tuples of the last group sorted by their linear terms
+	Last = &GroupLists[GroupMask[NumberOfOutputShares - 1]];
+	ANFOrder = (unsigned int*)malloc(Last->NumberOfTuples * sizeof(unsigned int));
+	for (i = 0; i < Last->NumberOfTuples; i++)
+		ANFOrder[i] = i;
+	SortedList = Last;
+	qsort(ANFOrder, Last->NumberOfTuples, sizeof(unsigned int), CompareANF);
+
+	#pragma omp parallel
+	{
+		Searchstruct	S;
+		unsigned char	g;
+
+		for (g = 0; g < NumberOfOutputShares; g++)
+			S.MOValue[g] = (unsigned char*)malloc(NumberOfMasked * sizeof(unsigned char));
+		S.Counter = (short*)calloc(1 << 16, sizeof(short));
+		S.Keys = (unsigned short*)malloc(2 * BlockSize * sizeof(unsigned short));
+		S.UniformityCounter = (unsigned char*)calloc(1 << (3 * NumberOfShares), sizeof(unsigned char));
+
+		#pragma omp for schedule(dynamic)
+		for (i0 = 0; i0 < (int)GroupLists[GroupMask[0]].NumberOfTuples; i0++)
+		{
+			if (ChoicesUpToRelabelling && (!IsSmallestChoiceRelabelling(GroupLists[GroupMask[0]].Tuples[i0].n, GroupSize[0])))
+				continue;
+
+			S.Tuple[0] = i0;
+			S.NumberOfSolutionsPerANF = 0;
+			MakeMOValue(&S, Type, 0, &GroupLists[GroupMask[0]].Tuples[i0]);
+			CombineGroups(&S, 1, GroupLists[GroupMask[0]].Tuples[i0].ANF, Type, GroupMask, ANFOrder, ANFTarget, TargetFunc,
+				Batch, NumberOfFound);
+		}
+
+		for (g = 0; g < NumberOfOutputShares; g++)
+			free(S.MOValue[g]);
+		free(S.Counter);
+		free(S.Keys);
+		free(S.UniformityCounter);
+	}
+
+	free(ANFOrder);
+}
+
+//---------------------------------------------------------------------------
+
+void SortMasks(unsigned int* Masks)
+{
+	unsigned int	Temp;
+	unsigned char	g, h;
+
+	for (g = 1; g < NumberOfOutputShares; g++)
+		for (h = g; (h > 0) && (Masks[h - 1] > Masks[h]); h--)
+		{
+			Temp = Masks[h];
+			Masks[h] = Masks[h - 1];
+			Masks[h - 1] = Temp;
+		}
+}
+
+unsigned char IsSmallestRelabelling(char* Type)
+{
+	unsigned int	Masks[MaxNumberOfShares];
+	unsigned int	Image[MaxNumberOfShares];
+	unsigned int	r;
+	unsigned char	g, l;
+
+	for (g = 0; g < NumberOfOutputShares; g++)
+	{
+		Masks[g] = 0;
+		for (l = GroupStart[g]; l < GroupStart[g + 1]; l++)
+			Masks[g] |= 1 << Type[l];
+	}
+	SortMasks(Masks);
+
+	for (r = 1; r < NumberOfRelabellings; r++)
+	{
+		for (g = 0; g < NumberOfOutputShares; g++)
+		{
+			Image[g] = 0;
+			for (l = GroupStart[g]; l < GroupStart[g + 1]; l++)
+				Image[g] |= 1 << PairImage[r][Type[l]];
+		}
+		SortMasks(Image);
+
+		for (g = 0; (g < NumberOfOutputShares) && (Image[g] == Masks[g]); g++);
+		if ((g < NumberOfOutputShares) && (Image[g] < Masks[g]))
+			return(0);
+	}
+
+	return(1);
+}
+
+// the partitions of the pairs into the groups, every group sorted and the groups of the same size sorted by their first pair
+void EnumerateTypes(char* Type, unsigned char Position, unsigned int Used, uint64_t ANFTarget, unsigned char* TargetFunc,
+	Batchstruct* Batch, unsigned int &NumberOfFound)
+{
+	unsigned char	p, l, g;
+	unsigned char	First;
+	unsigned char	Start;
+
+	if (Position == NumberOfPairs)
+	{
+		if ((!TypesUpToRelabelling) || IsSmallestRelabelling(Type))
+			FindCombination(Type, ANFTarget, TargetFunc, Batch, NumberOfFound);
+		return;
+	}
+
+	for (g = 0; GroupStart[g + 1] <= Position; g++);
+	First = (Position == GroupStart[g]);
+
+	if (!First)
+		Start = Type[Position - 1] + 1;
+	else if (g && (GroupSize[g - 1] == GroupSize[g]))
+		Start = Type[GroupStart[g - 1]] + 1;
+	else
+		Start = 0;
+
+	for (p = Start; p < NumberOfPairs; p++)
+	{
+		if ((Used >> p) & 1)
+			continue;
+
+		if (LatinTypesOnly)
+		{
+			for (l = GroupStart[g]; l < Position; l++)
+				if ((Type[l] / NumberOfShares == p / NumberOfShares) || (Type[l] % NumberOfShares == p % NumberOfShares))
+					break;
+
+			if (l < Position)
+				continue;
+		}
+
+		Type[Position] = p;
+		EnumerateTypes(Type, Position + 1, Used | (1 << p), ANFTarget, TargetFunc, Batch, NumberOfFound);
+
+		if (First && (GroupSize[NumberOfOutputShares - 1] == GroupSize[g])) // the first free pair opens the group
+			break;
+	}
+}
+
+// the forms x, y (x & y being the quadratic part of the coordinate) and z (the rest of its linear part, without
+// the terms in x and y) with the fewest variables; z is another input bit not in the target if the rest is empty,
+// the coordinate depending on the variables of x, y and z only
+unsigned char SelectForms(unsigned char* Table, Coordinatestruct* Coordinate)
+{
+	unsigned char	ANFCoordinate[1 << MaxNumberOfSboxBits];
+	unsigned int	NumberOfInputs = 1 << NumberOfSboxBits;
+	unsigned int	L1, L2;
+	unsigned char	Linear, Rest;
+	unsigned char	L3, u, v;
+	unsigned char	ab, Best[4], BestCost, Cost;
+	unsigned char	x, y, z, xyz;
+	unsigned int	i, j;
+
+	memcpy(ANFCoordinate, Table, NumberOfInputs);
+	for (i = 1; i < NumberOfInputs; i <<= 1)
+		for (j = 0; j < NumberOfInputs; j++)
+			if (j & i)
+				ANFCoordinate[j] ^= ANFCoordinate[j ^ i];
+
+	Linear = 0;
+	for (j = 1; j < NumberOfInputs; j++)
+		if (ANFCoordinate[j])
+		{
+			if ((j & (j - 1)) == 0)
+				Linear |= j;
+			else if (__builtin_popcount(j) != 2)
+			{
+				printf("the coordinate is not quadratic\n");
+				return(0);
+			}
+		}
+
+	BestCost = 0xff;
+	for (L1 = 1; L1 < NumberOfInputs; L1++)
+		for (L2 = L1 + 1; L2 < NumberOfInputs; L2++)
+		{
+			// the quadratic terms of L1 & L2
+			for (u = 0; u < NumberOfSboxBits; u++)
+			{
+				for (v = u + 1; v < NumberOfSboxBits; v++)
+					if (ANFCoordinate[(1 << u) | (1 << v)] != ((((L1 >> u) & (L2 >> v)) ^ ((L1 >> v) & (L2 >> u))) & 1))
+						break;
+				if (v < NumberOfSboxBits)
+					break;
+			}
+			if (u < NumberOfSboxBits)
+				continue;
+
+			// the squares of the variables in both forms are linear terms
+			Rest = Linear ^ (L1 & L2);
+			for (ab = 0; ab < 4; ab++)
+			{
+				L3 = Rest ^ ((ab & 1) ? L1 : 0) ^ ((ab & 2) ? L2 : 0);
+				Cost = __builtin_popcount(L1) + __builtin_popcount(L2) + (L3 ? __builtin_popcount(L3) : 1);
+				if (Cost < BestCost)
+				{
+					BestCost = Cost;
+					Best[0] = L1;
+					Best[1] = L2;
+					Best[2] = L3;
+					Best[3] = ab;
+				}
+			}
+		}
+
+	if (BestCost == 0xff)
+	{
+		printf("the quadratic part of the coordinate is not a single product, decompose the S-box first\n");
+		return(0);
+	}
+
+	// x & y ^ y is taken as y & x ^ x, the same target then being searched once
+	if (Best[3] == 2)
+	{
+		u = Best[0];
+		Best[0] = Best[1];
+		Best[1] = u;
+		Best[3] = 1;
+	}
+
+	Coordinate->Forms[0] = Best[0];
+	Coordinate->Forms[1] = Best[1];
+	Coordinate->Forms[2] = Best[2];
+	for (u = 0; (u < NumberOfSboxBits) && (!Coordinate->Forms[2]); u++)
+		if (((1 << u) != Best[0]) && ((1 << u) != Best[1]) && ((1 << u) != (Best[0] ^ Best[1])))
+			Coordinate->Forms[2] = 1 << u;
+
+	for (xyz = 0; xyz < 8; xyz++)
+	{
+		x = (xyz >> 0) & 1;
+		y = (xyz >> 1) & 1;
+		z = (xyz >> 2) & 1;
+
+		Coordinate->TargetFunc[xyz] = (x & y) ^ (x & Best[3]) ^ (y & (Best[3] >> 1)) ^ (Best[2] ? z : 0);
+	}
+	Coordinate->Invert = ANFCoordinate[0];
+
+	return(1);
+}
+
+int main()
+{
+	unsigned char		Table[1 << MaxNumberOfSboxBits];
+	Coordinatestruct	Coordinates[MaxNumberOfSboxBits];
+	Coordinatestruct*	C;
+	Batchstruct			Batches[MaxNumberOfSboxBits];
+	unsigned char		NumberOfCoordinates;
+	unsigned char		NumberOfBatches;
+	FunctionStruct		ANFTargetFunc;
+	uint64_t			ANFTarget;
+	unsigned char		Quadratic;
+	unsigned char		Var;
+	unsigned int		j;
+	unsigned char		Bit, b, c, i, s, v;
+	char				Type[MaxNumberOfPairs];
+	unsigned int		NumberOfFound;
+	FILE*				F;
+
+	if ((NumberOfOutputShares != NumberOfShares) && ((NumberOfShares != 2) || (NumberOfOutputShares != 3)))
+	{
+		printf("the output shares are as many as the input shares, or 3 with 2 shares\n");
+		return 1;
+	}
+
+	NumberOfCoordinates = 0;
+	for (Bit = 0; Bit < NumberOfSboxBits; Bit++)
+	{
+		if ((!AllOutputBits) && (Bit != OutputBit))
+			continue;
+
+		for (j = 0; j < (1U << NumberOfSboxBits); j++)
+			Table[j] = (Sbox[j] >> Bit) & 1;
+
+		C = &Coordinates[NumberOfCoordinates];
+		C->OutputBit = Bit;
+		printf("bit %d: ", Bit);
+		if (!SelectForms(Table, C))
+		{
+			if (!AllOutputBits)
+				return 1;
+			continue;
+		}
+
+		for (i = 0; i < 3; i++)
+		{
+			printf("%c = ", "xyz"[i]);
+			for (v = 0; v < NumberOfSboxBits; v++)
+				if ((C->Forms[i] >> v) & 1)
+					printf("%c", 'a' + v);
+			printf((i < 2) ? ", " : "\n");
+		}
+
+		NumberOfCoordinates++;
+	}
+
+	// the coordinates with the same target share one search
+	NumberOfBatches = 0;
+	for (c = 0; c < NumberOfCoordinates; c++)
+	{
+		for (b = 0; b < NumberOfBatches; b++)
+			if (!memcmp(Batches[b].Coordinates[0]->TargetFunc, Coordinates[c].TargetFunc, 8))
+				break;
+
+		if (b == NumberOfBatches)
+			Batches[NumberOfBatches++].NumberOfCoordinates = 0;
+		Batches[b].Coordinates[Batches[b].NumberOfCoordinates++] = &Coordinates[c];
+	}
+
+	if (AllOutputBits)
+		printf("%d coordinates, %d searches\n", NumberOfCoordinates, NumberOfBatches);
+
+	FillANFTables(8);
+	FillChoices();
+	FillTableIndexes();
+	CompileProbeSpec();
+	FillProbeSets();
+	if (KeepProbeMasks && (NumberOfGroupSets > MaxNumberOfGroupSets))
+	{
+		printf("too many probe sets in a group to keep their masks\n");
+		return(0);
+	}
+	FillRelabellings();
+	FillChoiceImages();
+	DefineFunction(&ANFTargetFunc, 500);
+
+	omp_set_num_threads(NumberOfThreads);
+
+	// the masked S-box input, the unmasked input first and then the masks, to the masked x y z
+	for (c = 0; c < NumberOfCoordinates; c++)
+	{
+		C = &Coordinates[c];
+		C->TableIndex = NULL;
+		if (NumberOfSboxBits * NumberOfShares <= MaxTableBits)
+			C->TableIndex = (unsigned short*)malloc((1 << (NumberOfSboxBits * NumberOfShares)) * sizeof(unsigned short));
+		for (j = 0; C->TableIndex && (j < (1U << (NumberOfSboxBits * NumberOfShares))); j++)
+		{
+			C->TableIndex[j] = 0;
+			for (s = 0; s < NumberOfShares; s++)
+				for (i = 0; i < 3; i++)
+					C->TableIndex[j] = (C->TableIndex[j] << 1) |
+						Parity[(j >> (NumberOfSboxBits * (NumberOfShares - 1 - s))) & C->Forms[2 - i] & ((1 << NumberOfSboxBits) - 1)];
+		}
+
+		sprintf(C->FileName, "Res_%d.csv", C->OutputBit);
+		F = fopen(C->FileName, "wt");
+		fclose(F);
+	}
+
+	GroupLists = (GroupListstruct*)calloc(1 << NumberOfPairs, sizeof(GroupListstruct));
+
+	for (b = 0; b < NumberOfBatches; b++)
+	{
+		// the products of all shares of x and y give x & y, the linear terms of the target are made by the components
+		MakeANF(Batches[b].Coordinates[0]->TargetFunc, 8, &ANFTargetFunc, 1, 0);
+		ANFTarget = 0;
+		Quadratic = 0;
+		for (j = 0; j < ANFTargetFunc.NumberOfTerms; j++)
+		{
+			if (ANFTargetFunc.Term[j] == 3)
+				Quadratic = 1;
+			else if ((ANFTargetFunc.Term[j] == 1) || (ANFTargetFunc.Term[j] == 2) || (ANFTargetFunc.Term[j] == 4))
+			{
+				Var = (ANFTargetFunc.Term[j] == 1) ? 0 : ((ANFTargetFunc.Term[j] == 2) ? 1 : 2);
+				for (s = 0; s < NumberOfShares; s++)
+					ANFTarget |= (uint64_t)1 << ((3 - Var) * NumberOfShares - 1 - s);
+			}
+			else
+				Quadratic = 2;
+		}
+
+		if (Quadratic != 1)
+		{
+			printf("the target has to be x & y with linear terms\n");
+			return 1;
+		}
+
+		if (AllOutputBits)
+		{
+			printf("bits");
+			for (c = 0; c < Batches[b].NumberOfCoordinates; c++)
+				printf(" %d", Batches[b].Coordinates[c]->OutputBit);
+			printf("\n");
+		}
+
+		NumberOfFound = 0;
+
+		EnumerateTypes(Type, 0, 0, ANFTarget, Batches[b].Coordinates[0]->TargetFunc, &Batches[b], NumberOfFound);
+	}
+
+	FreeFunction(&ANFTargetFunc);
+
+	printf("done");
+
+	return 0;
+}
@@ -32,6 +32,14 @@
 #include <inttypes.h>
 #include <omp.h>
 
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #define	MaxNumberOfTerms 1000000000L
 
 unsigned char   *HW;
@@ -40,6 +48,38 @@ unsigned long  **IndexesInHW;
 
 #define ONEL ((unsigned __int64)1)
 
+// a FindCombination streaming the rows (Streaming = 1) waits on this FIFO, or on Windows this event, for new rows
+#ifdef _WIN32
+const char	StreamName[100] = "Local\\Keccak_stream";
+#else
+const char	StreamName[100] = "Keccak_stream.fifo";
+#endif
+
+// wakes up the streaming FindCombination after a row is appended, nothing is done if none is running
+void NotifyNewRow()
+{
+#ifdef _WIN32
+	HANDLE	Event;
+
+	Event = OpenEventA(EVENT_MODIFY_STATE, FALSE, StreamName);
+	if (Event != NULL)
+	{
+		SetEvent(Event);
+		CloseHandle(Event);
+	}
+#else
+	int		Fifo;
+	char	Signal = 1;
+
+	Fifo = open(StreamName, O_WRONLY | O_NONBLOCK);
+	if (Fifo >= 0)
+	{
+		write(Fifo, &Signal, 1);
+		close(Fifo);
+	}
+#endif
+}
+
 void FillANFTables(unsigned int NumberOfCells)
 {
 	unsigned int	i, Bit;
@@ -880,6 +920,156 @@ void MakeLargeTables(unsigned char** F3to1[3], unsigned char** F3to1_full, int N
 	}
 }
 
+const char		PartnerFileName[100] = "Partner_%d.csv"; // rows already known for the other output bits (e.g. a former Res_x.csv), a missing file means no partners for that bit
+#define			MaxNumberOfPartnerBits 8
+
+unsigned char*	PartnerTables[MaxNumberOfPartnerBits]; // the 3 full tables of every partner row one after another
+unsigned int	NumberOfPartners[MaxNumberOfPartnerBits];
+
+void ReadPartners(unsigned char OutputBit)
+{
+	FILE*			F;
+	char			FileName[100];
+	char*			TempStr;
+	int				TempChar;
+	unsigned char	Bit;
+	unsigned char	Share;
+	unsigned int	Size;
+	unsigned int	l;
+	unsigned int	k;
+
+	TempStr = (char*)malloc((1 << 15) * sizeof(char));
+
+	for (Bit = 0; Bit < MaxNumberOfPartnerBits; Bit++)
+	{
+		free(PartnerTables[Bit]);
+		PartnerTables[Bit] = NULL;
+		NumberOfPartners[Bit] = 0;
+
+		sprintf(FileName, PartnerFileName, Bit);
+		if ((Bit == OutputBit) || ((F = fopen(FileName, "rt")) == NULL))
+			continue;
+
+		// the full tables are the only fields of a row made of (1 << 15) digits
+		Size = 0;
+		Share = 0;
+		l = 0;
+		do
+		{
+			TempChar = fgetc(F);
+			if ((TempChar == ',') || (TempChar == '\n') || (TempChar == EOF))
+			{
+				if (l == (1 << 15))
+				{
+					if ((NumberOfPartners[Bit] == Size) && (Share == 0))
+					{
+						Size = Size ? 2 * Size : 1024;
+						PartnerTables[Bit] = (unsigned char*)realloc(PartnerTables[Bit], (size_t)Size * 3 * (1 << 15) * sizeof(unsigned char));
+					}
+
+					for (k = 0; k < (1 << 15); k++)
+						PartnerTables[Bit][((size_t)NumberOfPartners[Bit] * 3 + Share) * (1 << 15) + k] = TempStr[k] - '0';
+
+					if (++Share == 3)
+					{
+						Share = 0;
+						NumberOfPartners[Bit]++;
+					}
+				}
+
+				if (TempChar == '\n')
+					Share = 0;
+				l = 0;
+			}
+			else if (TempChar != ' ')
+			{
+				if ((l < (1 << 15)) && (TempChar >= '0') && (TempChar <= '7'))
+					TempStr[l++] = TempChar;
+				else
+					l = (1 << 15) + 1;
+			}
+		} while (TempChar != EOF);
+
+		fclose(F);
+		printf("%d partners for output bit %d\n", NumberOfPartners[Bit], Bit);
+	}
+
+	free(TempStr);
+}
+
+// a candidate is written only if every output bit with known partners has one partner passing the checks
+// FindCombination makes on the couple: uniformity of the unmasked outputs and identical distributions
+// of the 9 pairs of full tables in every 1024
+unsigned char IsCompatibleWithPartners(unsigned char* MadeTable1, unsigned char* MadeTable2, unsigned char* MadeTable3,
+	unsigned short* TableIndex, unsigned char* Unmasking)
+{
+	unsigned char*	MadeTable[3] = { MadeTable1, MadeTable2, MadeTable3 };
+	unsigned char*	Partner;
+	unsigned char	Full[3];
+	unsigned char	Table0;
+	unsigned char	Table1;
+	unsigned short	UniformityCounter[64];
+	unsigned short	Dis[9][64];
+	unsigned short	DisOld[9][64];
+	unsigned int	Masked_InputIndex;
+	unsigned int	p;
+	unsigned char	Bit;
+	unsigned char	Share0;
+	unsigned char	Share1;
+
+	for (Bit = 0; Bit < MaxNumberOfPartnerBits; Bit++)
+	{
+		if (!NumberOfPartners[Bit])
+			continue;
+
+		for (p = 0; p < NumberOfPartners[Bit]; p++)
+		{
+			Partner = PartnerTables[Bit] + (size_t)p * 3 * (1 << 15);
+
+			for (Masked_InputIndex = 0; Masked_InputIndex < (1 << 15); Masked_InputIndex++)
+			{
+				if ((Masked_InputIndex & 0x3FF) == 0) // every 1024
+				{
+					memset(UniformityCounter, 0, sizeof(UniformityCounter));
+					memset(Dis, 0, sizeof(Dis));
+				}
+
+				Table0 = 0;
+				Table1 = 0;
+				for (Share0 = 0; Share0 < 3; Share0++)
+				{
+					Full[Share0] = MadeTable[Share0][TableIndex[Masked_InputIndex]];
+					Table0 |= Unmasking[Full[Share0]] << Share0;
+					Table1 |= Unmasking[Partner[Share0 * (1 << 15) + Masked_InputIndex]] << Share0;
+				}
+
+				if (++UniformityCounter[(Table1 << 3) | Table0] > 1024 / 16)
+					break;
+
+				for (Share0 = 0; Share0 < 3; Share0++)
+					for (Share1 = 0; Share1 < 3; Share1++)
+						Dis[Share0 * 3 + Share1][(Partner[Share1 * (1 << 15) + Masked_InputIndex] << 3) | Full[Share0]]++;
+
+				if ((Masked_InputIndex & 0x3FF) == 0x3FF) // every 1024
+				{
+					if (Masked_InputIndex == 0x3FF) // the first one
+						memcpy(DisOld, Dis, sizeof(Dis));
+					else if (memcmp(DisOld, Dis, sizeof(Dis)))
+						break;
+				}
+			}
+
+			if (Masked_InputIndex == (1 << 15)) // compatible
+				break;
+		}
+
+		if (p == NumberOfPartners[Bit])
+			return(0);
+	}
+
+	return(1);
+}
+
 void FindCombination(unsigned char** F3to1[3], unsigned char** F3to1_full, int NumberOfF3to1, char Type[9],
 	unsigned char* TargetFunc, char* FileName, unsigned short MaxNumberOfSolutionsPerANF,
 	unsigned char** InputTableIndex, unsigned short* OutputTableIndex, unsigned char* Unmasking, unsigned char* UnmaskedInputTable,
@@ -1121,7 +1311,7 @@ void FindCombination(unsigned char** F3to1[3], unsigned char** F3to1_full, int N
 						}
 					}
 
-					if (Masked_InputIndex == 512)
+					if ((Masked_InputIndex == 512) && IsCompatibleWithPartners(MadeTable1, MadeTable2, MadeTable3, TableIndex, Unmasking))
 					{
 						#pragma omp critical (foundmain)
 						{
@@ -1181,6 +1371,7 @@ void FindCombination(unsigned char** F3to1[3], unsigned char** F3to1_full, int N
 									fprintf(F, "%x", MadeTable3[TableIndex[j]]);
 								fprintf(F, ",\n");
 								fclose(F);
+								NotifyNewRow();
 
 								NumberOfSolutionsPerANF++;
 								if (MaxNumberOfSolutionsPerANF && (NumberOfSolutionsPerANF >= MaxNumberOfSolutionsPerANF))
@@ -1205,6 +1396,229 @@ void FindCombination(unsigned char** F3to1[3], unsigned char** F3to1_full, int N
 	FreeFunction(&ANFFunc);
 }
 
+// chi is invariant under rotation, so the rows of an output bit are the rows of output bit 0 with the variables
+// renamed a->b->c->d->e->a OutputBit times and the inputs of the tables permuted in the same way; the search keeps
+// MaxNumberOfSolutionsPerANF rows per ANF and may keep other representatives than the rotation does
+const unsigned char	RotateOutputBits = 1; // search output bit 0 only and derive Keccak_1..4.csv from Keccak_0.csv
+const unsigned char	CheckRotatedRows = 1; // keep only the derived rows that pass the checks of a searched row (CheckRotation)
+
+void RotateRows(unsigned char OutputBit, char* FileName)
+{
+	FILE*			F0;
+	FILE*			F;
+	char*			TempStr;
+	int				TempChar;
+	unsigned short*	Permutation;
+	unsigned int	NumberOfDigits;
+	unsigned int	l;
+	unsigned int	j;
+	unsigned char	Group;
+	unsigned char	abcde;
+
+	// input j of the new table is input Permutation[j] of the table of output bit 0
+	Permutation = (unsigned short*)malloc((1 << 15) * sizeof(unsigned short));
+	for (j = 0; j < (1 << 15); j++)
+	{
+		Permutation[j] = 0;
+		for (Group = 0; Group < 3; Group++)
+		{
+			abcde = (j >> (5 * Group)) & 0x1F;
+			Permutation[j] |= (((abcde >> OutputBit) | (abcde << (5 - OutputBit))) & 0x1F) << (5 * Group);
+		}
+	}
+
+	TempStr = (char*)malloc((1 << 16) * sizeof(char));
+
+	F0 = fopen("Keccak_0.csv", "rt");
+	F = fopen(FileName, "wt");
+
+	l = 0;
+	NumberOfDigits = 0;
+	do
+	{
+		TempChar = fgetc(F0);
+		if ((TempChar == ',') || (TempChar == '\n') || (TempChar == EOF))
+		{
+			TempStr[l] = 0;
+			if (NumberOfDigits == (1 << 15)) // a table
+			{
+				for (j = 0; TempStr[j] == ' '; j++)
+					fputc(' ', F);
+
+				for (l = 0; l < (1 << 15); l++)
+					fputc(TempStr[j + Permutation[l]], F);
+			}
+			else
+			{
+				for (j = 0; j < l; j++)
+					if ((TempStr[j] >= 'a') && (TempStr[j] <= 'e'))
+						TempStr[j] = 'a' + (TempStr[j] - 'a' + OutputBit) % 5;
+
+				fputs(TempStr, F);
+			}
+
+			if (TempChar != EOF)
+				fputc(TempChar, F);
+
+			l = 0;
+			NumberOfDigits = 0;
+		}
+		else if (l < (1 << 16) - 1)
+		{
+			TempStr[l++] = TempChar;
+			if (TempChar != ' ')
+				NumberOfDigits++;
+		}
+	} while (TempChar != EOF);
+
+	fclose(F0);
+	fclose(F);
+	free(TempStr);
+	free(Permutation);
+}
+
+// 1 if the three tables of a row (values of the (1 << 15) inputs, the unmasked input abcde in the top 5 bits) unmask
+// to the output bit OutputBit of chi, have uniform masked outputs and the same joint distribution of every two of them
+// for every unmasked input, the checks FindCombination makes on the 512 inputs of x, y, z
+unsigned char IsValidRow(unsigned char* Tables[3], unsigned char OutputBit, unsigned char* TargetFunc, unsigned char* Unmasking)
+{
+	unsigned short	UniformityCounter[8];
+	unsigned short	Dis[3][64];
+	unsigned short	DisOld[3][64];
+	unsigned int	Masked_InputIndex;
+	unsigned char	abcde;
+	unsigned char	xyz;
+	unsigned char	Masked_Output;
+	unsigned char	j;
+
+	for (Masked_InputIndex = 0; Masked_InputIndex < (1 << 15); Masked_InputIndex++)
+	{
+		if ((Masked_InputIndex & 0x3FF) == 0) // every 1024
+		{
+			memset(UniformityCounter, 0, sizeof(UniformityCounter));
+			memset(Dis, 0, sizeof(Dis));
+		}
+
+		abcde = Masked_InputIndex >> 10;
+		xyz = (((abcde >> ((3 + OutputBit) % 5)) & 1) << 0) |
+			(((abcde >> ((4 + OutputBit) % 5)) & 1) << 1) |
+			(((abcde >> ((0 + OutputBit) % 5)) & 1) << 2);
+
+		Masked_Output = (Unmasking[Tables[2][Masked_InputIndex]] << 2) | (Unmasking[Tables[1][Masked_InputIndex]] << 1) | Unmasking[Tables[0][Masked_InputIndex]];
+		if (Unmasking[Masked_Output] != TargetFunc[xyz])
+			return(0);
+
+		UniformityCounter[Masked_Output]++;
+
+		Dis[0][(Tables[1][Masked_InputIndex] << 3) | Tables[0][Masked_InputIndex]]++;
+		Dis[1][(Tables[2][Masked_InputIndex] << 3) | Tables[0][Masked_InputIndex]]++;
+		Dis[2][(Tables[2][Masked_InputIndex] << 3) | Tables[1][Masked_InputIndex]]++;
+
+		if ((Masked_InputIndex & 0x3FF) == 0x3FF) // every 1024
+		{
+			for (j = 0; j < 8; j++)
+				if ((UniformityCounter[j] != 0) && (UniformityCounter[j] != 1024 / 4))
+					return(0);
+
+			if (Masked_InputIndex == 0x3FF) // the first one
+				memcpy(DisOld, Dis, sizeof(Dis));
+			else if (memcmp(DisOld, Dis, sizeof(Dis)))
+				return(0);
+		}
+	}
+
+	return(1);
+}
+
+// the rows derived for OutputBit in FileName are checked by what they compute, as the search of OutputBit may keep
+// other rows than the rotation gives: a row is kept if its tables unmask to the rotated target with uniform outputs and
+// identical distributions (IsValidRow) and are compatible with the partners of the other output bits, like a searched row
+void CheckRotation(unsigned char OutputBit, char* FileName, unsigned char* TargetFunc, unsigned char* Unmasking)
+{
+	FILE*			F;
+	char*			Text;
+	char*			Row;
+	char*			Field;
+	unsigned char*	Tables[3];
+	unsigned short*	TableIndex;
+	long			Size;
+	long			i;
+	unsigned int	NumberOfRows;
+	unsigned int	NumberOfValid;
+	unsigned int	NumberOfKept;
+	unsigned int	l;
+	unsigned char	Share;
+
+	F = fopen(FileName, "rb");
+	fseek(F, 0, SEEK_END);
+	Size = ftell(F);
+	fseek(F, 0, SEEK_SET);
+	Text = (char*)malloc((Size + 1) * sizeof(char));
+	Size = fread(Text, 1, Size, F);
+	Text[Size] = 0;
+	fclose(F);
+
+	for (Share = 0; Share < 3; Share++)
+		Tables[Share] = (unsigned char*)malloc((1 << 15) * sizeof(unsigned char));
+
+	// the tables are given to IsCompatibleWithPartners in the order of the inputs
+	TableIndex = (unsigned short*)malloc((1 << 15) * sizeof(unsigned short));
+	for (l = 0; l < (1 << 15); l++)
+		TableIndex[l] = l;
+
+	ReadPartners(OutputBit);
+
+	F = fopen(FileName, "wt");
+	NumberOfRows = 0;
+	NumberOfValid = 0;
+	NumberOfKept = 0;
+	for (Row = Text; *Row; Row = Text + i + 1)
+	{
+		for (i = Row - Text; (i < Size) && (Text[i] != '\n'); i++);
+		Text[i] = 0;
+		if (!*Row)
+			continue;
+
+		// the tables are the only fields of a row made of (1 << 15) digits
+		Share = 0;
+		for (Field = Row; *Field && (Share < 3); Field += l)
+		{
+			while (*Field == ' ')
+				Field++;
+			for (l = 0; (Field[l] >= '0') && (Field[l] <= '7'); l++);
+			if ((l == (1 << 15)) && ((Field[l] == ',') || (Field[l] == 0)))
+			{
+				for (l = 0; l < (1 << 15); l++)
+					Tables[Share][l] = Field[l] - '0';
+				Share++;
+			}
+			for (; Field[l] && (Field[l] != ','); l++);
+			if (Field[l])
+				l++;
+		}
+
+		NumberOfRows++;
+		if ((Share == 3) && IsValidRow(Tables, OutputBit, TargetFunc, Unmasking))
+		{
+			NumberOfValid++;
+			if (IsCompatibleWithPartners(Tables[0], Tables[1], Tables[2], TableIndex, Unmasking))
+			{
+				NumberOfKept++;
+				fprintf(F, "%s\n", Row);
+			}
+		}
+	}
+	fclose(F);
+
+	printf("output bit %d: %d of %d rotated rows unmask to the target and pass the checks, %d compatible with the partners\n",
+		OutputBit, NumberOfValid, NumberOfRows, NumberOfKept);
+
+	free(TableIndex);
+	for (Share = 0; Share < 3; Share++)
+		free(Tables[Share]);
+	free(Text);
+}
+
 int main()
 {
 	unsigned char**		InputTableIndex = NULL;
@@ -1268,8 +1682,18 @@ int main()
 	for (OutputBit = 0; OutputBit <= 4; OutputBit++)
 	{
 		sprintf(FileName, "Keccak_%d.csv", OutputBit);
+
+		if (RotateOutputBits && OutputBit)
+		{
+			RotateRows(OutputBit, FileName);
+			if (CheckRotatedRows)
+				CheckRotation(OutputBit, FileName, TargetFunc, Unmasking);
+			continue;
+		}
+
 		F = fopen(FileName, "wt");
 		fclose(F);
+		ReadPartners(OutputBit);
 
 		//---------------------------------------
 
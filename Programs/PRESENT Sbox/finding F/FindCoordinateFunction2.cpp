@@ -31,6 +31,14 @@
 #include <inttypes.h>
 #include <omp.h>
 
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #define	MaxNumberOfTerms 1000000000L
 
 unsigned char   *HW;
@@ -39,6 +47,38 @@ unsigned long  **IndexesInHW;
 
 #define ONEL ((unsigned __int64)1)
 
+// a FindCombination streaming the rows (Streaming = 1) waits on this FIFO, or on Windows this event, for new rows
+#ifdef _WIN32
+const char	StreamName[100] = "Local\\Res_stream";
+#else
+const char	StreamName[100] = "Res_stream.fifo";
+#endif
+
+// wakes up the streaming FindCombination after a row is appended, nothing is done if none is running
+void NotifyNewRow()
+{
+#ifdef _WIN32
+	HANDLE	Event;
+
+	Event = OpenEventA(EVENT_MODIFY_STATE, FALSE, StreamName);
+	if (Event != NULL)
+	{
+		SetEvent(Event);
+		CloseHandle(Event);
+	}
+#else
+	int		Fifo;
+	char	Signal = 1;
+
+	Fifo = open(StreamName, O_WRONLY | O_NONBLOCK);
+	if (Fifo >= 0)
+	{
+		write(Fifo, &Signal, 1);
+		close(Fifo);
+	}
+#endif
+}
+
 void FillANFTables(unsigned int NumberOfCells)
 {
 	unsigned int	i, Bit;
@@ -818,6 +858,156 @@ void MakeLargeTables(unsigned char** F3to1[3], unsigned char** F3to1_full, int N
 	}
 }
 
+const char		PartnerFileName[100] = "Partner_%d.csv"; // rows already known for the other output bits (e.g. a former Res_x.csv), a missing file means no partners for that bit
+#define			MaxNumberOfPartnerBits 8
+
+unsigned char*	PartnerTables[MaxNumberOfPartnerBits]; // the 3 full tables of every partner row one after another
+unsigned int	NumberOfPartners[MaxNumberOfPartnerBits];
+
+void ReadPartners(unsigned char OutputBit)
+{
+	FILE*			F;
+	char			FileName[100];
+	char*			TempStr;
+	int				TempChar;
+	unsigned char	Bit;
+	unsigned char	Share;
+	unsigned int	Size;
+	unsigned int	l;
+	unsigned int	k;
+
+	TempStr = (char*)malloc((1 << 12) * sizeof(char));
+
+	for (Bit = 0; Bit < MaxNumberOfPartnerBits; Bit++)
+	{
+		free(PartnerTables[Bit]);
+		PartnerTables[Bit] = NULL;
+		NumberOfPartners[Bit] = 0;
+
+		sprintf(FileName, PartnerFileName, Bit);
+		if ((Bit == OutputBit) || ((F = fopen(FileName, "rt")) == NULL))
+			continue;
+
+		// the full tables are the only fields of a row made of (1 << 12) digits
+		Size = 0;
+		Share = 0;
+		l = 0;
+		do
+		{
+			TempChar = fgetc(F);
+			if ((TempChar == ',') || (TempChar == '\n') || (TempChar == EOF))
+			{
+				if (l == (1 << 12))
+				{
+					if ((NumberOfPartners[Bit] == Size) && (Share == 0))
+					{
+						Size = Size ? 2 * Size : 1024;
+						PartnerTables[Bit] = (unsigned char*)realloc(PartnerTables[Bit], (size_t)Size * 3 * (1 << 12) * sizeof(unsigned char));
+					}
+
+					for (k = 0; k < (1 << 12); k++)
+						PartnerTables[Bit][((size_t)NumberOfPartners[Bit] * 3 + Share) * (1 << 12) + k] = TempStr[k] - '0';
+
+					if (++Share == 3)
+					{
+						Share = 0;
+						NumberOfPartners[Bit]++;
+					}
+				}
+
+				if (TempChar == '\n')
+					Share = 0;
+				l = 0;
+			}
+			else if (TempChar != ' ')
+			{
+				if ((l < (1 << 12)) && (TempChar >= '0') && (TempChar <= '7'))
+					TempStr[l++] = TempChar;
+				else
+					l = (1 << 12) + 1;
+			}
+		} while (TempChar != EOF);
+
+		fclose(F);
+		printf("%d partners for output bit %d\n", NumberOfPartners[Bit], Bit);
+	}
+
+	free(TempStr);
+}
+
+// a candidate is written only if every output bit with known partners has one partner passing the checks
+// FindCombination makes on the couple: uniformity of the unmasked outputs and identical distributions
+// of the 9 pairs of full tables in every 256
+unsigned char IsCompatibleWithPartners(unsigned char* MadeTable1, unsigned char* MadeTable2, unsigned char* MadeTable3,
+	unsigned short* TableIndex, unsigned char* Unmasking)
+{
+	unsigned char*	MadeTable[3] = { MadeTable1, MadeTable2, MadeTable3 };
+	unsigned char*	Partner;
+	unsigned char	Full[3];
+	unsigned char	Table0;
+	unsigned char	Table1;
+	unsigned short	UniformityCounter[64];
+	unsigned short	Dis[9][64];
+	unsigned short	DisOld[9][64];
+	unsigned int	Masked_InputIndex;
+	unsigned int	p;
+	unsigned char	Bit;
+	unsigned char	Share0;
+	unsigned char	Share1;
+
+	for (Bit = 0; Bit < MaxNumberOfPartnerBits; Bit++)
+	{
+		if (!NumberOfPartners[Bit])
+			continue;
+
+		for (p = 0; p < NumberOfPartners[Bit]; p++)
+		{
+			Partner = PartnerTables[Bit] + (size_t)p * 3 * (1 << 12);
+
+			for (Masked_InputIndex = 0; Masked_InputIndex < (1 << 12); Masked_InputIndex++)
+			{
+				if ((Masked_InputIndex & 0xFF) == 0) // every 256
+				{
+					memset(UniformityCounter, 0, sizeof(UniformityCounter));
+					memset(Dis, 0, sizeof(Dis));
+				}
+
+				Table0 = 0;
+				Table1 = 0;
+				for (Share0 = 0; Share0 < 3; Share0++)
+				{
+					Full[Share0] = MadeTable[Share0][TableIndex[Masked_InputIndex]];
+					Table0 |= Unmasking[Full[Share0]] << Share0;
+					Table1 |= Unmasking[Partner[Share0 * (1 << 12) + Masked_InputIndex]] << Share0;
+				}
+
+				if (++UniformityCounter[(Table1 << 3) | Table0] > 1024 / 16)
+					break;
+
+				for (Share0 = 0; Share0 < 3; Share0++)
+					for (Share1 = 0; Share1 < 3; Share1++)
+						Dis[Share0 * 3 + Share1][(Partner[Share1 * (1 << 12) + Masked_InputIndex] << 3) | Full[Share0]]++;
+
+				if ((Masked_InputIndex & 0xFF) == 0xFF) // every 256
+				{
+					if (Masked_InputIndex == 0xFF) // the first one
+						memcpy(DisOld, Dis, sizeof(Dis));
+					else if (memcmp(DisOld, Dis, sizeof(Dis)))
+						break;
+				}
+			}
+
+			if (Masked_InputIndex == (1 << 12)) // compatible
+				break;
+		}
+
+		if (p == NumberOfPartners[Bit])
+			return(0);
+	}
+
+	return(1);
+}
+
 void FindCombination(unsigned char** F3to1[3], unsigned char** F3to1_full, int NumberOfF3to1, char Type[9],
 	unsigned char* TargetFunc, char* FileName, unsigned short MaxNumberOfSolutionsPerANF,
 	unsigned char** InputTableIndex, unsigned short* OutputTableIndex, unsigned char* Unmasking, unsigned char* UnmaskedInputTable,
@@ -1056,7 +1246,7 @@ void FindCombination(unsigned char** F3to1[3], unsigned char** F3to1_full, int N
 						}
 					}
 
-					if (Masked_InputIndex == 512)
+					if ((Masked_InputIndex == 512) && IsCompatibleWithPartners(MadeTable1, MadeTable2, MadeTable3, TableIndex, Unmasking))
 					{
 						#pragma omp critical (foundmain)
 						{
@@ -1116,6 +1306,7 @@ void FindCombination(unsigned char** F3to1[3], unsigned char** F3to1_full, int N
 									fprintf(F, "%x", MadeTable3[TableIndex[j]]);
 								fprintf(F, ",\n");
 								fclose(F);
+								NotifyNewRow();
 
 								NumberOfSolutionsPerANF++;
 								if (MaxNumberOfSolutionsPerANF && (NumberOfSolutionsPerANF >= MaxNumberOfSolutionsPerANF))
@@ -1199,6 +1390,7 @@ int main()
 		sprintf(FileName, "Res_%d.csv", OutputBit);
 		F = fopen(FileName, "wt");
 		fclose(F);
+		ReadPartners(OutputBit);
 
 		//---------------------------------------
 
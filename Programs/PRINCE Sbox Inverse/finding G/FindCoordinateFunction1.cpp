@@ -31,6 +31,14 @@
 #include <inttypes.h>
 #include <omp.h>
 
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #define	MaxNumberOfTerms 1000000000L
 
 unsigned char   *HW;
@@ -39,6 +47,38 @@ unsigned long  **IndexesInHW;
 
 #define ONEL ((unsigned __int64)1)
 
+// a FindCombination streaming the rows (Streaming = 1) waits on this FIFO, or on Windows this event, for new rows
+#ifdef _WIN32
+const char	StreamName[100] = "Local\\Res_stream";
+#else
+const char	StreamName[100] = "Res_stream.fifo";
+#endif
+
+// wakes up the streaming FindCombination after a row is appended, nothing is done if none is running
+void NotifyNewRow()
+{
+#ifdef _WIN32
+	HANDLE	Event;
+
+	Event = OpenEventA(EVENT_MODIFY_STATE, FALSE, StreamName);
+	if (Event != NULL)
+	{
+		SetEvent(Event);
+		CloseHandle(Event);
+	}
+#else
+	int		Fifo;
+	char	Signal = 1;
+
+	Fifo = open(StreamName, O_WRONLY | O_NONBLOCK);
+	if (Fifo >= 0)
+	{
+		write(Fifo, &Signal, 1);
+		close(Fifo);
+	}
+#endif
+}
+
 void FillANFTables(unsigned int NumberOfCells)
 {
 	unsigned int	i, Bit;
@@ -1016,6 +1056,7 @@ void FindCombination(char* FileName, unsigned short* OutputTableIndex,
 		fprintf(F, "%x", MadeTable3[TableIndex[j]]);
 	fprintf(F, ",\n");
 	fclose(F);
+	NotifyNewRow();
 
 	free(TableIndex);
 }
@@ -31,18 +31,50 @@
 #include <inttypes.h>
 #include <omp.h>
 
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#define fseek64 _fseeki64
+#define ftell64 _ftelli64
+#define ForceInline __forceinline
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#define fseek64 fseeko
+#define ftell64 ftello
+#define ForceInline inline __attribute__((always_inline))
+#endif
+
 const char	path[500] = "Res_";
 
 const unsigned char	NumberOfOutputBits = 4;
 const unsigned char Bits[NumberOfOutputBits] = { 3,0,1,2 };
 
-const unsigned char ReduceTables = 1;
-const unsigned char	ReorderTabes = 0;
-const unsigned char CheckCouples = 0;
+// ReduceTables, ReorderTabes, CheckCouples and NumberOfCPUs are overwritten by the planner if PlanSearch is set
+unsigned char		ReduceTables = 1;
+unsigned char		ReorderTabes = 0;
+unsigned char		CheckCouples = 0;
 const unsigned char	SameType = 0;
-const unsigned char NumberOfCPUs = 22;
-
-const long long		MaxCouplesPossible = 100000000L;
+unsigned char		NumberOfCPUs = 22;
+
+const unsigned char	PlanSearch = 0;
+const unsigned int	NumberOfPlanSamples = 256;	// couples sampled per pair of output bits
+const double		CoupleLookupTime = 1e-8;	// seconds to test one entry of CouplesPossible
+
+const long long		CouplesMemoryBudget = 1LL << 30; // bytes of RAM for the couple bitsets, the rest is spilled to files
+const char			CouplesSpillPath[500] = "Couples_";
+const unsigned int	TileCacheSize = 1 << 20; // bytes of cache a block of couples may occupy during the reduction
+const unsigned int	WorkItemsPerThread = 64; // the outermost levels of the final search are split into this many work items per thread, idle threads steal them
+const long long		TablesMemoryBudget = 16LL << 30; // bytes of RAM for the buckets of tables, the least recently used ones are written to files and read back when needed
+const char			TablesSpillPath[500] = "Tables_";
+const unsigned int	TablesPerBucket = 256; // at most this many tables of one output bit in a bucket, loaded and written back together
+const unsigned int	MinTablesPerSignature = 16; // the rows of rarer signatures share buckets with each other
+const unsigned char	CountOnly = 0;	// only count the combinations (with the multiplicities of the tables), no rows are written
+const unsigned char	Streaming = 0;	// combine the rows while the coordinate searches are still appending them to Res_x.csv
+const unsigned int	StreamIdleTimeout = 600; // seconds without a new row after which the streaming combination stops
 
 //-----------------------------------------------------
 
@@ -112,31 +144,106 @@ unsigned char CheckUniformity(unsigned char* TablesAddress[NumberOfOutputBits],
 	return(0); // is uniform
 }
 
-unsigned char CheckDistributions(unsigned char** FullTablesAddress[NumberOfOutputBits], unsigned char** SmallTablesAddress[NumberOfOutputBits], unsigned char NumberOfTables, unsigned short** Dis, unsigned short** DisOld)
+// the probes of CheckDistributions, a probe compares the joint distribution of two share functions (FullTable or
+// SmallTable) of two tables over all blocks of the masked inputs, probes are sorted by the index of the later table
+// so that the probes among the first n tables are the first NumberOfProbes(n) ones
+const unsigned short	MaxNumberOfProbes = 63 * NumberOfOutputBits * (NumberOfOutputBits - 1) / 2;
+
+struct Probestruct
 {
-	unsigned int	Masked_InputIndex;
-	unsigned short	i, ii;
-	unsigned short	j, jj;
-	unsigned short	c, k;
-	unsigned char   RejectIndex[630];
+	unsigned char	Table0;
+	unsigned char	Function0;	// 0..2 FullTable, 3..11 SmallTable
+	unsigned char	Table1;
+	unsigned char	Function1;
+	unsigned char	RejectIndex;
+};
+
+// the number of probes among the first n tables, table i has 63 probes against each table before it
+constexpr unsigned short NumberOfProbes(unsigned char n)
+{
+	return(63 * n * (n - 1) / 2);
+}
+
+// the probes are built by the compiler, so that every CheckDistributions<n> has its probes as constants
+struct ProbeListstruct
+{
+	Probestruct		Probes[MaxNumberOfProbes];
 
-	c = 0;
-	for (i = 1;i < NumberOfTables; i++)
+	constexpr void AddProbe(unsigned short& c, unsigned char Table0, unsigned char Function0, unsigned char Table1, unsigned char Function1, unsigned char RejectIndex)
 	{
-		for (ii = 0;ii < 3;ii++)
-			for (j = 0; j < i; j++)
-			{
-				for (jj = 0;jj < 3;jj++)
-					RejectIndex[c++] = i;
+		Probes[c].Table0 = Table0;
+		Probes[c].Function0 = Function0;
+		Probes[c].Table1 = Table1;
+		Probes[c].Function1 = Function1;
+		Probes[c].RejectIndex = RejectIndex;
+		c++;
+	}
 
-				for (jj = 0;jj < 9;jj++)
-					RejectIndex[c++] = i;
-			}
+	constexpr ProbeListstruct() : Probes()
+	{
+		unsigned short	c = 0;
+
+		for (unsigned char i = 1;i < NumberOfOutputBits; i++)
+		{
+			for (unsigned char ii = 0;ii < 3;ii++)
+				for (unsigned char j = 0; j < i; j++)
+					for (unsigned char jj = 0;jj < 12;jj++)
+						AddProbe(c, j, jj, i, ii, i);
+
+			for (unsigned char ii = 0;ii < 9;ii++)
+				for (unsigned char j = 0; j < i; j++)
+					for (unsigned char jj = 0;jj < 3;jj++)
+						AddProbe(c, j, jj, i, 3 + ii, i);
+		}
+	}
+};
+
+constexpr ProbeListstruct	ProbeList;
+
+// the place in Values of share function Function (0..2 FullTable, 3..11 SmallTable) of a table
+constexpr unsigned char ProbeValue(unsigned char Table, unsigned char Function)
+{
+	return(Table * 12 + Function);
+}
+
+// counts the probes First..First+Count-1 for the share function values of one masked input; the probes are split
+// in halves down to single ones, so that the compiler inlines all of them with the places of their values as constants
+template <unsigned short First, unsigned short Count>
+struct ProbeCounterstruct
+{
+	static ForceInline void Add(unsigned short** Dis, const unsigned char* Values)
+	{
+		ProbeCounterstruct<First, Count / 2>::Add(Dis, Values);
+		ProbeCounterstruct<First + Count / 2, Count - Count / 2>::Add(Dis, Values);
+	}
+};
+
+template <unsigned short First>
+struct ProbeCounterstruct<First, 1>
+{
+	static ForceInline void Add(unsigned short** Dis, const unsigned char* Values)
+	{
+		Dis[First][(Values[ProbeValue(ProbeList.Probes[First].Table0, ProbeList.Probes[First].Function0)] << 3) |
+			Values[ProbeValue(ProbeList.Probes[First].Table1, ProbeList.Probes[First].Function1)]]++;
+	}
+};
+
+template <unsigned char NumberOfTables>
+unsigned char CheckDistributions(unsigned char** FullTablesAddress[NumberOfOutputBits], unsigned char** SmallTablesAddress[NumberOfOutputBits], unsigned short** Dis, unsigned short** DisOld)
+{
+	const unsigned short	c = NumberOfProbes(NumberOfTables);
+	unsigned int	Masked_InputIndex;
+	unsigned short	k;
+	unsigned char	f;
+	unsigned char*	Functions[12 * NumberOfTables];
+	unsigned char	Values[12 * NumberOfTables];
 
-		for (ii = 0;ii < 9;ii++)
-			for (j = 0; j < i; j++)
-				for (jj = 0;jj < 3;jj++)
-					RejectIndex[c++] = i;
+	for (k = 0;k < NumberOfTables;k++)
+	{
+		for (f = 0;f < 3;f++)
+			Functions[ProbeValue(k, f)] = FullTablesAddress[k][f];
+		for (f = 0;f < 9;f++)
+			Functions[ProbeValue(k, 3 + f)] = SmallTablesAddress[k][f];
 	}
 
 	//******************************//
@@ -147,24 +254,10 @@ unsigned char CheckDistributions(unsigned char** FullTablesAddress[NumberOfOutpu
 			for (k = 0;k < c;k++)
 				memset(Dis[k], 0, 128 * sizeof(unsigned short));
 
-		c = 0;
-		for (i = 1;i < NumberOfTables; i++)
-		{
-			for (ii = 0;ii < 3;ii++)
-				for (j = 0; j < i; j++)
-				{
-					for (jj = 0;jj < 3;jj++)
-						Dis[c++][(FullTablesAddress[j][jj][Masked_InputIndex] << 3) | FullTablesAddress[i][ii][Masked_InputIndex]]++;
-
-					for (jj = 0;jj < 9;jj++)
-						Dis[c++][(SmallTablesAddress[j][jj][Masked_InputIndex] << 3) | FullTablesAddress[i][ii][Masked_InputIndex]]++;
-				}
+		for (k = 0;k < 12 * NumberOfTables;k++)
+			Values[k] = Functions[k][Masked_InputIndex];
 
-			for (ii = 0;ii < 9;ii++)
-				for (j = 0; j < i; j++)
-					for (jj = 0;jj < 3;jj++)
-						Dis[c++][(FullTablesAddress[j][jj][Masked_InputIndex] << 3) | SmallTablesAddress[i][ii][Masked_InputIndex]]++;
-		}
+		ProbeCounterstruct<0, c>::Add(Dis, Values);
 
 		if (((Masked_InputIndex & 0xFF) == 0xFF)) // every 256
 		{
@@ -177,7 +270,7 @@ unsigned char CheckDistributions(unsigned char** FullTablesAddress[NumberOfOutpu
 			{
 				for (k = 0;k < c;k++)
 					if (memcmp(DisOld[k], Dis[k], 128 * sizeof(unsigned short)))
-						return(RejectIndex[k]);
+						return(ProbeList.Probes[k].RejectIndex);
 			}
 		}
 	}
@@ -185,6 +278,22 @@ unsigned char CheckDistributions(unsigned char** FullTablesAddress[NumberOfOutpu
 	return(0); // distributions are identical
 }
 
+// for a number of tables only known at run time
+unsigned char CheckDistributions(unsigned char** FullTablesAddress[NumberOfOutputBits], unsigned char** SmallTablesAddress[NumberOfOutputBits], unsigned char NumberOfTables, unsigned short** Dis, unsigned short** DisOld)
+{
+	switch (NumberOfTables)
+	{
+	case 2:
+		return(CheckDistributions<2>(FullTablesAddress, SmallTablesAddress, Dis, DisOld));
+	case 3:
+		return(CheckDistributions<3>(FullTablesAddress, SmallTablesAddress, Dis, DisOld));
+	case 4:
+		return(CheckDistributions<4>(FullTablesAddress, SmallTablesAddress, Dis, DisOld));
+	}
+
+	return(0); // less than two tables, nothing to compare
+}
+
 
 
 struct UniqueTablestruct
@@ -193,76 +302,1618 @@ struct UniqueTablestruct
 	unsigned char*	Table;
 	unsigned char*	SmallTable[9];
 	unsigned int	Type;
+	uint64_t		ANF;
 	unsigned int	StartIndex;
 	unsigned int	Count;
+	unsigned int	Bucket;
+};
+
+struct SpillFilestruct
+{
+	char			Name[500]; // empty if kept in RAM
+#ifdef _WIN32
+	HANDLE			File;
+	HANDLE			Mapping;
+#else
+	int				File;
+#endif
 };
 
+unsigned int	NumberOfSpillFiles = 0;
 
-int main()
+// a new file of Size bytes mapped into memory, the pages are loaded by the OS when they are accessed
+void* MapSpillFile(SpillFilestruct* Spill, const char* SpillPath, size_t Size)
 {
-	FILE*				F;
-	char				FilePath[500];
-	char*				TempStr;
-	UniqueTablestruct  *UniqueTables[NumberOfOutputBits];
-	unsigned int		NumberOfUniqueTables[NumberOfOutputBits];
-	unsigned int		Type;
-	uint64_t			ANF_old;
-	uint64_t			ANF;
-	char**				Strings[18][NumberOfOutputBits];
-	unsigned int		NumberOfTables[NumberOfOutputBits];
-	unsigned char*		Flags[NumberOfOutputBits];
-	unsigned char		OnPattern[NumberOfOutputBits];
-	unsigned char		OffPattern[NumberOfOutputBits];
-	unsigned int		NumberOfReducedTables[NumberOfOutputBits];
-	unsigned int*		ReducedTablesIndex[NumberOfOutputBits];
+	void*	Address;
+
+	sprintf(Spill->Name, "%s%d.bin", SpillPath, NumberOfSpillFiles++);
+
+#ifdef _WIN32
+	Spill->File = CreateFileA(Spill->Name, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY, NULL);
+	Spill->Mapping = CreateFileMappingA(Spill->File, NULL, PAGE_READWRITE, (DWORD)((uint64_t)Size >> 32), (DWORD)(Size & 0xFFFFFFFF), NULL);
+	Address = (Spill->Mapping == NULL) ? NULL : MapViewOfFile(Spill->Mapping, FILE_MAP_ALL_ACCESS, 0, 0, Size);
+#else
+	Spill->File = open(Spill->Name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if ((Spill->File < 0) || ftruncate(Spill->File, Size))
+		Address = NULL;
+	else
+	{
+		Address = mmap(NULL, Size, PROT_READ | PROT_WRITE, MAP_SHARED, Spill->File, 0);
+		if (Address == MAP_FAILED)
+			Address = NULL;
+	}
+#endif
 
-	unsigned int		TempSize[NumberOfOutputBits];
-	unsigned int		min;
-	unsigned int		max;
-	unsigned char		TablesOrder[NumberOfOutputBits];
-	unsigned char		TablesOrderInv[NumberOfOutputBits];
-	char				TempChar;
-	int					j;
-	unsigned int		k, l;
-	char				index;
-	char				index2;
-	int					i_last;
-	unsigned int		i[NumberOfOutputBits + 1];
-	int					i0;
-	int					i1;
-	unsigned char*		TablesAddress[NumberOfOutputBits];
-	unsigned char**		FullTablesAddress[NumberOfOutputBits];
-	unsigned char**		SmallTablesAddress[NumberOfOutputBits];
-	long long			NumberOfFound;
-	int					Counter;
-	char				Last;
-	char				CheckBit;
-	char				Res;
-	char**				CouplesPossible[NumberOfOutputBits][NumberOfOutputBits] = { NULL };
-	int					ThreadNum;
-	unsigned short***	UniformityCounter;
-	unsigned short***	Dis;
-	unsigned short***	DisOld;
-	char                VarStr[12][4] = { "a2","b2","c2","d2", "a1","b1","c1","e1", "a3","b3","c3","d3" };
-	char				Dependency[3];
-	char				NumberOfDependencies;
-	short				abcd;
-	short				a1b1c1d1;
-	short				a2b2c2d2;
-	short				a3b3c3d3;
-	short				Value[12];
-	short				InputIndex;
+	if (Address == NULL)
+	{
+		printf("cannot map %s\n", Spill->Name);
+		exit(1);
+	}
+
+	return(Address);
+}
+
+void UnmapSpillFile(SpillFilestruct* Spill, void* Address, size_t Size)
+{
+#ifdef _WIN32
+	UnmapViewOfFile(Address);
+	CloseHandle(Spill->Mapping);
+	CloseHandle(Spill->File);
+#else
+	munmap(Address, Size);
+	close(Spill->File);
+#endif
+	remove(Spill->Name);
+}
+
+//-----------------------------------------------------
+
+// the tables of an output bit are kept in buckets of up to TablesPerBucket rows with the same signature (the rows of
+// rare signatures sharing buckets), a bucket is loaded when a thread acquires it and takes the bytes of the tables it
+// holds; at most about TablesMemoryBudget bytes are loaded, to make room the least recently used bucket that no thread
+// holds is written to the file of its output bit (if it changed) and freed. Every store has its own lock and keeps its
+// loaded buckets that no thread holds in a list from the least to the most recently used one
+const size_t		TableSize = 13 * (1 << 12);
+const unsigned int	NoBucket = 0xFFFFFFFF;
+
+struct TableBucketstruct
+{
+	unsigned char*	Bytes;			// NULL if not loaded
+	unsigned int	FirstTable;		// the tables of a bucket follow each other in UniqueTables
+	unsigned int	NumberOfTables;
+	unsigned int	Capacity;		// tables Bytes has room for
+	uint64_t		Signature;
+	int				Users;			// threads holding the bucket
+	long long		LastUse;
+	unsigned int	Older;			// in the list of the loaded buckets no thread holds
+	unsigned int	Newer;
+	long long		FileOffset;		// of its copy in the file, -1 if none
+	unsigned int	StoredTables;	// the tables the copy has room for
+	unsigned char	Dirty;			// changed since it was loaded
+};
+
+struct TableStorestruct
+{
+	UniqueTablestruct*	Tables;
+	TableBucketstruct*	Buckets;
+	unsigned int		NumberOfBuckets;
+	unsigned int		Capacity;
+	unsigned int		Oldest;			// the list of the loaded buckets no thread holds
+	unsigned int		Newest;
+	omp_lock_t			Lock;			// for the buckets, the list and the file
+	FILE*				File;			// opened when the first bucket is written back
+	long long			FileSize;
+	char				Name[500];
+};
+
+long long		TablesMemoryUsed = 0;
+long long		TablesUseClock = 0;
+long long		NumberOfBucketLoads = 0;
+long long		NumberOfBucketWrites = 0;
+
+void InitTableStore(TableStorestruct* Store, unsigned char index)
+{
+	Store->Tables = NULL;
+	Store->Capacity = 16;
+	Store->Buckets = (TableBucketstruct*)malloc(Store->Capacity * sizeof(TableBucketstruct));
+	Store->NumberOfBuckets = 0;
+	Store->Oldest = NoBucket;
+	Store->Newest = NoBucket;
+	omp_init_lock(&Store->Lock);
+	Store->File = NULL;
+	Store->FileSize = 0;
+	sprintf(Store->Name, "%s%d.bin", TablesSpillPath, Bits[index]);
+}
+
+void ChargeTables(long long Bytes)
+{
+	#pragma omp atomic
+	TablesMemoryUsed += Bytes;
+}
+
+void FreeTableStore(TableStorestruct* Store)
+{
+	unsigned int	b;
+
+	for (b = 0; b < Store->NumberOfBuckets; b++)
+		if (Store->Buckets[b].Bytes)
+		{
+			free(Store->Buckets[b].Bytes);
+			ChargeTables(-(long long)Store->Buckets[b].Capacity * TableSize);
+		}
+
+	if (Store->File)
+	{
+		fclose(Store->File);
+		remove(Store->Name);
+	}
+
+	omp_destroy_lock(&Store->Lock);
+	free(Store->Buckets);
+}
+
+// the 13 tables of a row are stored one after another
+void SetTablePointers(UniqueTablestruct* UniqueTable, unsigned char* TableBytes)
+{
+	unsigned char	k;
+
+	UniqueTable->Table = TableBytes;
+	for (k = 0; k < 3; k++)
+		UniqueTable->FullTable[k] = TableBytes + (1 + k) * (1 << 12);
+	for (k = 0; k < 9; k++)
+		UniqueTable->SmallTable[k] = TableBytes + (4 + k) * (1 << 12);
+}
+
+void SetBucketPointers(TableStorestruct* Store, TableBucketstruct* Bucket)
+{
+	unsigned int	t;
+
+	for (t = 0; t < Bucket->NumberOfTables; t++)
+		SetTablePointers(&Store->Tables[Bucket->FirstTable + t], Bucket->Bytes + (size_t)t * TableSize);
+}
+
+// the list of the loaded buckets no thread holds, under the lock of the store
+void UnlinkBucket(TableStorestruct* Store, unsigned int b)
+{
+	TableBucketstruct*	Bucket = &Store->Buckets[b];
+
+	if (Bucket->Older == NoBucket)
+		Store->Oldest = Bucket->Newer;
+	else
+		Store->Buckets[Bucket->Older].Newer = Bucket->Newer;
+
+	if (Bucket->Newer == NoBucket)
+		Store->Newest = Bucket->Older;
+	else
+		Store->Buckets[Bucket->Newer].Older = Bucket->Older;
+}
+
+void LinkNewestBucket(TableStorestruct* Store, unsigned int b)
+{
+	TableBucketstruct*	Bucket = &Store->Buckets[b];
+
+	Bucket->Older = Store->Newest;
+	Bucket->Newer = NoBucket;
+	if (Store->Newest == NoBucket)
+		Store->Oldest = b;
+	else
+		Store->Buckets[Store->Newest].Newer = b;
+	Store->Newest = b;
+}
+
+// under the lock of the store; a bucket that grew since its copy was written gets a new place at the end of the file
+void WriteBackBucket(TableStorestruct* Store, unsigned int b)
+{
+	TableBucketstruct*	Bucket = &Store->Buckets[b];
+
+	if (Bucket->Dirty)
+	{
+		if (Store->File == NULL)
+			Store->File = fopen(Store->Name, "w+b");
+
+		if ((Bucket->FileOffset < 0) || (Bucket->StoredTables < Bucket->NumberOfTables))
+		{
+			Bucket->FileOffset = Store->FileSize;
+			Bucket->StoredTables = Bucket->NumberOfTables;
+			Store->FileSize += (long long)Bucket->NumberOfTables * TableSize;
+		}
+
+		if ((Store->File == NULL) || fseek64(Store->File, Bucket->FileOffset, SEEK_SET) ||
+			(fwrite(Bucket->Bytes, TableSize, Bucket->NumberOfTables, Store->File) != Bucket->NumberOfTables))
+		{
+			printf("cannot write %s\n", Store->Name);
+			exit(1);
+		}
+
+		Bucket->Dirty = 0;
+		#pragma omp atomic
+		NumberOfBucketWrites++;
+	}
+
+	free(Bucket->Bytes);
+	Bucket->Bytes = NULL;
+	ChargeTables(-(long long)Bucket->Capacity * TableSize);
+}
+
+// the least recently used buckets of all output bits are written back until Bytes more fit in the budget, the stores
+// being locked one at a time; if every loaded bucket is held, the budget is exceeded
+void MakeRoom(TableStorestruct* Stores, long long Bytes)
+{
+	unsigned char	index;
+	unsigned char	Victim;
+	unsigned int	b;
+	long long		Used;
+	long long		OldestUse;
+	long long		LastUse;
+
+	while (1)
+	{
+		#pragma omp atomic read
+		Used = TablesMemoryUsed;
+		if (Used + Bytes <= TablesMemoryBudget)
+			return;
+
+		Victim = NumberOfOutputBits;
+		OldestUse = 0;
+		for (index = 0; index < NumberOfOutputBits; index++)
+		{
+			omp_set_lock(&Stores[index].Lock);
+			if (Stores[index].Oldest != NoBucket)
+			{
+				LastUse = Stores[index].Buckets[Stores[index].Oldest].LastUse;
+				if ((Victim == NumberOfOutputBits) || (LastUse < OldestUse))
+				{
+					Victim = index;
+					OldestUse = LastUse;
+				}
+			}
+			omp_unset_lock(&Stores[index].Lock);
+		}
+
+		if (Victim == NumberOfOutputBits)
+			return;
+
+		// the list may have changed meanwhile, its oldest bucket is taken anyway
+		omp_set_lock(&Stores[Victim].Lock);
+		b = Stores[Victim].Oldest;
+		if (b != NoBucket)
+		{
+			UnlinkBucket(&Stores[Victim], b);
+			WriteBackBucket(&Stores[Victim], b);
+		}
+		omp_unset_lock(&Stores[Victim].Lock);
+	}
+}
+
+// Stores holds all output bits, as a bucket of any of them may be written back to make room
+void AcquireBucket(TableStorestruct* Stores, unsigned char index, unsigned int b)
+{
+	TableStorestruct*	Store = &Stores[index];
+	TableBucketstruct*	Bucket = &Store->Buckets[b];
+	unsigned int		Capacity;
+	unsigned char		Loaded;
+
+	omp_set_lock(&Store->Lock);
+	Loaded = (Bucket->Bytes != NULL);
+	Capacity = Bucket->NumberOfTables ? Bucket->NumberOfTables : 1;
+	omp_unset_lock(&Store->Lock);
+
+	if (!Loaded)
+		MakeRoom(Stores, (long long)Capacity * TableSize);
+
+	omp_set_lock(&Store->Lock);
+	if (Bucket->Bytes == NULL)
+	{
+		Bucket->Capacity = Bucket->NumberOfTables ? Bucket->NumberOfTables : 1;
+		Bucket->Bytes = (unsigned char*)malloc((size_t)Bucket->Capacity * TableSize);
+		ChargeTables((long long)Bucket->Capacity * TableSize);
+
+		if (Bucket->FileOffset >= 0)
+		{
+			if (fseek64(Store->File, Bucket->FileOffset, SEEK_SET) ||
+				(fread(Bucket->Bytes, TableSize, Bucket->NumberOfTables, Store->File) != Bucket->NumberOfTables))
+			{
+				printf("cannot read %s\n", Store->Name);
+				exit(1);
+			}
+
+			#pragma omp atomic
+			NumberOfBucketLoads++;
+		}
+
+		SetBucketPointers(Store, Bucket);
+	}
+	else if (Bucket->Users == 0)
+		UnlinkBucket(Store, b);
+
+	Bucket->Users++;
+	omp_unset_lock(&Store->Lock);
+}
+
+void ReleaseBucket(TableStorestruct* Stores, unsigned char index, unsigned int b)
+{
+	TableStorestruct*	Store = &Stores[index];
+
+	omp_set_lock(&Store->Lock);
+	if (--Store->Buckets[b].Users == 0)
+	{
+		#pragma omp atomic capture
+		Store->Buckets[b].LastUse = ++TablesUseClock;
+		LinkNewestBucket(Store, b);
+	}
+	omp_unset_lock(&Store->Lock);
+}
+
+// the bucket of a table, *Held is the bucket the caller holds for this output bit (NoBucket if none), it is only
+// exchanged if the table is in another bucket
+void AcquireTable(TableStorestruct* Stores, unsigned char index, unsigned int Table, unsigned int* Held)
+{
+	if (*Held != Stores[index].Tables[Table].Bucket)
+	{
+		if (*Held != NoBucket)
+			ReleaseBucket(Stores, index, *Held);
+
+		*Held = Stores[index].Tables[Table].Bucket;
+		AcquireBucket(Stores, index, *Held);
+	}
+}
+
+void ReleaseTable(TableStorestruct* Stores, unsigned char index, unsigned int* Held)
+{
+	if (*Held != NoBucket)
+		ReleaseBucket(Stores, index, *Held);
+
+	*Held = NoBucket;
+}
+
+// the place of the next table of the store, a new bucket is started if the last one is full or has another signature;
+// the bucket is held in *Held, grown by doubling while it is filled and marked as changed. The tables are only added
+// outside the parallel searches, so no other thread holds the bucket or reads the list of buckets
+unsigned char* NewTableSlot(TableStorestruct* Stores, unsigned char index, unsigned int Table, uint64_t Signature, unsigned int* Held)
+{
+	TableStorestruct*	Store = &Stores[index];
+	TableBucketstruct*	Bucket;
+	unsigned int		Capacity;
+
+	if ((Store->NumberOfBuckets == 0) ||
+		(Store->Buckets[Store->NumberOfBuckets - 1].NumberOfTables == TablesPerBucket) ||
+		(Store->Buckets[Store->NumberOfBuckets - 1].Signature != Signature))
+	{
+		// the bucket filled so far is shrunk to its tables
+		if (Store->NumberOfBuckets)
+		{
+			Bucket = &Store->Buckets[Store->NumberOfBuckets - 1];
+			if (Bucket->Bytes && (Bucket->Capacity > Bucket->NumberOfTables))
+			{
+				ChargeTables(-(long long)(Bucket->Capacity - Bucket->NumberOfTables) * TableSize);
+				Bucket->Capacity = Bucket->NumberOfTables;
+				Bucket->Bytes = (unsigned char*)realloc(Bucket->Bytes, (size_t)Bucket->Capacity * TableSize);
+				SetBucketPointers(Store, Bucket);
+			}
+		}
+
+		if (Store->NumberOfBuckets == Store->Capacity)
+		{
+			Store->Capacity *= 2;
+			Store->Buckets = (TableBucketstruct*)realloc(Store->Buckets, Store->Capacity * sizeof(TableBucketstruct));
+		}
+
+		Bucket = &Store->Buckets[Store->NumberOfBuckets++];
+		Bucket->Bytes = NULL;
+		Bucket->FirstTable = Table;
+		Bucket->NumberOfTables = 0;
+		Bucket->Capacity = 0;
+		Bucket->Signature = Signature;
+		Bucket->Users = 0;
+		Bucket->LastUse = 0;
+		Bucket->Older = NoBucket;
+		Bucket->Newer = NoBucket;
+		Bucket->FileOffset = -1;
+		Bucket->StoredTables = 0;
+		Bucket->Dirty = 0;
+	}
+
+	Bucket = &Store->Buckets[Store->NumberOfBuckets - 1];
+	Store->Tables[Table].Bucket = Store->NumberOfBuckets - 1;
+	AcquireTable(Stores, index, Table, Held);
+
+	if (Bucket->NumberOfTables == Bucket->Capacity)
+	{
+		Capacity = (2 * Bucket->Capacity < TablesPerBucket) ? 2 * Bucket->Capacity : TablesPerBucket;
+		MakeRoom(Stores, (long long)(Capacity - Bucket->Capacity) * TableSize);
+		ChargeTables((long long)(Capacity - Bucket->Capacity) * TableSize);
+		Bucket->Capacity = Capacity;
+		Bucket->Bytes = (unsigned char*)realloc(Bucket->Bytes, (size_t)Bucket->Capacity * TableSize);
+		SetBucketPointers(Store, Bucket);
+	}
+
+	Bucket->NumberOfTables++;
+	Bucket->Dirty = 1;
+
+	return(Bucket->Bytes + (size_t)(Table - Bucket->FirstTable) * TableSize);
+}
+
+//-----------------------------------------------------
+
+struct BitMatrixstruct
+{
+	uint64_t*		Bits;
+	size_t			WordsPerRow;
+	size_t			Size;
+	SpillFilestruct	Spill;
+};
+
+long long		CouplesMemoryUsed = 0;
+
+// a row never shares a word with the next one, so different rows can be filled independently
+BitMatrixstruct* NewBitMatrix(unsigned int NumberOfRows, unsigned int NumberOfColumns, unsigned char AllowSpill)
+{
+	BitMatrixstruct*	Matrix;
+
+	Matrix = (BitMatrixstruct*)malloc(sizeof(BitMatrixstruct));
+	Matrix->WordsPerRow = ((size_t)NumberOfColumns + 63) >> 6;
+	Matrix->Size = ((size_t)NumberOfRows * Matrix->WordsPerRow + 1) * sizeof(uint64_t);
+	Matrix->Spill.Name[0] = 0;
+
+	if ((CouplesMemoryUsed + (long long)Matrix->Size) <= CouplesMemoryBudget)
+	{
+		Matrix->Bits = (uint64_t*)calloc(Matrix->Size, 1);
+		CouplesMemoryUsed += Matrix->Size;
+		return(Matrix);
+	}
+
+	if (!AllowSpill)
+	{
+		free(Matrix);
+		return(NULL);
+	}
+
+	Matrix->Bits = (uint64_t*)MapSpillFile(&Matrix->Spill, CouplesSpillPath, Matrix->Size);
+
+	return(Matrix);
+}
+
+void FreeBitMatrix(BitMatrixstruct* Matrix)
+{
+	if (Matrix->Spill.Name[0])
+		UnmapSpillFile(&Matrix->Spill, Matrix->Bits, Matrix->Size);
+	else
+	{
+		free(Matrix->Bits);
+		CouplesMemoryUsed -= Matrix->Size;
+	}
+
+	free(Matrix);
+}
+
+void SetBit(BitMatrixstruct* Matrix, unsigned int Row, unsigned int Column)
+{
+	#pragma omp atomic
+	Matrix->Bits[(size_t)Row * Matrix->WordsPerRow + (Column >> 6)] |= ((uint64_t)1) << (Column & 63);
+}
+
+unsigned char GetBit(BitMatrixstruct* Matrix, unsigned int Row, unsigned int Column)
+{
+	return((Matrix->Bits[(size_t)Row * Matrix->WordsPerRow + (Column >> 6)] >> (Column & 63)) & 1);
+}
+
+//-----------------------------------------------------
+
+struct PairVerdictstruct
+{
+	BitMatrixstruct*	Checked;
+	BitMatrixstruct*	Compatible;
+};
+
+// verdicts are only kept if they fit into the memory budget, they are never spilled
+PairVerdictstruct* NewPairVerdict(unsigned int NumberOfRows, unsigned int NumberOfColumns)
+{
+	PairVerdictstruct*	Verdict;
+
+	Verdict = (PairVerdictstruct*)malloc(sizeof(PairVerdictstruct));
+	Verdict->Checked = NewBitMatrix(NumberOfRows, NumberOfColumns, 0);
+	Verdict->Compatible = Verdict->Checked ? NewBitMatrix(NumberOfRows, NumberOfColumns, 0) : NULL;
+
+	if (Verdict->Compatible == NULL)
+	{
+		if (Verdict->Checked)
+			FreeBitMatrix(Verdict->Checked);
+		free(Verdict);
+		return(NULL);
+	}
+
+	return(Verdict);
+}
+
+void FreePairVerdict(PairVerdictstruct* Verdict)
+{
+	FreeBitMatrix(Verdict->Checked);
+	FreeBitMatrix(Verdict->Compatible);
+	free(Verdict);
+}
+
+void SetPairVerdict(PairVerdictstruct* Verdict, unsigned int Row, unsigned int Column, unsigned char Compatible)
+{
+	SetBit(Verdict->Checked, Row, Column);
+
+	if (Compatible)
+		SetBit(Verdict->Compatible, Row, Column);
+}
+
+// 0: compatible, 1: not compatible, 2: never checked
+unsigned char GetPairVerdict(PairVerdictstruct* Verdict, unsigned int Row, unsigned int Column)
+{
+	if (!GetBit(Verdict->Checked, Row, Column))
+		return(2);
+
+	return(GetBit(Verdict->Compatible, Row, Column) ? 0 : 1);
+}
+
+// the verdict of a couple is symmetric, it is stored only once for (Bit0,Bit1) or (Bit1,Bit0)
+unsigned char LookupPairVerdict(PairVerdictstruct* PairVerdicts[NumberOfOutputBits][NumberOfOutputBits],
+	unsigned char Bit0, unsigned int Index0, unsigned char Bit1, unsigned int Index1)
+{
+	if (PairVerdicts[Bit0][Bit1])
+		return(GetPairVerdict(PairVerdicts[Bit0][Bit1], Index0, Index1));
+
+	if (PairVerdicts[Bit1][Bit0])
+		return(GetPairVerdict(PairVerdicts[Bit1][Bit0], Index1, Index0));
+
+	return(2);
+}
+
+// the bit of two buckets is set by the reduction if a couple of their tables is compatible or was not checked, a couple
+// of buckets without it is never loaded; like the verdicts it is stored once, all couples are possible without reduction
+unsigned char BucketPairPossible(BitMatrixstruct* BucketPairs[NumberOfOutputBits][NumberOfOutputBits],
+	unsigned char Bit0, unsigned int Bucket0, unsigned char Bit1, unsigned int Bucket1)
+{
+	if (BucketPairs[Bit0][Bit1])
+		return(GetBit(BucketPairs[Bit0][Bit1], Bucket0, Bucket1));
+
+	if (BucketPairs[Bit1][Bit0])
+		return(GetBit(BucketPairs[Bit1][Bit0], Bucket1, Bucket0));
+
+	return(1);
+}
+
+
+//-----------------------------------------------------
+
+double	PairCheckTime = 1e-4; // seconds to check one couple, measured by SampleCompatibility
+
+// fraction of compatible couples among NumberOfPlanSamples random couples of two sets of tables
+// (all couples if there are fewer) of the output bits Bit0 and Bit1, Index0/Index1 map to UniqueTables if not NULL
+double SampleCompatibility(TableStorestruct* Stores, unsigned char Bit0, unsigned int* Index0, unsigned int Number0,
+	unsigned char Bit1, unsigned int* Index1, unsigned int Number1,
+	unsigned short*** UniformityCounter, unsigned short*** Dis, unsigned short*** DisOld)
+{
+	UniqueTablestruct*	Tables0 = Stores[Bit0].Tables;
+	UniqueTablestruct*	Tables1 = Stores[Bit1].Tables;
+	int					Sample;
+	unsigned int		NumberOfSamples;
+	unsigned int		NumberOfCompatible;
+	unsigned int		i0, i1;
+	uint64_t			Random;
+	int					ThreadNum;
+	unsigned char*		TablesAddress[NumberOfOutputBits];
+	unsigned char**		FullTablesAddress[NumberOfOutputBits];
+	unsigned char**		SmallTablesAddress[NumberOfOutputBits];
+	double				StartTime;
+
+	if ((Number0 == 0) || (Number1 == 0))
+		return(0);
+
+	if (((uint64_t)Number0 * Number1) <= NumberOfPlanSamples)
+		NumberOfSamples = Number0 * Number1;
+	else
+		NumberOfSamples = NumberOfPlanSamples;
+
+	NumberOfCompatible = 0;
+	StartTime = omp_get_wtime();
+
+	#pragma omp parallel for schedule(dynamic) private(ThreadNum, i0, i1, Random, TablesAddress, FullTablesAddress, SmallTablesAddress) reduction(+:NumberOfCompatible)
+	for (Sample = 0; Sample < (int)NumberOfSamples; Sample++)
+	{
+		ThreadNum = omp_get_thread_num();
+
+		if (NumberOfSamples == Number0 * Number1)
+		{
+			i0 = Sample / Number1;
+			i1 = Sample % Number1;
+		}
+		else
+		{
+			Random = (Sample + 1) * 0x9E3779B97F4A7C15ULL;
+			Random = (Random ^ (Random >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			Random = (Random ^ (Random >> 27)) * 0x94D049BB133111EBULL;
+			Random ^= Random >> 31;
+
+			i0 = (Random >> 32) % Number0;
+			i1 = (Random & 0xFFFFFFFF) % Number1;
+		}
+
+		if (Index0)
+			i0 = Index0[i0];
+		if (Index1)
+			i1 = Index1[i1];
+
+		AcquireBucket(Stores, Bit0, Tables0[i0].Bucket);
+		AcquireBucket(Stores, Bit1, Tables1[i1].Bucket);
+
+		TablesAddress[0] = Tables0[i0].Table;
+		FullTablesAddress[0] = Tables0[i0].FullTable;
+		SmallTablesAddress[0] = Tables0[i0].SmallTable;
+
+		TablesAddress[1] = Tables1[i1].Table;
+		FullTablesAddress[1] = Tables1[i1].FullTable;
+		SmallTablesAddress[1] = Tables1[i1].SmallTable;
+
+		if (!CheckDistributions<2>(FullTablesAddress, SmallTablesAddress, Dis[ThreadNum], DisOld[ThreadNum]))
+			if (!CheckUniformity(TablesAddress, 2, UniformityCounter[ThreadNum]))
+				NumberOfCompatible++;
+
+		ReleaseBucket(Stores, Bit0, Tables0[i0].Bucket);
+		ReleaseBucket(Stores, Bit1, Tables1[i1].Bucket);
+	}
+
+	PairCheckTime = (omp_get_wtime() - StartTime) * omp_get_max_threads() / NumberOfSamples;
+
+	if (NumberOfSamples == Number0 * Number1)
+		return((double)NumberOfCompatible / NumberOfSamples);
+
+	return((NumberOfCompatible + 1.0) / (NumberOfSamples + 2.0));
+}
+
+// expected time of the final search if the tables are visited in Order (Order[NumberOfOutputBits - 1] outermost),
+// every visited table is either tested by lookups in CouplesPossible or rejected by one full check
+double EstimateSearchCost(unsigned char Order[NumberOfOutputBits], double Size[NumberOfOutputBits],
+	double Rate[NumberOfOutputBits][NumberOfOutputBits], unsigned char Couples)
+{
+	double			Nodes = 1;
+	double			Cost = 0;
+	unsigned char	index, index2;
+
+	// the table at position index - 1 is placed under the ones above it
+	for (index = NumberOfOutputBits; index > 0; index--)
+	{
+		Nodes *= Size[Order[index - 1]];
+		Cost += Nodes * (Couples ? (CoupleLookupTime * (NumberOfOutputBits - index)) : PairCheckTime);
+
+		for (index2 = NumberOfOutputBits - 1; index2 >= index; index2--)
+			Nodes *= Rate[Order[index - 1]][Order[index2]];
+	}
+
+	return(Cost + Nodes * PairCheckTime * (NumberOfOutputBits - 1));
+}
+
+// the cheapest order over all permutations of the output bits
+double ChooseTablesOrder(double Size[NumberOfOutputBits], double Rate[NumberOfOutputBits][NumberOfOutputBits],
+	unsigned char Couples, unsigned char TablesOrder[NumberOfOutputBits])
+{
+	unsigned char	Order[NumberOfOutputBits + 1] = { 0 };
+	unsigned char	Used;
+	double			Cost;
+	double			BestCost = -1;
+	unsigned char	index;
+
+	while (!Order[NumberOfOutputBits])
+	{
+		Used = 0;
+		for (index = 0; index < NumberOfOutputBits; index++)
+			Used |= 1 << Order[index];
+
+		if (Used == (1 << NumberOfOutputBits) - 1)
+		{
+			Cost = EstimateSearchCost(Order, Size, Rate, Couples);
+			if ((BestCost < 0) || (Cost < BestCost))
+			{
+				BestCost = Cost;
+				memcpy(TablesOrder, Order, NumberOfOutputBits);
+			}
+		}
+
+		index = 0;
+		do
+		{
+			Order[index]++;
+			if (index < NumberOfOutputBits)
+				if (Order[index] >= NumberOfOutputBits)
+					Order[index] = 0;
+		} while (Order[index++] == 0);
+	}
+
+	return(BestCost);
+}
+
+
+//-----------------------------------------------------
+
+typedef struct WorkRangestruct {
+	long long	Begin;
+	long long	End;
+	omp_lock_t	Lock;
+} WorkRangestruct;
+
+// a range is only changed under its lock, but the other threads look at its length without taking it,
+// so every write and every unlocked read is atomic
+long long RangeLength(WorkRangestruct* Range)
+{
+	long long	Begin;
+	long long	End;
+
+	#pragma omp atomic read
+	Begin = Range->Begin;
+	#pragma omp atomic read
+	End = Range->End;
+
+	return(End - Begin);
+}
+
+// the next work item of the thread, if its own range is empty the upper half of the largest remaining range is stolen
+unsigned char TakeWork(WorkRangestruct* WorkRanges, int ThreadNum, int NumberOfThreads, long long* Item)
+{
+	int			Victim;
+	int			Thread;
+	long long	Length;
+	long long	VictimLength;
+	long long	Mid;
+	long long	End;
+
+	while (1)
+	{
+		omp_set_lock(&WorkRanges[ThreadNum].Lock);
+		if (WorkRanges[ThreadNum].Begin < WorkRanges[ThreadNum].End)
+		{
+			*Item = WorkRanges[ThreadNum].Begin;
+			#pragma omp atomic write
+			WorkRanges[ThreadNum].Begin = *Item + 1;
+			omp_unset_lock(&WorkRanges[ThreadNum].Lock);
+			return(1);
+		}
+		omp_unset_lock(&WorkRanges[ThreadNum].Lock);
+
+		Victim = -1;
+		VictimLength = 0;
+		for (Thread = 0; Thread < NumberOfThreads; Thread++)
+		{
+			Length = RangeLength(&WorkRanges[Thread]);
+			if (Length > VictimLength)
+			{
+				Victim = Thread;
+				VictimLength = Length;
+			}
+		}
+
+		if (Victim < 0)
+			return(0);
+
+		omp_set_lock(&WorkRanges[Victim].Lock);
+		Mid = WorkRanges[Victim].Begin + (WorkRanges[Victim].End - WorkRanges[Victim].Begin) / 2;
+		End = WorkRanges[Victim].End;
+		if (Mid < End)
+		{
+			#pragma omp atomic write
+			WorkRanges[Victim].End = Mid;
+		}
+		omp_unset_lock(&WorkRanges[Victim].Lock);
+
+		if (Mid < End)
+		{
+			omp_set_lock(&WorkRanges[ThreadNum].Lock);
+			#pragma omp atomic write
+			WorkRanges[ThreadNum].Begin = Mid;
+			#pragma omp atomic write
+			WorkRanges[ThreadNum].End = End;
+			omp_unset_lock(&WorkRanges[ThreadNum].Lock);
+		}
+	}
+}
+
+
+//-----------------------------------------------------
+
+// unsigned 128-bit counter, least significant limb first
+struct Countstruct
+{
+	uint32_t	Limb[4];
+};
+
+struct ANFCountstruct
+{
+	uint64_t	ANF;
+	Countstruct	Count;
+};
+
+void AddCount(Countstruct* Sum, Countstruct* Value)
+{
+	uint64_t	Carry = 0;
+	unsigned char	l;
+
+	for (l = 0; l < 4; l++)
+	{
+		Carry += (uint64_t)Sum->Limb[l] + Value->Limb[l];
+		Sum->Limb[l] = (uint32_t)Carry;
+		Carry >>= 32;
+	}
+}
+
+void MultiplyCount(Countstruct* Value, uint32_t Factor)
+{
+	uint64_t	Carry = 0;
+	unsigned char	l;
+
+	for (l = 0; l < 4; l++)
+	{
+		Carry += (uint64_t)Value->Limb[l] * Factor;
+		Value->Limb[l] = (uint32_t)Carry;
+		Carry >>= 32;
+	}
+}
+
+unsigned char IsZeroCount(Countstruct* Value)
+{
+	return(!(Value->Limb[0] | Value->Limb[1] | Value->Limb[2] | Value->Limb[3]));
+}
+
+void PrintCount(FILE* F, Countstruct Value)
+{
+	char		Digits[40];
+	int			NumberOfDigits = 0;
+	uint64_t	Remainder;
+	unsigned char	l;
+
+	do
+	{
+		Remainder = 0;
+		for (l = 4; l > 0; l--)
+		{
+			Remainder = (Remainder << 32) | Value.Limb[l - 1];
+			Value.Limb[l - 1] = (uint32_t)(Remainder / 10);
+			Remainder %= 10;
+		}
+
+		Digits[NumberOfDigits++] = '0' + (char)Remainder;
+	} while (!IsZeroCount(&Value));
+
+	while (NumberOfDigits)
+		fputc(Digits[--NumberOfDigits], F);
+}
+
+int CompareANFCount(const void* a, const void* b)
+{
+	if (((ANFCountstruct*)a)->ANF < ((ANFCountstruct*)b)->ANF)
+		return(-1);
+
+	return(((ANFCountstruct*)a)->ANF > ((ANFCountstruct*)b)->ANF);
+}
+
+
+//-----------------------------------------------------
+
+// the share variables as written in the component strings, in the order of Value in ReadTable
+const char	VarStr[12][4] = { "a2","b2","c2","d2", "a1","b1","c1","e1", "a3","b3","c3","d3" };
+
+// the next component string of a row, up to its comma
+char* ReadRowString(FILE* F, char* TempStr)
+{
+	char	TempChar;
+	char*	String;
+	int		l;
+
+	l = 0;
+	do
+	{
+		TempChar = fgetc(F);
+		if (TempChar != '\n')
+			TempStr[l++] = TempChar;
+	} while (TempChar != ',');
+
+	TempStr[l] = 0;
+	String = (char*)malloc((l + 1) * sizeof(char));
+	strcpy(String, TempStr);
+
+	return(String);
+}
+
+// the 18 component strings of the row of Res_x.csv at the position of F, its ANFs and tables are skipped
+void ReadRowStrings(FILE* F, char* TempStr, char* RowStrings[18])
+{
+	unsigned int	k;
+
+	fscanf(F, "%s", TempStr); // Type
+	for (k = 0; k < 18; k++)
+	{
+		if ((k % 6) == 0)
+			fscanf(F, "%s", TempStr); // ANF
+
+		RowStrings[k] = ReadRowString(F, TempStr);
+
+		if ((k % 6) == 5)
+			fscanf(F, "%s", TempStr); // table
+	}
+}
+
+void FreeRowStrings(char* RowStrings[18])
+{
+	unsigned int	k;
+
+	for (k = 0; k < 18; k++)
+		free(RowStrings[k]);
+}
+
+// the rows are only kept as their position in Res_x.csv, their strings are read again for every combination found
+void PrintRowStrings(FILE* FOut, FILE* F, long long Offset, char* TempStr)
+{
+	char*			RowStrings[18];
+	unsigned int	k;
+
+	fseek64(F, Offset, SEEK_SET);
+	ReadRowStrings(F, TempStr, RowStrings);
+
+	for (k = 0; k < 18; k++)
+		fprintf(FOut, "%s ", RowStrings[k]);
+
+	FreeRowStrings(RowStrings);
+}
+
+struct RowOrderstruct
+{
+	uint64_t		Signature;
+	unsigned int	Row;
+};
+
+int CompareRowOrder(const void* a, const void* b)
+{
+	if (((RowOrderstruct*)a)->Signature != ((RowOrderstruct*)b)->Signature)
+		return((((RowOrderstruct*)a)->Signature < ((RowOrderstruct*)b)->Signature) ? -1 : 1);
+
+	return((((RowOrderstruct*)a)->Row > ((RowOrderstruct*)b)->Row) - (((RowOrderstruct*)a)->Row < ((RowOrderstruct*)b)->Row));
+}
+
+// the variables every component function of a row depends on, the SmallTables of rows with the same signature are
+// equal, so a bucket of them is mostly checked against the same other buckets
+uint64_t RowSignature(char* RowStrings[18])
+{
+	uint64_t		Signature;
+	unsigned short	Dependencies;
+	unsigned int	k, l;
+
+	Signature = 0;
+	for (k = 1; k < 18; k += 2)
+	{
+		Dependencies = 0;
+		for (l = 0; l < 12; l++)
+			if (strstr(RowStrings[k], VarStr[l]) != NULL)
+				Dependencies |= 1 << l;
+
+		Signature = (Signature ^ Dependencies) * 0x100000001B3ULL;
+	}
+
+	return(Signature);
+}
+
+// reads the row of Res_x.csv at the position of F (row j) into UniqueTable, its 13 tables are written to TableBytes
+// and its 18 component strings are returned in RowStrings
+void ReadTable(FILE* F, char* TempStr, unsigned int j, UniqueTablestruct* UniqueTable, unsigned char* TableBytes, char* RowStrings[18])
+{
+	unsigned int		Type;
+	uint64_t			ANF;
+	unsigned int		k, l;
+	unsigned char		Dependency[3];
+	unsigned char		NumberOfDependencies;
+	short				abcd;
+	short				a1b1c1d1;
+	short				a2b2c2d2;
+	short				a3b3c3d3;
+	short				Value[12];
+	short				InputIndex;
+
+	fscanf(F, "%s", TempStr);
+	TempStr[strlen(TempStr) - 1] = 0;
+	//Type = atoi(TempStr);
+	Type = 0;
+
+	fscanf(F, "%s", TempStr);
+	TempStr[strlen(TempStr) - 1] = 0;
+	sscanf(TempStr, "%" SCNu64 , &ANF);
+
+	for (k = 0; k < 6; k++)
+		RowStrings[k] = ReadRowString(F, TempStr);
+
+	fscanf(F, "%s", TempStr);
+	if (1) //(ANF != ANF_old)
+	{
+		UniqueTable->StartIndex = j;
+		UniqueTable->Count = 1;
+		UniqueTable->Type = Type;
+		UniqueTable->ANF = ANF;
+		SetTablePointers(UniqueTable, TableBytes);
+
+		for (k = 0; k < (1 << 12); k++)
+		{
+			UniqueTable->FullTable[0][k] = (TempStr[k] <= '9') ? (TempStr[k] - '0') : (TempStr[k] - 'a' + 10);
+			UniqueTable->Table[k] = Unmasking[UniqueTable->FullTable[0][k]];
+		}
+
+		//****************************//
+
+		for (k = 0;k < 3;k++)
+		{
+			NumberOfDependencies = 0;
+			for (l = 0;l < 12;l++)
+				if (strstr(RowStrings[k * 2 + 1], VarStr[l]) != NULL)
+					Dependency[NumberOfDependencies++] = l;
+
+			InputIndex = 0;
+			for (abcd = 0; abcd < 16; abcd++)
+				for (a1b1c1d1 = 0; a1b1c1d1 < 16; a1b1c1d1++)
+					for (a2b2c2d2 = 0; a2b2c2d2 < 16; a2b2c2d2++)
+					{
+						a3b3c3d3 = abcd ^ a1b1c1d1 ^ a2b2c2d2;
+						for (l = 0; l < 4; l++)
+						{
+							Value[l + 0] = (a2b2c2d2 >> l) & 1;
+							Value[l + 4] = (a1b1c1d1 >> l) & 1;
+							Value[l + 8] = (a3b3c3d3 >> l) & 1;
+						}
+
+						UniqueTable->SmallTable[k][InputIndex] = 0;
+						for (l = 0;l < NumberOfDependencies;l++)
+							UniqueTable->SmallTable[k][InputIndex] |= Value[Dependency[l]] << l;
+
+						InputIndex++;
+					}
+		}
+	}
+	else
+		UniqueTable->Count++;
+
+	fscanf(F, "%s", TempStr); // skip the second ANF
+
+	for (k = 6; k < 12; k++)
+		RowStrings[k] = ReadRowString(F, TempStr);
+
+	fscanf(F, "%s", TempStr);
+	if (1) //ANF != ANF_old)
+	{
+		for (k = 0; k < (1 << 12); k++)
+		{
+			UniqueTable->FullTable[1][k] = (TempStr[k] <= '9') ? (TempStr[k] - '0') : (TempStr[k] - 'a' + 10);
+			UniqueTable->Table[k] |= Unmasking[UniqueTable->FullTable[1][k]] << 1;
+		}
+
+		//****************************//
+
+		for (k = 0;k < 3;k++)
+		{
+			NumberOfDependencies = 0;
+			for (l = 0;l < 12;l++)
+				if (strstr(RowStrings[k * 2 + 7], VarStr[l]) != NULL)
+					Dependency[NumberOfDependencies++] = l;
+
+			InputIndex = 0;
+			for (abcd = 0; abcd < 16; abcd++)
+				for (a1b1c1d1 = 0; a1b1c1d1 < 16; a1b1c1d1++)
+					for (a2b2c2d2 = 0; a2b2c2d2 < 16; a2b2c2d2++)
+					{
+						a3b3c3d3 = abcd ^ a1b1c1d1 ^ a2b2c2d2;
+						for (l = 0;l < 4;l++)
+						{
+							Value[l + 0] = (a2b2c2d2 >> l) & 1;
+							Value[l + 4] = (a1b1c1d1 >> l) & 1;
+							Value[l + 8] = (a3b3c3d3 >> l) & 1;
+						}
+
+						UniqueTable->SmallTable[3 + k][InputIndex] = 0;
+						for (l = 0;l < NumberOfDependencies;l++)
+							UniqueTable->SmallTable[3 + k][InputIndex] |= Value[Dependency[l]] << l;
+
+						InputIndex++;
+					}
+		}
+	}
+
+	fscanf(F, "%s", TempStr); // skip the third ANF
+
+	for (k = 12; k < 18; k++)
+		RowStrings[k] = ReadRowString(F, TempStr);
+
+	fscanf(F, "%s", TempStr);
+	if (1) //ANF != ANF_old)
+	{
+		for (k = 0; k < (1 << 12); k++)
+		{
+			UniqueTable->FullTable[2][k] = (TempStr[k] <= '9') ? (TempStr[k] - '0') : (TempStr[k] - 'a' + 10);
+			UniqueTable->Table[k] |= Unmasking[UniqueTable->FullTable[2][k]] << 2;
+		}
+
+		//****************************//
+
+		for (k = 0;k < 3;k++)
+		{
+			NumberOfDependencies = 0;
+			for (l = 0;l < 12;l++)
+				if (strstr(RowStrings[k * 2 + 13], VarStr[l]) != NULL)
+					Dependency[NumberOfDependencies++] = l;
+
+			InputIndex = 0;
+			for (abcd = 0; abcd < 16; abcd++)
+				for (a1b1c1d1 = 0; a1b1c1d1 < 16; a1b1c1d1++)
+					for (a2b2c2d2 = 0; a2b2c2d2 < 16; a2b2c2d2++)
+					{
+						a3b3c3d3 = abcd ^ a1b1c1d1 ^ a2b2c2d2;
+						for (l = 0; l < 4; l++)
+						{
+							Value[l + 0] = (a2b2c2d2 >> l) & 1;
+							Value[l + 4] = (a1b1c1d1 >> l) & 1;
+							Value[l + 8] = (a3b3c3d3 >> l) & 1;
+						}
+
+						UniqueTable->SmallTable[6 + k][InputIndex] = 0;
+						for (l = 0;l < NumberOfDependencies;l++)
+							UniqueTable->SmallTable[6 + k][InputIndex] |= Value[Dependency[l]] << l;
+
+						InputIndex++;
+					}
+		}
+	}
+}
+
+//-----------------------------------------------------
+
+// the coordinate searches signal every row they append to Res_x.csv (NotifyNewRow), through a FIFO or, on Windows,
+// a named event; a row appended while nothing waits is found by the next scan of the files
+#ifdef _WIN32
+const char	StreamName[100] = "Local\\Res_stream";
+HANDLE		StreamEvent;
+#else
+const char	StreamName[100] = "Res_stream.fifo";
+int			StreamFifo;
+int			StreamFifoWriter;	// keeps a writer on the FIFO, so that poll does not report a hang-up between two rows
+#endif
+
+void OpenStream()
+{
+#ifdef _WIN32
+	StreamEvent = CreateEventA(NULL, FALSE, FALSE, StreamName);
+#else
+	mkfifo(StreamName, 0600);
+	StreamFifo = open(StreamName, O_RDONLY | O_NONBLOCK);
+	StreamFifoWriter = open(StreamName, O_WRONLY | O_NONBLOCK);
+#endif
+}
+
+void CloseStream()
+{
+#ifdef _WIN32
+	if (StreamEvent != NULL)
+		CloseHandle(StreamEvent);
+#else
+	if (StreamFifo >= 0)
+		close(StreamFifo);
+	if (StreamFifoWriter >= 0)
+		close(StreamFifoWriter);
+	unlink(StreamName);
+#endif
+}
+
+// waits until a coordinate search appends a row or Seconds have passed
+void WaitForNewRow(double Seconds)
+{
+#ifdef _WIN32
+	if (StreamEvent != NULL)
+		WaitForSingleObject(StreamEvent, (DWORD)(Seconds * 1000));
+	else
+		Sleep(1000);
+#else
+	struct pollfd	Poll;
+	char			Signals[256];
+
+	if (StreamFifo < 0)
+	{
+		sleep(1);
+		return;
+	}
+
+	Poll.fd = StreamFifo;
+	Poll.events = POLLIN;
+	if (poll(&Poll, 1, (int)(Seconds * 1000)) > 0)
+		while (read(StreamFifo, Signals, sizeof(Signals)) > 0);
+#endif
+}
+
+// every row is combined with the rows of the other output bits read before it, so every combination is found
+// once, when the last of its rows is appended by the coordinate search
+int StreamCombinations()
+{
+	FILE*				F;
+	FILE*				FOut;
+	FILE*				FRow;
+	char				FilePath[500];
+	char				OutFilePath[500];
+	char				RowFilePath[500];
+	char*				TempStr;
+	UniqueTablestruct*	UniqueTables[NumberOfOutputBits];
+	unsigned int		NumberOfUniqueTables[NumberOfOutputBits];
+	unsigned int		NumberOfRows[NumberOfOutputBits];
+	unsigned int		Capacity[NumberOfOutputBits];
+	long				Offset[NumberOfOutputBits];
+	long				Next;
+	long long*			RowOffsets[NumberOfOutputBits];
+	char*				RowStrings[18];
+	TableStorestruct	Stores[NumberOfOutputBits];
+	unsigned int		Held[NumberOfOutputBits];
+	unsigned int		Filling;
+	unsigned char*		TableBytes;
+	unsigned char		Order[NumberOfOutputBits];
+	unsigned char		OrderInv[NumberOfOutputBits];
+	unsigned int		Number[NumberOfOutputBits];
+	unsigned int		Position[NumberOfOutputBits];
+	unsigned int		NewTable;
+	int					First;
+	int					TempChar;
+	unsigned char		Empty;
+	unsigned int		NewRows;
+	double				LastNewRow;
+	long long			NumberOfFound;
+	unsigned char		p;
+	unsigned char		index;
+	unsigned char		index2;
+	int					j;
+	unsigned int		k;
+	unsigned char		Res;
+	int					ThreadNum;
+	unsigned char*		TablesAddress[NumberOfOutputBits];
+	unsigned char**		FullTablesAddress[NumberOfOutputBits];
+	unsigned char**		SmallTablesAddress[NumberOfOutputBits];
+	unsigned short***	UniformityCounter;
+	unsigned short***	Dis;
+	unsigned short***	DisOld;
+
+	TempStr = (char*)malloc(100000 * sizeof(char));
+
+	for (index = 0; index < NumberOfOutputBits; index++)
+	{
+		Capacity[index] = TablesPerBucket;
+		NumberOfRows[index] = 0;
+		NumberOfUniqueTables[index] = 0;
+		Offset[index] = 0;
+
+		UniqueTables[index] = (UniqueTablestruct*)malloc(Capacity[index] * sizeof(UniqueTablestruct));
+		RowOffsets[index] = (long long*)malloc(Capacity[index] * sizeof(long long));
+
+		InitTableStore(&Stores[index], index);
+		Stores[index].Tables = UniqueTables[index];
+	}
+
+	omp_set_num_threads(NumberOfCPUs);
+	UniformityCounter = (unsigned short***)malloc(omp_get_max_threads() * sizeof(unsigned short**));
+	Dis = (unsigned short***)malloc(omp_get_max_threads() * sizeof(unsigned short**));
+	DisOld = (unsigned short***)malloc(omp_get_max_threads() * sizeof(unsigned short**));
+
+	for (j = 0;j < omp_get_max_threads();j++)
+	{
+		UniformityCounter[j] = (unsigned short**)malloc((NumberOfOutputBits - 1) * sizeof(unsigned short*));
+		Dis[j] = (unsigned short**)malloc(MaxNumberOfProbes * sizeof(unsigned short*));
+		DisOld[j] = (unsigned short**)malloc(MaxNumberOfProbes * sizeof(unsigned short*));
+
+		for (index = 0; index < NumberOfOutputBits - 1; index++)
+			UniformityCounter[j][index] = (unsigned short*)calloc((1 << (3 * (index + 2))), sizeof(unsigned short));
+
+		for (k = 0; k < MaxNumberOfProbes; k++)
+		{
+			Dis[j][k] = (unsigned short*)malloc(128 * sizeof(unsigned short));
+			DisOld[j][k] = (unsigned short*)malloc(128 * sizeof(unsigned short));
+		}
+	}
+
+	strcpy(OutFilePath, path);
+	for (index = 0; index < NumberOfOutputBits; index++)
+		sprintf(OutFilePath, "%s%d", OutFilePath, Bits[index]);
+
+	strcat(OutFilePath, ".csv");
+	FOut = fopen(OutFilePath, "wt");
+	fclose(FOut);
+
+	OpenStream();
+
+	NumberOfFound = 0;
+	LastNewRow = omp_get_wtime();
+	while (1)
+	{
+		NewRows = 0;
+		for (index = 0; index < NumberOfOutputBits; index++)
+		{
+			sprintf(FilePath, "%s%d.csv", path, Bits[index]);
+			F = fopen(FilePath, "rt");
+			if (F == NULL)
+				continue;
+
+			fseek(F, Offset[index], SEEK_SET);
+			while (1)
+			{
+				// a row is only read once the coordinate search has written all of it
+				Empty = 1;
+				do
+				{
+					TempChar = fgetc(F);
+					if ((TempChar != EOF) && (TempChar != ' ') && (TempChar != '\n') && (TempChar != '\r'))
+						Empty = 0;
+				} while ((TempChar != '\n') && (TempChar != EOF));
+
+				if (TempChar == EOF)
+					break;
+
+				Next = ftell(F);
+				if (!Empty)
+				{
+					if (NumberOfRows[index] == Capacity[index])
+					{
+						Capacity[index] *= 2;
+						UniqueTables[index] = (UniqueTablestruct*)realloc(UniqueTables[index], Capacity[index] * sizeof(UniqueTablestruct));
+						RowOffsets[index] = (long long*)realloc(RowOffsets[index], Capacity[index] * sizeof(long long));
+						Stores[index].Tables = UniqueTables[index];
+					}
+
+					// the rows arrive one by one, so they are bucketed in their order and not by their signatures
+					fseek(F, Offset[index], SEEK_SET);
+					RowOffsets[index][NumberOfRows[index]] = Offset[index];
+					Filling = NoBucket;
+					TableBytes = NewTableSlot(Stores, index, NumberOfUniqueTables[index], 0, &Filling);
+					ReadTable(F, TempStr, NumberOfRows[index], &UniqueTables[index][NumberOfUniqueTables[index]], TableBytes, RowStrings);
+					FreeRowStrings(RowStrings);
+					ReleaseTable(Stores, index, &Filling);
+					NumberOfUniqueTables[index]++;
+					NumberOfRows[index]++;
+					NewRows++;
+
+					// the new table is the outermost one, the other output bits follow in their order
+					NewTable = NumberOfUniqueTables[index] - 1;
+					Order[0] = index;
+					for (index2 = 0, p = 1; index2 < NumberOfOutputBits; index2++)
+						if (index2 != index)
+							Order[p++] = index2;
+
+					for (p = 0; p < NumberOfOutputBits; p++)
+					{
+						OrderInv[Order[p]] = p;
+						Number[p] = NumberOfUniqueTables[Order[p]];
+					}
+
+					for (p = 1; p < NumberOfOutputBits; p++)
+						if (Number[p] == 0)
+							break;
+
+					if (p == NumberOfOutputBits)
+					{
+						#pragma omp parallel for schedule(dynamic) private(ThreadNum, p, Position, Held, Res, TablesAddress, FullTablesAddress, SmallTablesAddress)
+						for (First = 0; First < (int)Number[1]; First++)
+						{
+							ThreadNum = omp_get_thread_num();
+							for (p = 0; p < NumberOfOutputBits; p++)
+								Held[p] = NoBucket;
+
+							Position[0] = NewTable;
+							Position[1] = First;
+							for (p = 2; p < NumberOfOutputBits; p++)
+								Position[p] = 0;
+
+							for (p = 0; p < 2; p++)
+							{
+								AcquireTable(Stores, Order[p], Position[p], &Held[p]);
+								TablesAddress[p] = UniqueTables[Order[p]][Position[p]].Table;
+								FullTablesAddress[p] = UniqueTables[Order[p]][Position[p]].FullTable;
+								SmallTablesAddress[p] = UniqueTables[Order[p]][Position[p]].SmallTable;
+							}
+
+							// p is the deepest position placed so far, the positions above it are compatible
+							p = 1;
+							while (p >= 1)
+							{
+								Res = CheckDistributions(FullTablesAddress, SmallTablesAddress, p + 1, Dis[ThreadNum], DisOld[ThreadNum]);
+								if (!Res)
+									Res = CheckUniformity(TablesAddress, p + 1, UniformityCounter[ThreadNum]);
+
+								if ((!Res) && (p < NumberOfOutputBits - 1))
+								{
+									p++;
+									Position[p] = 0;
+								}
+								else
+								{
+									if (!Res)
+									{
+										#pragma omp critical (found)
+										{
+											NumberOfFound++;
+
+											FOut = fopen(OutFilePath, "at");
+											for (index2 = 0; index2 < NumberOfOutputBits; index2++)
+											{
+												sprintf(RowFilePath, "%s%d.csv", path, Bits[index2]);
+												FRow = fopen(RowFilePath, "rt");
+												PrintRowStrings(FOut, FRow, RowOffsets[index2][UniqueTables[index2][Position[OrderInv[index2]]].StartIndex], TempStr);
+												fclose(FRow);
+												fprintf(FOut, ", ");
+											}
+
+											fprintf(FOut, "\n");
+											fclose(FOut);
+										}
+									}
+									else
+										p = Res;
+
+									// the next table at position p, or at the position above it if none is left
+									Position[p]++;
+									while ((p >= 2) && (Position[p] >= Number[p]))
+									{
+										p--;
+										Position[p]++;
+									}
+
+									if (p < 2)
+										break;
+								}
+
+								AcquireTable(Stores, Order[p], Position[p], &Held[p]);
+								TablesAddress[p] = UniqueTables[Order[p]][Position[p]].Table;
+								FullTablesAddress[p] = UniqueTables[Order[p]][Position[p]].FullTable;
+								SmallTablesAddress[p] = UniqueTables[Order[p]][Position[p]].SmallTable;
+							}
+
+							for (p = 0; p < NumberOfOutputBits; p++)
+								ReleaseTable(Stores, Order[p], &Held[p]);
+						}
+					}
+				}
+
+				Offset[index] = Next;
+				fseek(F, Next, SEEK_SET);
+			}
+
+			fclose(F);
+		}
+
+		if (NewRows)
+		{
+			LastNewRow = omp_get_wtime();
+
+			printf("rows");
+			for (index = 0; index < NumberOfOutputBits; index++)
+				printf(" %d", NumberOfRows[index]);
+			printf(", found %" PRId64 "\n", (int64_t)NumberOfFound);
+		}
+		else if ((omp_get_wtime() - LastNewRow) < StreamIdleTimeout)
+			WaitForNewRow(StreamIdleTimeout - (omp_get_wtime() - LastNewRow));
+		else
+			break;
+	}
+
+	CloseStream();
+	printf("Total found %" PRId64 "\n\n", (int64_t)NumberOfFound);
+
+	for (index = 0; index < NumberOfOutputBits; index++)
+	{
+		FreeTableStore(&Stores[index]);
+		free(UniqueTables[index]);
+		free(RowOffsets[index]);
+	}
+
+	return 0;
+}
+
+int main()
+{
+	FILE*				F;
+	char				FilePath[500];
+	char*				TempStr;
+	UniqueTablestruct  *UniqueTables[NumberOfOutputBits];
+	unsigned int		NumberOfUniqueTables[NumberOfOutputBits];
+	TableStorestruct	Stores[NumberOfOutputBits];
+	long long*			RowOffsets[NumberOfOutputBits];
+	FILE*				RowFiles[NumberOfOutputBits];
+	char*				RowStrings[18];
+	RowOrderstruct*		RowOrder;
+	unsigned int		NumberOfSignatures;
+	unsigned int		NumberOfRareSignatures;
+	unsigned int		SignatureEnd;
+	unsigned int		Filling;
+	unsigned int		Held[NumberOfOutputBits];
+	unsigned char*		TableBytes;
+	unsigned int		NumberOfTables[NumberOfOutputBits];
+	unsigned char*		Flags[NumberOfOutputBits];
+	unsigned char		OnPattern[NumberOfOutputBits];
+	unsigned char		OffPattern[NumberOfOutputBits];
+	unsigned int		NumberOfReducedTables[NumberOfOutputBits];
+	unsigned int*		ReducedTablesIndex[NumberOfOutputBits];
+	unsigned int*		ReducedBucketStart[NumberOfOutputBits];
+
+	unsigned int		TempSize[NumberOfOutputBits];
+	unsigned int		min;
+	unsigned int		max;
+	unsigned char		TablesOrder[NumberOfOutputBits];
+	unsigned char		TablesOrderInv[NumberOfOutputBits];
+	char				TempChar;
+	int					j;
+	unsigned int		k;
+	char				index;
+	char				index2;
+	unsigned char		Bit0;
+	unsigned char		Bit1;
+	long long			Item;
+	long long			NumberOfItems;
+	long long			PrintStep;
+	WorkRangestruct*	WorkRanges;
+	unsigned int		i[NumberOfOutputBits + 1];
+	int					i0;
+	int					i1;
+	unsigned char*		TablesAddress[NumberOfOutputBits];
+	unsigned char**		FullTablesAddress[NumberOfOutputBits];
+	unsigned char**		SmallTablesAddress[NumberOfOutputBits];
+	long long			NumberOfFound;
+	long long			Counter;
+	long long			Done;
+	unsigned char		SplitDepth;
+	Countstruct			TotalCount;
+	Countstruct*		RootCount;
+	Countstruct*		ANFCount[NumberOfOutputBits];
+	ANFCountstruct*		ANFHistogram;
+	unsigned int		NumberOfANFs;
+	char				Last;
+	unsigned char*		CheckBits;
+	unsigned char*		PairedBits;
+	unsigned char*		TilePaired;
+	unsigned char*		TileChecked;
+	unsigned char		CheckBit;
+	unsigned char		Flag1;
+	unsigned char		PairPossible;
+	int					Pair;
+	unsigned int		Bucket0;
+	unsigned int		Bucket1;
+	unsigned int		NumberOfBuckets0;
+	unsigned int		NumberOfBuckets1;
+	unsigned int		First0;
+	unsigned int		First1;
+	unsigned int		End0;
+	unsigned int		End1;
+	unsigned int		Tile0;
+	unsigned int		Tile1;
+	unsigned int		TileSize;
+	char				Res;
+	BitMatrixstruct*	CouplesPossible[NumberOfOutputBits][NumberOfOutputBits] = { NULL };
+	PairVerdictstruct*	PairVerdicts[NumberOfOutputBits][NumberOfOutputBits] = { NULL };
+	BitMatrixstruct*	BucketPairs[NumberOfOutputBits][NumberOfOutputBits] = { NULL };
+	long long			NumberOfReusedCouples;
+	double				PlanRate[NumberOfOutputBits][NumberOfOutputBits];
+	double				PlanSize[NumberOfOutputBits];
+	double				PlanReducedSize[NumberOfOutputBits];
+	double				PlanCost[2][2];
+	double				PlanReductionCost;
+	double				PlanCouplesCost;
+	unsigned char		PlanOrder[NumberOfOutputBits];
+	int					ThreadNum;
+	unsigned short***	UniformityCounter;
+	unsigned short***	Dis;
+	unsigned short***	DisOld;
 
 	FillTables();
+
+	if (Streaming)
+		return(StreamCombinations());
+
 	TempStr = (char*)malloc(100000 * sizeof(char));
 
-	for (index = 0; index < NumberOfOutputBits; index++)
+	for (Bit0 = 0; Bit0 < NumberOfOutputBits; Bit0++)
+		InitTableStore(&Stores[Bit0], Bit0);
+
+	for (Bit0 = 0; Bit0 < NumberOfOutputBits; Bit0++)
 	{
-		printf("getting size of table %d", index);
+		printf("getting size of table %d", Bit0);
 
-		sprintf(FilePath, "%s%d.csv", path, Bits[index]);
+		sprintf(FilePath, "%s%d.csv", path, Bits[Bit0]);
 		F = fopen(FilePath, "rt");
-		NumberOfTables[index] = 0;
+		NumberOfTables[Bit0] = 0;
 		Last = '\n';
 
 		while (!feof(F))
@@ -273,232 +1924,77 @@ int main()
 			{
 				TempChar = TempStr[k];
 				if (((TempChar == '\n') | (TempChar == '\r')) & (Last != '\n') & (Last != '\r'))
-					NumberOfTables[index]++;
+					NumberOfTables[Bit0]++;
 				Last = TempChar;
 			}
 		}
 
-		printf(": %d, reading", NumberOfTables[index]);
+		printf(": %d, reading", NumberOfTables[Bit0]);
 		fseek(F, 0, SEEK_SET);
 
-		UniqueTables[index] = (UniqueTablestruct*)malloc(NumberOfTables[index] * sizeof(UniqueTablestruct));
-		for (k = 0; k < 18; k++)
-			Strings[k][index] = (char**)malloc(NumberOfTables[index] * sizeof(char*));
-
-		ANF_old = 0;
-		NumberOfUniqueTables[index] = 0;
-		for (j = 0; j < NumberOfTables[index]; j++)
+		// the rows are stored sorted by their signatures, so that a bucket only holds rows with the same signature
+		RowOffsets[Bit0] = (long long*)malloc(NumberOfTables[Bit0] * sizeof(long long));
+		RowOrder = (RowOrderstruct*)malloc(NumberOfTables[Bit0] * sizeof(RowOrderstruct));
+		for (j = 0; j < NumberOfTables[Bit0]; j++)
 		{
-			fscanf(F, "%s", TempStr);
-			TempStr[strlen(TempStr) - 1] = 0;
-			//Type = atoi(TempStr);
-			Type = 0;
-
-			fscanf(F, "%s", TempStr);
-			TempStr[strlen(TempStr) - 1] = 0;
-			sscanf(TempStr, "%" SCNu64 , &ANF);
-
-			for (k = 0; k < 6; k++)
-			{
-				l = 0;
-				do
-				{
-					TempChar = fgetc(F);
-					if (TempChar != '\n')
-						TempStr[l++] = TempChar;
-				} while (TempChar != ',');
-
-				TempStr[l] = 0;
-				Strings[k][index][j] = (char*)malloc((l + 1) * sizeof(char));
-				strcpy(Strings[k][index][j], TempStr);
-			}
-
-			fscanf(F, "%s", TempStr);
-			if (1) //(ANF != ANF_old)
-			{
-				UniqueTables[index][NumberOfUniqueTables[index]].StartIndex = j;
-				UniqueTables[index][NumberOfUniqueTables[index]].Count = 1;
-				UniqueTables[index][NumberOfUniqueTables[index]].Type = Type;
-				UniqueTables[index][NumberOfUniqueTables[index]].Table = (unsigned char*)malloc((1 << 12) * sizeof(unsigned char));
-				UniqueTables[index][NumberOfUniqueTables[index]].FullTable[0] = (unsigned char*)malloc((1 << 12) * sizeof(unsigned char));
-
-				for (k = 0; k < (1 << 12); k++)
-				{
-					UniqueTables[index][NumberOfUniqueTables[index]].FullTable[0][k] = (TempStr[k] <= '9') ? (TempStr[k] - '0') : (TempStr[k] - 'a' + 10);
-					UniqueTables[index][NumberOfUniqueTables[index]].Table[k] = Unmasking[UniqueTables[index][NumberOfUniqueTables[index]].FullTable[0][k]];
-				}
-
-				//****************************//
-
-				for (k = 0;k < 3;k++)
-				{
-					UniqueTables[index][NumberOfUniqueTables[index]].SmallTable[k] = (unsigned char*)malloc((1 << 12) * sizeof(unsigned char));
-
-					NumberOfDependencies = 0;
-					for (l = 0;l < 12;l++)
-						if (strstr(Strings[k * 2 + 1][index][j], VarStr[l]) != NULL)
-							Dependency[NumberOfDependencies++] = l;
-
-					InputIndex = 0;
-					for (abcd = 0; abcd < 16; abcd++)
-						for (a1b1c1d1 = 0; a1b1c1d1 < 16; a1b1c1d1++)
-							for (a2b2c2d2 = 0; a2b2c2d2 < 16; a2b2c2d2++)
-							{
-								a3b3c3d3 = abcd ^ a1b1c1d1 ^ a2b2c2d2;
-								for (l = 0; l < 4; l++)
-								{
-									Value[l + 0] = (a2b2c2d2 >> l) & 1;
-									Value[l + 4] = (a1b1c1d1 >> l) & 1;
-									Value[l + 8] = (a3b3c3d3 >> l) & 1;
-								}
-
-								UniqueTables[index][NumberOfUniqueTables[index]].SmallTable[k][InputIndex] = 0;
-								for (l = 0;l < NumberOfDependencies;l++)
-									UniqueTables[index][NumberOfUniqueTables[index]].SmallTable[k][InputIndex] |= Value[Dependency[l]] << l;
-
-								InputIndex++;
-							}
-				}
-			}
-			else
-				UniqueTables[index][NumberOfUniqueTables[index]].Count++;
-
-			fscanf(F, "%s", TempStr); // skip the second ANF
-
-			for (k = 6; k < 12; k++)
-			{
-				l = 0;
-				do
-				{
-					TempChar = fgetc(F);
-					if (TempChar != '\n')
-						TempStr[l++] = TempChar;
-				} while (TempChar != ',');
-
-				TempStr[l] = 0;
-				Strings[k][index][j] = (char*)malloc((l + 1) * sizeof(char));
-				strcpy(Strings[k][index][j], TempStr);
-			}
-
-			fscanf(F, "%s", TempStr);
-			if (1) //ANF != ANF_old)
-			{
-				UniqueTables[index][NumberOfUniqueTables[index]].FullTable[1] = (unsigned char*)malloc((1 << 12) * sizeof(unsigned char));
-
-				for (k = 0; k < (1 << 12); k++)
-				{
-					UniqueTables[index][NumberOfUniqueTables[index]].FullTable[1][k] = (TempStr[k] <= '9') ? (TempStr[k] - '0') : (TempStr[k] - 'a' + 10);
-					UniqueTables[index][NumberOfUniqueTables[index]].Table[k] |= Unmasking[UniqueTables[index][NumberOfUniqueTables[index]].FullTable[1][k]] << 1;
-				}
-
-				//****************************//
-
-				for (k = 0;k < 3;k++)
-				{
-					UniqueTables[index][NumberOfUniqueTables[index]].SmallTable[3 + k] = (unsigned char*)malloc((1 << 12) * sizeof(unsigned char));
-
-					NumberOfDependencies = 0;
-					for (l = 0;l < 12;l++)
-						if (strstr(Strings[k * 2 + 7][index][j], VarStr[l]) != NULL)
-							Dependency[NumberOfDependencies++] = l;
-
-					InputIndex = 0;
-					for (abcd = 0; abcd < 16; abcd++)
-						for (a1b1c1d1 = 0; a1b1c1d1 < 16; a1b1c1d1++)
-							for (a2b2c2d2 = 0; a2b2c2d2 < 16; a2b2c2d2++)
-							{
-								a3b3c3d3 = abcd ^ a1b1c1d1 ^ a2b2c2d2;
-								for (l = 0;l < 4;l++)
-								{
-									Value[l + 0] = (a2b2c2d2 >> l) & 1;
-									Value[l + 4] = (a1b1c1d1 >> l) & 1;
-									Value[l + 8] = (a3b3c3d3 >> l) & 1;
-								}
-
-								UniqueTables[index][NumberOfUniqueTables[index]].SmallTable[3 + k][InputIndex] = 0;
-								for (l = 0;l < NumberOfDependencies;l++)
-									UniqueTables[index][NumberOfUniqueTables[index]].SmallTable[3 + k][InputIndex] |= Value[Dependency[l]] << l;
+			RowOffsets[Bit0][j] = ftell64(F);
+			ReadRowStrings(F, TempStr, RowStrings);
+			RowOrder[j].Signature = RowSignature(RowStrings);
+			RowOrder[j].Row = j;
+			FreeRowStrings(RowStrings);
+		}
 
-								InputIndex++;
-							}
-				}
-			}
+		qsort(RowOrder, NumberOfTables[Bit0], sizeof(RowOrderstruct), CompareRowOrder);
 
-			fscanf(F, "%s", TempStr); // skip the third ANF
+		// the rows of the signatures with fewer than MinTablesPerSignature rows are moved together under signature 0
+		NumberOfSignatures = 0;
+		NumberOfRareSignatures = 0;
+		for (k = 0; k < NumberOfTables[Bit0]; k = SignatureEnd)
+		{
+			for (SignatureEnd = k + 1; (SignatureEnd < NumberOfTables[Bit0]) && (RowOrder[SignatureEnd].Signature == RowOrder[k].Signature); SignatureEnd++);
 
-			for (k = 12; k < 18; k++)
+			NumberOfSignatures++;
+			if (SignatureEnd - k < MinTablesPerSignature)
 			{
-				l = 0;
-				do
-				{
-					TempChar = fgetc(F);
-					if (TempChar != '\n')
-						TempStr[l++] = TempChar;
-				} while (TempChar != ',');
-
-				TempStr[l] = 0;
-				Strings[k][index][j] = (char*)malloc((l + 1) * sizeof(char));
-				strcpy(Strings[k][index][j], TempStr);
+				NumberOfRareSignatures++;
+				for (j = k; j < (int)SignatureEnd; j++)
+					RowOrder[j].Signature = 0;
 			}
+		}
 
-			fscanf(F, "%s", TempStr);
-			if (1) //ANF != ANF_old)
-			{
-				UniqueTables[index][NumberOfUniqueTables[index]].FullTable[2] = (unsigned char*)malloc((1 << 12) * sizeof(unsigned char));
-
-				for (k = 0; k < (1 << 12); k++)
-				{
-					UniqueTables[index][NumberOfUniqueTables[index]].FullTable[2][k] = (TempStr[k] <= '9') ? (TempStr[k] - '0') : (TempStr[k] - 'a' + 10);
-					UniqueTables[index][NumberOfUniqueTables[index]].Table[k] |= Unmasking[UniqueTables[index][NumberOfUniqueTables[index]].FullTable[2][k]] << 2;
-				}
-
-				//****************************//
-
-				for (k = 0;k < 3;k++)
-				{
-					UniqueTables[index][NumberOfUniqueTables[index]].SmallTable[6 + k] = (unsigned char*)malloc((1 << 12) * sizeof(unsigned char));
-
-					NumberOfDependencies = 0;
-					for (l = 0;l < 12;l++)
-						if (strstr(Strings[k * 2 + 13][index][j], VarStr[l]) != NULL)
-							Dependency[NumberOfDependencies++] = l;
-
-					InputIndex = 0;
-					for (abcd = 0; abcd < 16; abcd++)
-						for (a1b1c1d1 = 0; a1b1c1d1 < 16; a1b1c1d1++)
-							for (a2b2c2d2 = 0; a2b2c2d2 < 16; a2b2c2d2++)
-							{
-								a3b3c3d3 = abcd ^ a1b1c1d1 ^ a2b2c2d2;
-								for (l = 0; l < 4; l++)
-								{
-									Value[l + 0] = (a2b2c2d2 >> l) & 1;
-									Value[l + 4] = (a1b1c1d1 >> l) & 1;
-									Value[l + 8] = (a3b3c3d3 >> l) & 1;
-								}
-
-								UniqueTables[index][NumberOfUniqueTables[index]].SmallTable[6 + k][InputIndex] = 0;
-								for (l = 0;l < NumberOfDependencies;l++)
-									UniqueTables[index][NumberOfUniqueTables[index]].SmallTable[6 + k][InputIndex] |= Value[Dependency[l]] << l;
-
-								InputIndex++;
-							}
-				}
-
-				//****************************//
+		qsort(RowOrder, NumberOfTables[Bit0], sizeof(RowOrderstruct), CompareRowOrder);
 
-				NumberOfUniqueTables[index]++;
-			}
+		UniqueTables[Bit0] = (UniqueTablestruct*)malloc(NumberOfTables[Bit0] * sizeof(UniqueTablestruct));
+		Stores[Bit0].Tables = UniqueTables[Bit0];
 
-			ANF_old = ANF;
+		NumberOfUniqueTables[Bit0] = 0;
+		Filling = NoBucket;
+		for (j = 0; j < NumberOfTables[Bit0]; j++)
+		{
+			fseek64(F, RowOffsets[Bit0][RowOrder[j].Row], SEEK_SET);
+			TableBytes = NewTableSlot(Stores, Bit0, NumberOfUniqueTables[Bit0], RowOrder[j].Signature, &Filling);
+			ReadTable(F, TempStr, RowOrder[j].Row, &UniqueTables[Bit0][NumberOfUniqueTables[Bit0]], TableBytes, RowStrings);
+			FreeRowStrings(RowStrings);
+			NumberOfUniqueTables[Bit0]++;
 		}
 
+		ReleaseTable(Stores, Bit0, &Filling);
 		fclose(F);
+		free(RowOrder);
 
-		printf(", unique: %d\n", NumberOfUniqueTables[index]);
+		printf(", unique: %d in %d buckets of %d signatures (%d rare)\n", NumberOfUniqueTables[Bit0], Stores[Bit0].NumberOfBuckets,
+			NumberOfSignatures, NumberOfRareSignatures);
 	}
 
 	//====================================================
 
+	if (PlanSearch)
+	{
+		printf("\nplan: overriding ReduceTables %d, ReorderTabes %d, CheckCouples %d and NumberOfCPUs %d\n",
+			ReduceTables, ReorderTabes, CheckCouples, NumberOfCPUs);
+		NumberOfCPUs = (omp_get_num_procs() > 255) ? 255 : omp_get_num_procs();
+	}
+
 	omp_set_num_threads(NumberOfCPUs);
 	UniformityCounter = (unsigned short***)malloc(omp_get_max_threads() * sizeof(unsigned short**));
 	Dis = (unsigned short***)malloc(omp_get_max_threads() * sizeof(unsigned short**));
@@ -507,13 +2003,13 @@ int main()
 	for (j = 0;j < omp_get_max_threads();j++)
 	{
 		UniformityCounter[j] = (unsigned short**)malloc((NumberOfOutputBits - 1) * sizeof(unsigned short*));
-		Dis[j] = (unsigned short**)malloc(630 * sizeof(unsigned short*));
-		DisOld[j] = (unsigned short**)malloc(630 * sizeof(unsigned short*));
+		Dis[j] = (unsigned short**)malloc(MaxNumberOfProbes * sizeof(unsigned short*));
+		DisOld[j] = (unsigned short**)malloc(MaxNumberOfProbes * sizeof(unsigned short*));
 
 		for (index = 0; index < NumberOfOutputBits - 1; index++)
 			UniformityCounter[j][index] = (unsigned short*)calloc((1 << (3 * (index + 2))), sizeof(unsigned short));
 
-		for (i0 = 0; i0 < 630; i0++)
+		for (i0 = 0; i0 < MaxNumberOfProbes; i0++)
 		{
 			Dis[j][i0] = (unsigned short*)malloc(128 * sizeof(unsigned short));
 			DisOld[j][i0] = (unsigned short*)malloc(128 * sizeof(unsigned short));
@@ -522,6 +2018,60 @@ int main()
 
 	//====================================================
 
+	if (PlanSearch)
+	{
+		// cost of the search with and without reduction / couples, the reduction is expected to keep a table
+		// if it has at least one compatible table for every other output bit
+		for (Bit0 = 0; Bit0 < NumberOfOutputBits; Bit0++)
+			PlanSize[Bit0] = NumberOfUniqueTables[Bit0];
+
+		for (Bit0 = 0; Bit0 < NumberOfOutputBits; Bit0++)
+		{
+			PlanRate[Bit0][Bit0] = 1;
+			for (Bit1 = Bit0 + 1; Bit1 < NumberOfOutputBits; Bit1++)
+			{
+				PlanRate[Bit0][Bit1] = SampleCompatibility(Stores, Bit0, NULL, NumberOfUniqueTables[Bit0],
+					Bit1, NULL, NumberOfUniqueTables[Bit1], UniformityCounter, Dis, DisOld);
+				PlanRate[Bit1][Bit0] = PlanRate[Bit0][Bit1];
+			}
+		}
+
+		PlanReductionCost = 0;
+		for (Bit0 = 0; Bit0 < NumberOfOutputBits; Bit0++)
+		{
+			PlanReducedSize[Bit0] = PlanSize[Bit0];
+			for (Bit1 = 0; Bit1 < NumberOfOutputBits; Bit1++)
+				if (Bit1 != Bit0)
+				{
+					PlanReducedSize[Bit0] *= 1 - pow(1 - PlanRate[Bit0][Bit1], PlanSize[Bit1]);
+					if (Bit1 > Bit0)
+						PlanReductionCost += PlanSize[Bit0] * PlanSize[Bit1] * PairCheckTime;
+				}
+		}
+
+		for (ReduceTables = 0; ReduceTables < 2; ReduceTables++)
+			for (CheckCouples = 0; CheckCouples < 2; CheckCouples++)
+			{
+				PlanCouplesCost = 0;
+				if (CheckCouples)
+					for (Bit0 = 0; Bit0 < NumberOfOutputBits; Bit0++)
+						for (Bit1 = Bit0 + 1; Bit1 < NumberOfOutputBits; Bit1++)
+							PlanCouplesCost += (ReduceTables ? (PlanReducedSize[Bit0] * PlanReducedSize[Bit1]) : (PlanSize[Bit0] * PlanSize[Bit1])) * PairCheckTime;
+
+				PlanCost[ReduceTables][CheckCouples] = (ReduceTables ? PlanReductionCost : 0) + PlanCouplesCost +
+					ChooseTablesOrder(ReduceTables ? PlanReducedSize : PlanSize, PlanRate, CheckCouples, PlanOrder);
+			}
+
+		ReduceTables = (PlanCost[1][0] < PlanCost[0][0]) || (PlanCost[1][1] < PlanCost[0][1]);
+		CheckCouples = PlanCost[ReduceTables][1] < PlanCost[ReduceTables][0];
+		ReorderTabes = 1;
+
+		printf("plan: %d CPUs, %.3g s per couple, reduce tables %d, reorder tables %d, check couples %d (estimated %.3g s)\n",
+			NumberOfCPUs, PairCheckTime, ReduceTables, ReorderTabes, CheckCouples, PlanCost[ReduceTables][CheckCouples]);
+	}
+
+	//====================================================
+
 	memcpy(TempSize, NumberOfUniqueTables, NumberOfOutputBits * sizeof(unsigned int));
 	for (index = 0; index < NumberOfOutputBits; index++)
 	{
@@ -579,57 +2129,120 @@ int main()
 					printf(", ");
 				printf("with %d ", TablesOrder[index2]);
 
-				if (((long long)NumberOfReducedTables[TablesOrder[index]]) * ((long long)NumberOfReducedTables[TablesOrder[index2]]) < MaxCouplesPossible)
+				// keep the verdicts to be reused when filling CouplesPossible
+				if (CheckCouples || PlanSearch)
+					PairVerdicts[TablesOrder[index]][TablesOrder[index2]] = NewPairVerdict(NumberOfUniqueTables[TablesOrder[index]], NumberOfUniqueTables[TablesOrder[index2]]);
+
+				// the couples are checked per couple of buckets, which are loaded once, and inside it in tiles, a block of
+				// tables of one side against a block of the other side, so that both blocks stay in the cache
+				TileSize = TileCacheSize / (2 * 13 * (1 << 12)); // Table + 3 FullTable + 9 SmallTable per side
+				if (TileSize == 0)
+					TileSize = 1;
+
+				NumberOfBuckets0 = Stores[TablesOrder[index]].NumberOfBuckets;
+				NumberOfBuckets1 = Stores[TablesOrder[index2]].NumberOfBuckets;
+				BucketPairs[TablesOrder[index]][TablesOrder[index2]] = NewBitMatrix(NumberOfBuckets0, NumberOfBuckets1, 1);
+				CheckBits = (unsigned char*)calloc(NumberOfUniqueTables[TablesOrder[index]] + 1, sizeof(unsigned char));
+				PairedBits = (unsigned char*)calloc(NumberOfUniqueTables[TablesOrder[index2]] + 1, sizeof(unsigned char));
+				TilePaired = (unsigned char*)malloc((size_t)NumberOfCPUs * TablesPerBucket * sizeof(unsigned char));
+				TileChecked = (unsigned char*)malloc((size_t)NumberOfCPUs * TablesPerBucket * sizeof(unsigned char));
+
+				// a couple of buckets reads only the Flags, which do not change during the pass, and its own TilePaired and
+				// TileChecked, so the couples it skips do not depend on the other ones; they are merged into CheckBits and
+				// PairedBits, read once all are done
+				#pragma omp parallel for schedule(dynamic) private(ThreadNum, First0, First1, End0, End1, Tile0, Tile1, i0, i1, TablesAddress, FullTablesAddress, SmallTablesAddress, Res, CheckBit, Flag1, PairPossible)
+				for (Pair = 0; Pair < (int)(NumberOfBuckets0 * NumberOfBuckets1); Pair++)
 				{
-					#pragma omp parallel for schedule(guided) private(ThreadNum, i1, TablesAddress, FullTablesAddress, SmallTablesAddress, CheckBit)
-					for (i0 = 0; i0 < NumberOfUniqueTables[TablesOrder[index]]; i0++)
-					{
-						ThreadNum = omp_get_thread_num();
-
-						if (Flags[TablesOrder[index]][i0] == (OnPattern[index2 - 1] & OffPattern[index]))
-						{
-							TablesAddress[0] = UniqueTables[TablesOrder[index]][i0].Table;
-							FullTablesAddress[0]= UniqueTables[TablesOrder[index]][i0].FullTable;
-							SmallTablesAddress[0]= UniqueTables[TablesOrder[index]][i0].SmallTable;
-							CheckBit = 0;
-
-							for (i1 = 0; i1 < NumberOfUniqueTables[TablesOrder[index2]]; i1++)
-								if (((!SameType) ||
-									(UniqueTables[TablesOrder[index]][i0].Type == UniqueTables[TablesOrder[index2]][i1].Type)) &&
-										((((index == 0) & (Flags[TablesOrder[index2]][i1] == 0)) ||
-									((index != 0) & (Flags[TablesOrder[index2]][i1] == (OnPattern[index - 1] & OffPattern[index2]))) ||
-											((Flags[TablesOrder[index2]][i1] == (OnPattern[index] & OffPattern[index2])) & (!CheckBit)))))
+					ThreadNum = omp_get_thread_num();
+					First0 = Stores[TablesOrder[index]].Buckets[Pair / NumberOfBuckets1].FirstTable;
+					End0 = First0 + Stores[TablesOrder[index]].Buckets[Pair / NumberOfBuckets1].NumberOfTables;
+					First1 = Stores[TablesOrder[index2]].Buckets[Pair % NumberOfBuckets1].FirstTable;
+					End1 = First1 + Stores[TablesOrder[index2]].Buckets[Pair % NumberOfBuckets1].NumberOfTables;
+					memset(TilePaired + ThreadNum * TablesPerBucket, 0, TablesPerBucket * sizeof(unsigned char));
+					memset(TileChecked + ThreadNum * TablesPerBucket, 0, TablesPerBucket * sizeof(unsigned char));
+					PairPossible = 0;
+
+					AcquireBucket(Stores, TablesOrder[index], Pair / NumberOfBuckets1);
+					AcquireBucket(Stores, TablesOrder[index2], Pair % NumberOfBuckets1);
+
+					for (Tile0 = First0; Tile0 < End0; Tile0 += TileSize)
+						for (Tile1 = First1; Tile1 < End1; Tile1 += TileSize)
+							for (i0 = Tile0; (i0 < Tile0 + TileSize) && (i0 < End0); i0++)
+								if (Flags[TablesOrder[index]][i0] == (OnPattern[index2 - 1] & OffPattern[index]))
 								{
-									TablesAddress[1] = UniqueTables[TablesOrder[index2]][i1].Table;
-									FullTablesAddress[1] = UniqueTables[TablesOrder[index2]][i1].FullTable;
-									SmallTablesAddress[1] = UniqueTables[TablesOrder[index2]][i1].SmallTable;
-
-									if (!CheckDistributions(FullTablesAddress, SmallTablesAddress, 2, Dis[ThreadNum], DisOld[ThreadNum]))
-										if (!CheckUniformity(TablesAddress, 2, UniformityCounter[ThreadNum]))
+									TablesAddress[0] = UniqueTables[TablesOrder[index]][i0].Table;
+									FullTablesAddress[0] = UniqueTables[TablesOrder[index]][i0].FullTable;
+									SmallTablesAddress[0] = UniqueTables[TablesOrder[index]][i0].SmallTable;
+									CheckBit = TileChecked[ThreadNum * TablesPerBucket + i0 - First0];
+
+									for (i1 = Tile1; (i1 < Tile1 + TileSize) && (i1 < End1); i1++)
+									{
+										Flag1 = Flags[TablesOrder[index2]][i1] | (TilePaired[ThreadNum * TablesPerBucket + i1 - First1] << index);
+
+										if (((!SameType) ||
+											(UniqueTables[TablesOrder[index]][i0].Type == UniqueTables[TablesOrder[index2]][i1].Type)) &&
+												((((index == 0) & (Flag1 == 0)) ||
+											((index != 0) & (Flag1 == (OnPattern[index - 1] & OffPattern[index2]))) ||
+													((Flag1 == (OnPattern[index] & OffPattern[index2])) & (!CheckBit)))))
 										{
-											CheckBit = 1;
-											#pragma omp atomic
-											Flags[TablesOrder[index2]][i1] |= (1 << index);
+											TablesAddress[1] = UniqueTables[TablesOrder[index2]][i1].Table;
+											FullTablesAddress[1] = UniqueTables[TablesOrder[index2]][i1].FullTable;
+											SmallTablesAddress[1] = UniqueTables[TablesOrder[index2]][i1].SmallTable;
+
+											Res = CheckDistributions<2>(FullTablesAddress, SmallTablesAddress, Dis[ThreadNum], DisOld[ThreadNum]);
+											if (!Res)
+												Res = CheckUniformity(TablesAddress, 2, UniformityCounter[ThreadNum]);
+
+											if (PairVerdicts[TablesOrder[index]][TablesOrder[index2]])
+												SetPairVerdict(PairVerdicts[TablesOrder[index]][TablesOrder[index2]], i0, i1, !Res);
+
+											if (!Res)
+											{
+												CheckBit = 1;
+												TilePaired[ThreadNum * TablesPerBucket + i1 - First1] = 1;
+												PairPossible = 1;
+											}
 										}
+										else if ((Flag1 == (OnPattern[index] & OffPattern[index2])) && CheckBit)
+											PairPossible = 1; // both are already paired, the couple is not checked
+									}
+
+									TileChecked[ThreadNum * TablesPerBucket + i0 - First0] = CheckBit;
 								}
 
-							if (CheckBit)
-							{
-								#pragma omp atomic
-								Flags[TablesOrder[index]][i0] |= (1 << index2);
-							}
+					ReleaseBucket(Stores, TablesOrder[index], Pair / NumberOfBuckets1);
+					ReleaseBucket(Stores, TablesOrder[index2], Pair % NumberOfBuckets1);
+
+					for (i0 = First0; i0 < End0; i0++)
+						if (TileChecked[ThreadNum * TablesPerBucket + i0 - First0])
+						{
+							#pragma omp atomic write
+							CheckBits[i0] = 1;
 						}
-					}
+
+					for (i1 = First1; i1 < End1; i1++)
+						if (TilePaired[ThreadNum * TablesPerBucket + i1 - First1])
+						{
+							#pragma omp atomic write
+							PairedBits[i1] = 1;
+						}
+
+					if (PairPossible)
+						SetBit(BucketPairs[TablesOrder[index]][TablesOrder[index2]], Pair / NumberOfBuckets1, Pair % NumberOfBuckets1);
 				}
-				else
-				{
-					for (i0 = 0; i0 < NumberOfUniqueTables[TablesOrder[index]]; i0++)
+
+				for (i0 = 0; i0 < NumberOfUniqueTables[TablesOrder[index]]; i0++)
+					if (CheckBits[i0])
 						Flags[TablesOrder[index]][i0] |= (1 << index2);
 
-					for (i1 = 0; i1 < NumberOfUniqueTables[TablesOrder[index2]]; i1++)
+				for (i1 = 0; i1 < NumberOfUniqueTables[TablesOrder[index2]]; i1++)
+					if (PairedBits[i1])
 						Flags[TablesOrder[index2]][i1] |= (1 << index);
-				}
 
+				free(CheckBits);
+				free(PairedBits);
+				free(TilePaired);
+				free(TileChecked);
 				if (index2 != NumberOfOutputBits - 1)
 				{
 					NumberOfReducedTables[TablesOrder[index]] = 0;
@@ -656,6 +2269,16 @@ int main()
 			if ((ReduceTables == 0) ||
 				(Flags[TablesOrder[index]][i[0]] == (OnPattern[NumberOfOutputBits - 1] & OffPattern[index])))
 				ReducedTablesIndex[TablesOrder[index]][NumberOfReducedTables[TablesOrder[index]]++] = i[0];
+
+		// the reduced tables of bucket k are ReducedBucketStart[k] .. ReducedBucketStart[k + 1] - 1
+		ReducedBucketStart[TablesOrder[index]] = (unsigned int*)malloc((Stores[TablesOrder[index]].NumberOfBuckets + 1) * sizeof(unsigned int));
+		for (k = 0, j = 0; k < Stores[TablesOrder[index]].NumberOfBuckets; k++)
+		{
+			while ((j < NumberOfReducedTables[TablesOrder[index]]) && (ReducedTablesIndex[TablesOrder[index]][j] < Stores[TablesOrder[index]].Buckets[k].FirstTable))
+				j++;
+			ReducedBucketStart[TablesOrder[index]][k] = j;
+		}
+		ReducedBucketStart[TablesOrder[index]][k] = NumberOfReducedTables[TablesOrder[index]];
 	}
 
 	printf("\n");
@@ -680,6 +2303,38 @@ int main()
 			TablesOrder[index] = index;
 	}
 
+	if (PlanSearch)
+	{
+		// the rates among the remaining tables are higher than before the reduction, sample them again
+		for (Bit0 = 0; Bit0 < NumberOfOutputBits; Bit0++)
+		{
+			PlanSize[Bit0] = NumberOfReducedTables[Bit0];
+			for (Bit1 = Bit0 + 1; Bit1 < NumberOfOutputBits; Bit1++)
+			{
+				PlanRate[Bit0][Bit1] = SampleCompatibility(Stores, Bit0, ReducedTablesIndex[Bit0], NumberOfReducedTables[Bit0],
+					Bit1, ReducedTablesIndex[Bit1], NumberOfReducedTables[Bit1], UniformityCounter, Dis, DisOld);
+				PlanRate[Bit1][Bit0] = PlanRate[Bit0][Bit1];
+			}
+		}
+
+		PlanCouplesCost = 0;
+		for (Bit0 = 0; Bit0 < NumberOfOutputBits; Bit0++)
+			for (Bit1 = Bit0 + 1; Bit1 < NumberOfOutputBits; Bit1++)
+				PlanCouplesCost += PlanSize[Bit0] * PlanSize[Bit1] * PairCheckTime;
+
+		PlanCost[ReduceTables][0] = ChooseTablesOrder(PlanSize, PlanRate, 0, PlanOrder);
+		PlanCost[ReduceTables][1] = ChooseTablesOrder(PlanSize, PlanRate, 1, TablesOrder) + PlanCouplesCost;
+		CheckCouples = PlanCost[ReduceTables][1] < PlanCost[ReduceTables][0];
+
+		if (!CheckCouples)
+			memcpy(TablesOrder, PlanOrder, NumberOfOutputBits);
+
+		printf("plan: order");
+		for (Bit0 = NumberOfOutputBits; Bit0 > 0; Bit0--)
+			printf(" %d", TablesOrder[Bit0 - 1]);
+		printf(", check couples %d (estimated %.3g s)\n\n", CheckCouples, PlanCost[ReduceTables][CheckCouples]);
+	}
+
 	for (index = 0; index < NumberOfOutputBits; index++)
 		TablesOrderInv[TablesOrder[index]] = index;
 
@@ -691,213 +2346,385 @@ int main()
 			{
 				printf("Checking possible couples (%d,%d) ", TablesOrder[index2], TablesOrder[index]);
 
-				if (((long long)NumberOfReducedTables[TablesOrder[index2]]) * ((long long)NumberOfReducedTables[TablesOrder[index]]) < MaxCouplesPossible)
+				CouplesPossible[TablesOrder[index2]][TablesOrder[index]] = NewBitMatrix(NumberOfReducedTables[TablesOrder[index2]], NumberOfReducedTables[TablesOrder[index]], 1);
+				NumberOfReusedCouples = 0;
+
+				// blocked the same way as the reduction, the bit of a couple is set if it is not possible; the couples of
+				// two buckets that have no possible couple are not checked, the final search rejects them by their buckets
+				TileSize = TileCacheSize / (2 * 13 * (1 << 12));
+				if (TileSize == 0)
+					TileSize = 1;
+
+				NumberOfBuckets0 = Stores[TablesOrder[index2]].NumberOfBuckets;
+				NumberOfBuckets1 = Stores[TablesOrder[index]].NumberOfBuckets;
+
+				#pragma omp parallel for schedule(dynamic) private(ThreadNum, Bucket0, Bucket1, Tile0, Tile1, i0, i1, TablesAddress, FullTablesAddress, SmallTablesAddress, Res) reduction(+:NumberOfReusedCouples)
+				for (Pair = 0; Pair < (int)(NumberOfBuckets0 * NumberOfBuckets1); Pair++)
 				{
-					if (NumberOfReducedTables[TablesOrder[index2]])
-						CouplesPossible[TablesOrder[index2]][TablesOrder[index]] = (char**)malloc(NumberOfReducedTables[TablesOrder[index2]] * sizeof(char*));
-					else
-						CouplesPossible[TablesOrder[index2]][TablesOrder[index]] = NULL;
+					ThreadNum = omp_get_thread_num();
+					Bucket0 = Pair / NumberOfBuckets1;
+					Bucket1 = Pair % NumberOfBuckets1;
 
-					#pragma omp parallel for schedule(guided) private(ThreadNum, i0, TablesAddress, FullTablesAddress, SmallTablesAddress)
-					for (i1 = 0; i1 < NumberOfReducedTables[TablesOrder[index2]]; i1++)
-					{
-						ThreadNum = omp_get_thread_num();
+					if ((ReducedBucketStart[TablesOrder[index2]][Bucket0] == ReducedBucketStart[TablesOrder[index2]][Bucket0 + 1]) ||
+						(ReducedBucketStart[TablesOrder[index]][Bucket1] == ReducedBucketStart[TablesOrder[index]][Bucket1 + 1]) ||
+						(!BucketPairPossible(BucketPairs, TablesOrder[index2], Bucket0, TablesOrder[index], Bucket1)))
+						continue;
 
-						TablesAddress[0] = UniqueTables[TablesOrder[index2]][ReducedTablesIndex[TablesOrder[index2]][i1]].Table;
-						FullTablesAddress[0] = UniqueTables[TablesOrder[index2]][ReducedTablesIndex[TablesOrder[index2]][i1]].FullTable;
-						SmallTablesAddress[0] = UniqueTables[TablesOrder[index2]][ReducedTablesIndex[TablesOrder[index2]][i1]].SmallTable;
-						CouplesPossible[TablesOrder[index2]][TablesOrder[index]][i1] = (char*)malloc(NumberOfReducedTables[TablesOrder[index]] * sizeof(char));
+					AcquireBucket(Stores, TablesOrder[index2], Bucket0);
+					AcquireBucket(Stores, TablesOrder[index], Bucket1);
 
-						for (i0 = 0; i0 < NumberOfReducedTables[TablesOrder[index]]; i0++)
-						{
-							TablesAddress[1] = UniqueTables[TablesOrder[index]][ReducedTablesIndex[TablesOrder[index]][i0]].Table;
-							FullTablesAddress[1] = UniqueTables[TablesOrder[index]][ReducedTablesIndex[TablesOrder[index]][i0]].FullTable;
-							SmallTablesAddress[1] = UniqueTables[TablesOrder[index]][ReducedTablesIndex[TablesOrder[index]][i0]].SmallTable;
-
-							if (!CheckDistributions(FullTablesAddress, SmallTablesAddress, 2, Dis[ThreadNum], DisOld[ThreadNum]))
-								CouplesPossible[TablesOrder[index2]][TablesOrder[index]][i1][i0] = CheckUniformity(TablesAddress, 2, UniformityCounter[ThreadNum]);
-							else
-								CouplesPossible[TablesOrder[index2]][TablesOrder[index]][i1][i0] = 1;
-						}
-					}
+					for (Tile0 = ReducedBucketStart[TablesOrder[index2]][Bucket0]; Tile0 < ReducedBucketStart[TablesOrder[index2]][Bucket0 + 1]; Tile0 += TileSize)
+						for (Tile1 = ReducedBucketStart[TablesOrder[index]][Bucket1]; Tile1 < ReducedBucketStart[TablesOrder[index]][Bucket1 + 1]; Tile1 += TileSize)
+							for (i1 = Tile0; (i1 < Tile0 + TileSize) && (i1 < ReducedBucketStart[TablesOrder[index2]][Bucket0 + 1]); i1++)
+							{
+								TablesAddress[0] = UniqueTables[TablesOrder[index2]][ReducedTablesIndex[TablesOrder[index2]][i1]].Table;
+								FullTablesAddress[0] = UniqueTables[TablesOrder[index2]][ReducedTablesIndex[TablesOrder[index2]][i1]].FullTable;
+								SmallTablesAddress[0] = UniqueTables[TablesOrder[index2]][ReducedTablesIndex[TablesOrder[index2]][i1]].SmallTable;
 
-					printf("done\n");
-				}
-				else
-				{
-					CouplesPossible[TablesOrder[index2]][TablesOrder[index]] = NULL;
-					printf("too large\n");
+								for (i0 = Tile1; (i0 < Tile1 + TileSize) && (i0 < ReducedBucketStart[TablesOrder[index]][Bucket1 + 1]); i0++)
+								{
+									Res = LookupPairVerdict(PairVerdicts, TablesOrder[index2], ReducedTablesIndex[TablesOrder[index2]][i1],
+										TablesOrder[index], ReducedTablesIndex[TablesOrder[index]][i0]);
+
+									if (Res != 2)
+										NumberOfReusedCouples++;
+									else
+									{
+										TablesAddress[1] = UniqueTables[TablesOrder[index]][ReducedTablesIndex[TablesOrder[index]][i0]].Table;
+										FullTablesAddress[1] = UniqueTables[TablesOrder[index]][ReducedTablesIndex[TablesOrder[index]][i0]].FullTable;
+										SmallTablesAddress[1] = UniqueTables[TablesOrder[index]][ReducedTablesIndex[TablesOrder[index]][i0]].SmallTable;
+
+										Res = CheckDistributions<2>(FullTablesAddress, SmallTablesAddress, Dis[ThreadNum], DisOld[ThreadNum]);
+										if (!Res)
+											Res = CheckUniformity(TablesAddress, 2, UniformityCounter[ThreadNum]);
+									}
+
+									if (Res)
+										SetBit(CouplesPossible[TablesOrder[index2]][TablesOrder[index]], i1, i0);
+								}
+							}
+
+					ReleaseBucket(Stores, TablesOrder[index2], Bucket0);
+					ReleaseBucket(Stores, TablesOrder[index], Bucket1);
 				}
+
+				printf("done (%lld reused%s)\n", NumberOfReusedCouples, CouplesPossible[TablesOrder[index2]][TablesOrder[index]]->Spill.Name[0] ? ", spilled" : "");
 			}
 			else
 				CouplesPossible[TablesOrder[index2]][TablesOrder[index]] = NULL;
 
+	for (index = 0; index < NumberOfOutputBits; index++)
+		for (index2 = 0; index2 < NumberOfOutputBits; index2++)
+			if (PairVerdicts[index][index2])
+			{
+				FreePairVerdict(PairVerdicts[index][index2]);
+				PairVerdicts[index][index2] = NULL;
+			}
+
 	//====================================================
 
+	// the strings of the rows found are read again from Res_x.csv
+	for (Bit0 = 0; Bit0 < NumberOfOutputBits; Bit0++)
+	{
+		sprintf(FilePath, "%s%d.csv", path, Bits[Bit0]);
+		RowFiles[Bit0] = fopen(FilePath, "rt");
+	}
+
 	strcpy(FilePath, path);
 	for (index = 0; index < NumberOfOutputBits; index++)
 		sprintf(FilePath, "%s%d", FilePath, Bits[index]);
 
-	strcat(FilePath, ".csv");
+	strcat(FilePath, CountOnly ? "_count.csv" : ".csv");
 	F = fopen(FilePath, "wt");
 	fclose(F);
 
+	// exact number of combinations per root (table of the outermost level) and per table of every output bit
+	memset(&TotalCount, 0, sizeof(Countstruct));
+	RootCount = NULL;
+	for (Bit0 = 0; Bit0 < NumberOfOutputBits; Bit0++)
+		ANFCount[Bit0] = NULL;
+
+	if (CountOnly)
+	{
+		RootCount = (Countstruct*)calloc(NumberOfReducedTables[TablesOrder[NumberOfOutputBits - 1]] + 1, sizeof(Countstruct));
+		for (Bit0 = 0; Bit0 < NumberOfOutputBits; Bit0++)
+			ANFCount[Bit0] = (Countstruct*)calloc(NumberOfUniqueTables[Bit0] + 1, sizeof(Countstruct));
+	}
+
+	// the outermost SplitDepth levels are enumerated as one number, the outermost level being the most significant,
+	// every thread starts with an equal range of these work items; at least one level is left inside a work item
+	SplitDepth = 1;
+	NumberOfItems = NumberOfReducedTables[TablesOrder[NumberOfOutputBits - 1]];
+	while ((SplitDepth < NumberOfOutputBits - 1) && (NumberOfItems < (long long)WorkItemsPerThread * omp_get_max_threads()))
+	{
+		SplitDepth++;
+		NumberOfItems *= NumberOfReducedTables[TablesOrder[NumberOfOutputBits - SplitDepth]];
+	}
+	printf("%d outermost levels split into %" PRId64 " work items\n", SplitDepth, (int64_t)NumberOfItems);
+
+	PrintStep = NumberOfItems / 1000 + 1;
+
+	WorkRanges = (WorkRangestruct*)malloc(omp_get_max_threads() * sizeof(WorkRangestruct));
+	for (j = 0; j < omp_get_max_threads(); j++)
+	{
+		WorkRanges[j].Begin = NumberOfItems * j / omp_get_max_threads();
+		WorkRanges[j].End = NumberOfItems * (j + 1) / omp_get_max_threads();
+		omp_init_lock(&WorkRanges[j].Lock);
+	}
+
 	NumberOfFound = 0;
 	Counter = 0;
-	#pragma omp parallel for schedule(guided) private(ThreadNum, j, i, index, index2, TablesAddress, FullTablesAddress, SmallTablesAddress, Res)
-	for (i_last = 0; i_last < NumberOfReducedTables[TablesOrder[NumberOfOutputBits - 1]]; i_last++)
+	#pragma omp parallel private(ThreadNum, Item, Done, j, i, index, index2, Bit0, Held, TablesAddress, FullTablesAddress, SmallTablesAddress, Res)
 	{
 		ThreadNum = omp_get_thread_num();
+		for (Bit0 = 0; Bit0 < NumberOfOutputBits; Bit0++)
+			Held[Bit0] = NoBucket;
 
-		#pragma omp atomic
-		Counter++;
-
-		#pragma omp critical (print)
+		while (TakeWork(WorkRanges, ThreadNum, omp_get_max_threads(), &Item))
 		{
-			printf("%d / %d\n", Counter, NumberOfReducedTables[TablesOrder[NumberOfOutputBits - 1]]);
-		}
+			#pragma omp atomic capture
+			Done = ++Counter;
+
+			if ((Item % PrintStep) == 0)
+			{
+				#pragma omp critical (print)
+				{
+					printf("%" PRId64 " / %" PRId64 "\n", (int64_t)Done, (int64_t)NumberOfItems);
+				}
+			}
 
-		for (j = 0; j < NumberOfOutputBits - 1; j++)
-			i[j] = 0;
-		i[NumberOfOutputBits - 1] = i_last;
+			for (j = 0; j < NumberOfOutputBits; j++)
+				i[j] = 0;
 
-		while (i[NumberOfOutputBits - 1] == i_last)
-		{
-			for (index = NumberOfOutputBits - 1; index >= 0; index--)
+			for (j = NumberOfOutputBits - SplitDepth; j < NumberOfOutputBits; j++)
 			{
-				if (SameType && (index < (NumberOfOutputBits - 1)) &&
-					(UniqueTables[TablesOrder[index]][ReducedTablesIndex[TablesOrder[index]][i[index]]].Type !=
-						UniqueTables[TablesOrder[index + 1]][ReducedTablesIndex[TablesOrder[index + 1]][i[index + 1]]].Type))
-					break;
+				i[j] = Item % NumberOfReducedTables[TablesOrder[j]];
+				Item /= NumberOfReducedTables[TablesOrder[j]];
+			}
+
+			j = 0;
+			while (j <= NumberOfOutputBits - SplitDepth)
+			{
+				for (index = NumberOfOutputBits - 1; index >= 0; index--)
+				{
+					if (SameType && (index < (NumberOfOutputBits - 1)) &&
+						(UniqueTables[TablesOrder[index]][ReducedTablesIndex[TablesOrder[index]][i[index]]].Type !=
+							UniqueTables[TablesOrder[index + 1]][ReducedTablesIndex[TablesOrder[index + 1]][i[index + 1]]].Type))
+						break;
 
-				for (index2 = NumberOfOutputBits - 1; index2 > index; index2--)
-					if (CouplesPossible[TablesOrder[index2]][TablesOrder[index]] &&
-						CouplesPossible[TablesOrder[index2]][TablesOrder[index]][i[index2]][i[index]])
+					for (index2 = NumberOfOutputBits - 1; index2 > index; index2--)
+						if (CouplesPossible[TablesOrder[index2]][TablesOrder[index]] &&
+							GetBit(CouplesPossible[TablesOrder[index2]][TablesOrder[index]], i[index2], i[index]))
+							break;
+
+					if (index2 > index)
 						break;
 
-				if (index2 > index)
-					break;
+					for (index2 = NumberOfOutputBits - 1; index2 > index; index2--)
+						if (!BucketPairPossible(BucketPairs, TablesOrder[index2], UniqueTables[TablesOrder[index2]][ReducedTablesIndex[TablesOrder[index2]][i[index2]]].Bucket,
+							TablesOrder[index], UniqueTables[TablesOrder[index]][ReducedTablesIndex[TablesOrder[index]][i[index]]].Bucket))
+							break;
 
-				FullTablesAddress[NumberOfOutputBits - 1 - index] = UniqueTables[TablesOrder[index]][ReducedTablesIndex[TablesOrder[index]][i[index]]].FullTable;
-				SmallTablesAddress[NumberOfOutputBits - 1 - index] = UniqueTables[TablesOrder[index]][ReducedTablesIndex[TablesOrder[index]][i[index]]].SmallTable;
-				TablesAddress[NumberOfOutputBits - 1 - index] = UniqueTables[TablesOrder[index]][ReducedTablesIndex[TablesOrder[index]][i[index]]].Table;
-			}
+					if (index2 > index)
+						break;
 
-			if (index >= 0)
-			{
-				for (j = index - 1; j >= 0; j--)
-					i[j] = NumberOfReducedTables[TablesOrder[j]];
-			}
-			else
-			{
-				Res = CheckDistributions(FullTablesAddress, SmallTablesAddress, NumberOfOutputBits, Dis[ThreadNum], DisOld[ThreadNum]);
-				if (!Res)
-					Res = CheckUniformity(TablesAddress, NumberOfOutputBits, UniformityCounter[ThreadNum]);
+					AcquireTable(Stores, TablesOrder[index], ReducedTablesIndex[TablesOrder[index]][i[index]], &Held[index]);
+					FullTablesAddress[NumberOfOutputBits - 1 - index] = UniqueTables[TablesOrder[index]][ReducedTablesIndex[TablesOrder[index]][i[index]]].FullTable;
+					SmallTablesAddress[NumberOfOutputBits - 1 - index] = UniqueTables[TablesOrder[index]][ReducedTablesIndex[TablesOrder[index]][i[index]]].SmallTable;
+					TablesAddress[NumberOfOutputBits - 1 - index] = UniqueTables[TablesOrder[index]][ReducedTablesIndex[TablesOrder[index]][i[index]]].Table;
+				}
 
-				if (Res)
+				if (index >= 0)
 				{
-					for (j = NumberOfOutputBits - 2 - Res; j >= 0; j--)
+					for (j = index - 1; j >= 0; j--)
 						i[j] = NumberOfReducedTables[TablesOrder[j]];
 				}
 				else
 				{
-					#pragma omp critical (found)
-					{
-						unsigned int small_i[NumberOfOutputBits + 1];
+					Res = CheckDistributions<NumberOfOutputBits>(FullTablesAddress, SmallTablesAddress, Dis[ThreadNum], DisOld[ThreadNum]);
+					if (!Res)
+						Res = CheckUniformity(TablesAddress, NumberOfOutputBits, UniformityCounter[ThreadNum]);
 
-						for (index = 0; index < NumberOfOutputBits + 1; index++)
-							small_i[index] = 0;
+					if (Res)
+					{
+						for (j = NumberOfOutputBits - 2 - Res; j >= 0; j--)
+							i[j] = NumberOfReducedTables[TablesOrder[j]];
+					}
+					else if (CountOnly)
+					{
+						Countstruct	Product = { { 1, 0, 0, 0 } };
 
-						F = fopen(FilePath, "at");
+						for (Bit0 = 0; Bit0 < NumberOfOutputBits; Bit0++)
+							MultiplyCount(&Product, UniqueTables[Bit0][ReducedTablesIndex[Bit0][i[TablesOrderInv[Bit0]]]].Count);
 
-						NumberOfFound++;
-						if ((NumberOfFound & 0xff) == 0xff)
+						#pragma omp critical (found)
 						{
-							printf("%d / %d found %I64d ", Counter, NumberOfReducedTables[TablesOrder[NumberOfOutputBits - 1]], NumberOfFound);
-							for (index = 0; index < NumberOfOutputBits; index++)
-								printf("%d ", i[index]);
-							printf("\n");
-						}
+							NumberOfFound++;
+							AddCount(&TotalCount, &Product);
+							AddCount(&RootCount[i[NumberOfOutputBits - 1]], &Product);
 
-						while (!small_i[NumberOfOutputBits])
+							for (Bit0 = 0; Bit0 < NumberOfOutputBits; Bit0++)
+								AddCount(&ANFCount[Bit0][ReducedTablesIndex[Bit0][i[TablesOrderInv[Bit0]]]], &Product);
+						}
+					}
+					else
+					{
+						#pragma omp critical (found)
 						{
+							unsigned int small_i[NumberOfOutputBits + 1];
+
+							for (index = 0; index < NumberOfOutputBits + 1; index++)
+								small_i[index] = 0;
+
+							F = fopen(FilePath, "at");
+
 							NumberOfFound++;
 							if ((NumberOfFound & 0xff) == 0xff)
 							{
-								printf("%d / %d found %I64d ", Counter, NumberOfReducedTables[TablesOrder[NumberOfOutputBits - 1]], NumberOfFound);
+								printf("%" PRId64 " / %" PRId64 " found %" PRId64 " ", (int64_t)Done, (int64_t)NumberOfItems, (int64_t)NumberOfFound);
 								for (index = 0; index < NumberOfOutputBits; index++)
 									printf("%d ", i[index]);
 								printf("\n");
 							}
 
-							for (index = 0; index < NumberOfOutputBits; index++)
+							while (!small_i[NumberOfOutputBits])
 							{
-								//fprintf(F, "%08d, ", UniqueTables[index][ReducedTablesIndex[index][i[TablesOrderInv[index]]]].Type);
-								for (k = 0; k < 18; k++)
-									fprintf(F, "%s ", Strings[k][index][UniqueTables[index][ReducedTablesIndex[index][i[TablesOrderInv[index]]]].StartIndex + small_i[index]]);
-								fprintf(F, ", ");
-							}
+								NumberOfFound++;
+								if ((NumberOfFound & 0xff) == 0xff)
+								{
+									printf("%" PRId64 " / %" PRId64 " found %" PRId64 " ", (int64_t)Done, (int64_t)NumberOfItems, (int64_t)NumberOfFound);
+									for (index = 0; index < NumberOfOutputBits; index++)
+										printf("%d ", i[index]);
+									printf("\n");
+								}
+
+								for (Bit0 = 0; Bit0 < NumberOfOutputBits; Bit0++)
+								{
+									//fprintf(F, "%08d, ", UniqueTables[Bit0][ReducedTablesIndex[Bit0][i[TablesOrderInv[Bit0]]]].Type);
+									PrintRowStrings(F, RowFiles[Bit0], RowOffsets[Bit0][UniqueTables[Bit0][ReducedTablesIndex[Bit0][i[TablesOrderInv[Bit0]]]].StartIndex + small_i[Bit0]], TempStr);
+									fprintf(F, ", ");
+								}
 
-							fprintf(F, "\n");
+								fprintf(F, "\n");
 
 
-							j = 0;
-							do
-							{
-								small_i[j]++;
-								if (j < NumberOfOutputBits)
-									if (small_i[j] >= UniqueTables[j][ReducedTablesIndex[j][i[TablesOrderInv[j]]]].Count)
-										small_i[j] = 0;
-							} while (small_i[j++] == 0);
+								j = 0;
+								do
+								{
+									small_i[j]++;
+									if (j < NumberOfOutputBits)
+										if (small_i[j] >= UniqueTables[j][ReducedTablesIndex[j][i[TablesOrderInv[j]]]].Count)
+											small_i[j] = 0;
+								} while (small_i[j++] == 0);
+							}
+							fclose(F);
 						}
-						fclose(F);
 					}
 				}
-			}
 
-			j = 0;
-			do
-			{
-				i[j]++;
-				if (j < NumberOfOutputBits)
-					if (i[j] >= NumberOfReducedTables[TablesOrder[j]])
-						i[j] = 0;
-			} while (i[j++] == 0);
+				j = 0;
+				do
+				{
+					i[j]++;
+					if (j < NumberOfOutputBits)
+						if (i[j] >= NumberOfReducedTables[TablesOrder[j]])
+							i[j] = 0;
+				} while (i[j++] == 0);
+			}
 		}
+
+		for (Bit0 = 0; Bit0 < NumberOfOutputBits; Bit0++)
+			ReleaseTable(Stores, TablesOrder[Bit0], &Held[Bit0]);
 	}
 
-	printf("Total found %I64d\n\n", NumberOfFound);
+	for (j = 0; j < omp_get_max_threads(); j++)
+		omp_destroy_lock(&WorkRanges[j].Lock);
+	free(WorkRanges);
 
-	//--------------------------------------------------
+	for (Bit0 = 0; Bit0 < NumberOfOutputBits; Bit0++)
+		fclose(RowFiles[Bit0]);
 
-	for (index = 0; index < NumberOfOutputBits; index++)
+	printf("Total found %" PRId64 " (%" PRId64 " buckets read back, %" PRId64 " written back)\n\n",
+		(int64_t)NumberOfFound, (int64_t)NumberOfBucketLoads, (int64_t)NumberOfBucketWrites);
+
+	if (CountOnly)
 	{
-		for (index2 = 0; index2 < NumberOfOutputBits; index2++)
-			if (CouplesPossible[TablesOrder[index]][TablesOrder[index2]])
-			{
-				for (i0 = 0; i0 < NumberOfReducedTables[TablesOrder[index]]; i0++)
-					free(CouplesPossible[TablesOrder[index]][TablesOrder[index2]][i0]);
+		F = fopen(FilePath, "at");
 
-				free(CouplesPossible[TablesOrder[index]][TablesOrder[index2]]);
-			}
+		printf("Total combinations ");
+		PrintCount(stdout, TotalCount);
+		printf("\n\n");
 
-		if (ReducedTablesIndex[index])
-			free(ReducedTablesIndex[index]);
-		if (Flags[index])
-			free(Flags[index]);
+		fprintf(F, "total, ");
+		PrintCount(F, TotalCount);
+		fprintf(F, "\n");
 
-		for (j = 0; j < NumberOfUniqueTables[index]; j++)
-			free(UniqueTables[index][j].Table);
-		free(UniqueTables[index]);
+		// per root, the table is given by its first line in Res_x.csv of the outermost output bit
+		for (k = 0; k < NumberOfReducedTables[TablesOrder[NumberOfOutputBits - 1]]; k++)
+			if (!IsZeroCount(&RootCount[k]))
+			{
+				fprintf(F, "root, %d, %d, ", Bits[TablesOrder[NumberOfOutputBits - 1]],
+					UniqueTables[TablesOrder[NumberOfOutputBits - 1]][ReducedTablesIndex[TablesOrder[NumberOfOutputBits - 1]][k]].StartIndex);
+				PrintCount(F, RootCount[k]);
+				fprintf(F, "\n");
+			}
 
-		for (j = 0; j < NumberOfTables[index]; j++)
+		// per output bit, the combinations by the ANF of the coordinate function
+		for (Bit0 = 0; Bit0 < NumberOfOutputBits; Bit0++)
 		{
-			for (k = 0; k < 18; k++)
-				free(Strings[k][index][j]);
+			ANFHistogram = (ANFCountstruct*)malloc((NumberOfUniqueTables[Bit0] + 1) * sizeof(ANFCountstruct));
+
+			NumberOfANFs = 0;
+			for (k = 0; k < NumberOfUniqueTables[Bit0]; k++)
+				if (!IsZeroCount(&ANFCount[Bit0][k]))
+				{
+					ANFHistogram[NumberOfANFs].ANF = UniqueTables[Bit0][k].ANF;
+					ANFHistogram[NumberOfANFs].Count = ANFCount[Bit0][k];
+					NumberOfANFs++;
+				}
+
+			qsort(ANFHistogram, NumberOfANFs, sizeof(ANFCountstruct), CompareANFCount);
+
+			for (k = 0; k < NumberOfANFs; k++)
+				if ((k + 1 < NumberOfANFs) && (ANFHistogram[k + 1].ANF == ANFHistogram[k].ANF))
+					AddCount(&ANFHistogram[k + 1].Count, &ANFHistogram[k].Count);
+				else
+				{
+					fprintf(F, "anf, %d, %" PRIu64 ", ", Bits[Bit0], ANFHistogram[k].ANF);
+					PrintCount(F, ANFHistogram[k].Count);
+					fprintf(F, "\n");
+				}
+
+			free(ANFHistogram);
+			free(ANFCount[Bit0]);
 		}
 
-		for (k = 0; k < 18; k++)
-			free(Strings[k][index]);
+		fclose(F);
+		free(RootCount);
+	}
+
+	//--------------------------------------------------
+
+	for (Bit0 = 0; Bit0 < NumberOfOutputBits; Bit0++)
+	{
+		for (Bit1 = 0; Bit1 < NumberOfOutputBits; Bit1++)
+			if (CouplesPossible[TablesOrder[Bit0]][TablesOrder[Bit1]])
+				FreeBitMatrix(CouplesPossible[TablesOrder[Bit0]][TablesOrder[Bit1]]);
+
+		for (Bit1 = 0; Bit1 < NumberOfOutputBits; Bit1++)
+			if (BucketPairs[Bit0][Bit1])
+				FreeBitMatrix(BucketPairs[Bit0][Bit1]);
+
+		if (ReducedTablesIndex[Bit0])
+			free(ReducedTablesIndex[Bit0]);
+		if (ReducedBucketStart[Bit0])
+			free(ReducedBucketStart[Bit0]);
+		if (Flags[Bit0])
+			free(Flags[Bit0]);
+
+		FreeTableStore(&Stores[Bit0]);
+		free(UniqueTables[Bit0]);
+		free(RowOffsets[Bit0]);
 	}
 
 	printf("done");